@@ -1,9 +1,10 @@
 #ifndef BASE_AVX_H_
 #define BASE_AVX_H_
 
+#include <cstdint>
+
 #include <x86intrin.h>
 
-#ifdef __AVX__
 
 namespace avx {
 
@@ -17,5 +18,4 @@ union Decomposer256 {
 
 }
 
-#endif // __AVX__
 #endif // BASE_AVX_H_
@@ -38,4 +38,15 @@ constexpr std::size_t ARRAY_SIZE(const T (&)[size]) { return size; }
 #define CLANG_ALWAYS_INLINE
 #endif
 
+// TARGET_AVX2_BMI2 lets the compiler use AVX2 and BMI2 in the function, even if they are
+// not enabled by the compiler flags. Such a function must be called only when the CPU supports
+// them (see base/cpu.h). HAVE_TARGET_AVX2_BMI2 is defined when such a function can be compiled.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_TARGET_AVX2_BMI2 1
+#define TARGET_AVX2_BMI2 __attribute__((target("avx2,bmi,bmi2")))
+#elif defined(__AVX2__) && defined(__BMI2__)
+#define HAVE_TARGET_AVX2_BMI2 1
+#define TARGET_AVX2_BMI2
+#endif
+
 #endif  // BASE_BASE_H_
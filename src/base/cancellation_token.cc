@@ -0,0 +1,38 @@
+#include "base/cancellation_token.h"
+
+#include "base/time.h"
+
+// static
+CancellationToken CancellationToken::create()
+{
+    CancellationToken token;
+    token.state_ = std::make_shared<State>();
+    return token;
+}
+
+// static
+CancellationToken CancellationToken::createWithTimeout(double timeoutInSeconds)
+{
+    CancellationToken token = create();
+    token.state_->deadline = currentTime() + timeoutInSeconds;
+    return token;
+}
+
+void CancellationToken::cancel() const
+{
+    if (state_)
+        state_->cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::hasExpired() const
+{
+    if (!state_ || state_->deadline <= 0.0)
+        return false;
+    if (state_->expired.load(std::memory_order_relaxed))
+        return true;
+    // Remember it, so that we don't need to see the clock again.
+    if (currentTime() < state_->deadline)
+        return false;
+    state_->expired.store(true, std::memory_order_relaxed);
+    return true;
+}
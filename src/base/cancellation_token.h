@@ -0,0 +1,44 @@
+#ifndef BASE_CANCELLATION_TOKEN_H_
+#define BASE_CANCELLATION_TOKEN_H_
+
+#include <atomic>
+#include <memory>
+
+// CancellationToken tells a long computation that its result is no longer necessary,
+// or that its deadline has passed. The computation should check shouldStop() periodically,
+// and return as soon as possible once it becomes true.
+//
+// The copies of a token share the state, so a token can be cancelled from another thread
+// while a copy of it is used in the computation.
+//
+// A default-constructed token is never cancelled, and checking it is almost free.
+class CancellationToken {
+public:
+    CancellationToken() {}
+
+    // Creates a token which can be cancelled with cancel().
+    static CancellationToken create();
+    // Creates a token whose deadline is |timeoutInSeconds| seconds after now.
+    static CancellationToken createWithTimeout(double timeoutInSeconds);
+
+    // Cancels the computations using this token. This does nothing for a default-constructed token.
+    void cancel() const;
+
+    // Returns true if cancel() has been called.
+    bool isCancelled() const { return state_ && state_->cancelled.load(std::memory_order_relaxed); }
+    // Returns true if the deadline has passed.
+    bool hasExpired() const;
+
+    bool shouldStop() const { return isCancelled() || hasExpired(); }
+
+private:
+    struct State {
+        std::atomic<bool> cancelled { false };
+        std::atomic<bool> expired { false };
+        double deadline = 0.0;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+#endif // BASE_CANCELLATION_TOKEN_H_
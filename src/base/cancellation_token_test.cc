@@ -0,0 +1,51 @@
+#include "base/cancellation_token.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(CancellationTokenTest, neverCancelled)
+{
+    CancellationToken token;
+    token.cancel();
+
+    EXPECT_FALSE(token.isCancelled());
+    EXPECT_FALSE(token.hasExpired());
+    EXPECT_FALSE(token.shouldStop());
+}
+
+TEST(CancellationTokenTest, cancel)
+{
+    CancellationToken token = CancellationToken::create();
+    CancellationToken copied(token);
+    EXPECT_FALSE(copied.shouldStop());
+
+    // The copies share the state.
+    token.cancel();
+    EXPECT_TRUE(copied.isCancelled());
+    EXPECT_FALSE(copied.hasExpired());
+    EXPECT_TRUE(copied.shouldStop());
+}
+
+TEST(CancellationTokenTest, cancelFromAnotherThread)
+{
+    CancellationToken token = CancellationToken::create();
+    thread th([token]() { token.cancel(); });
+    th.join();
+
+    EXPECT_TRUE(token.shouldStop());
+}
+
+TEST(CancellationTokenTest, timeout)
+{
+    CancellationToken token = CancellationToken::createWithTimeout(0.0001);
+    this_thread::sleep_for(chrono::milliseconds(1));
+
+    EXPECT_FALSE(token.isCancelled());
+    EXPECT_TRUE(token.hasExpired());
+    EXPECT_TRUE(token.shouldStop());
+
+    EXPECT_FALSE(CancellationToken::createWithTimeout(100).shouldStop());
+}
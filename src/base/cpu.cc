@@ -0,0 +1,62 @@
+#include "base/cpu.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+struct CpuFeatures {
+    CpuFeatures();
+
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool fastBMI2 = false;
+};
+
+CpuFeatures::CpuFeatures()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    // __builtin_cpu_supports checks the OS support of YMM registers, too.
+    avx2 = __builtin_cpu_supports("avx2");
+    bmi2 = __builtin_cpu_supports("bmi2");
+
+    fastBMI2 = bmi2;
+    unsigned int eax, ebx, ecx, edx;
+    if (bmi2 && __builtin_cpu_is("amd") && __get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        // Zen 3 is family 0x19. The extended family is added when the base family is 0xF.
+        unsigned int family = (eax >> 8) & 0xF;
+        if (family == 0xF)
+            family += (eax >> 20) & 0xFF;
+        fastBMI2 = family >= 0x19;
+    }
+#endif
+}
+
+const CpuFeatures& features()
+{
+    static const CpuFeatures features;
+    return features;
+}
+
+} // namespace anonymous
+
+namespace cpu {
+
+bool hasAVX2()
+{
+    return features().avx2;
+}
+
+bool hasBMI2()
+{
+    return features().bmi2;
+}
+
+bool hasFastBMI2()
+{
+    return features().fastBMI2;
+}
+
+} // namespace cpu
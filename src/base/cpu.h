@@ -0,0 +1,18 @@
+#ifndef BASE_CPU_H_
+#define BASE_CPU_H_
+
+// cpu tells the instruction sets that the running CPU supports.
+// The result is detected once, and cached.
+namespace cpu {
+
+// Returns true if the CPU and OS support AVX2.
+bool hasAVX2();
+// Returns true if the CPU supports BMI2.
+bool hasBMI2();
+// Returns true if PDEP and PEXT of BMI2 are fast. They are microcoded, and take
+// tens of cycles on AMD CPUs before Zen 3, though the CPUs support BMI2.
+bool hasFastBMI2();
+
+} // namespace cpu
+
+#endif // BASE_CPU_H_
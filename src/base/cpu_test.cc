@@ -0,0 +1,18 @@
+#include "base/cpu.h"
+
+#include <gtest/gtest.h>
+
+TEST(CpuTest, consistent)
+{
+    if (cpu::hasFastBMI2()) {
+        EXPECT_TRUE(cpu::hasBMI2());
+    }
+
+#if defined(__AVX2__)
+    // The binary compiled with -mavx2 is running, so the CPU must have AVX2.
+    EXPECT_TRUE(cpu::hasAVX2());
+#endif
+#if defined(__BMI2__)
+    EXPECT_TRUE(cpu::hasBMI2());
+#endif
+}
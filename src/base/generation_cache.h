@@ -0,0 +1,135 @@
+#ifndef BASE_GENERATION_CACHE_H_
+#define BASE_GENERATION_CACHE_H_
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "base/noncopyable.h"
+
+// GenerationCache is a bounded map from Key to Value that forgets the entries
+// which are not used recently. The caller starts a new generation with nextGeneration()
+// e.g. for each think() or gaze(), and the entries used in neither the previous generation
+// nor the current generation are removed there.
+// When the cache is full, put() evicts the entries of the oldest generation to make room.
+// This class is thread-safe.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class GenerationCache : noncopyable {
+public:
+    explicit GenerationCache(size_t maxSize) : maxSize_(maxSize) {}
+
+    // Returns true and copies the value to |value| if |key| is cached.
+    bool get(const Key& key, Value* value)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            ++numMisses_;
+            return false;
+        }
+
+        ++numHits_;
+        it->second.generation = generation_;
+        *value = it->second.value;
+        return true;
+    }
+
+    // When the cache is full, the entries of the oldest generation are evicted.
+    // If all the entries are used in the current generation, |value| is not stored.
+    void put(const Key& key, Value value)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (entries_.size() >= maxSize_ && entries_.count(key) == 0) {
+            evictOldestGeneration();
+            if (entries_.size() >= maxSize_)
+                return;
+        }
+
+        Entry& entry = entries_[key];
+        entry.value = std::move(value);
+        entry.generation = generation_;
+    }
+
+    // Starts a new generation. The entries that are used in neither the previous generation
+    // nor the current generation are removed.
+    void nextGeneration()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto it = entries_.begin(); it != entries_.end(); ) {
+            if (it->second.generation < generation_)
+                it = entries_.erase(it);
+            else
+                ++it;
+        }
+        ++generation_;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        entries_.clear();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return entries_.size();
+    }
+
+    int numHits() const
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return numHits_;
+    }
+
+    int numMisses() const
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return numMisses_;
+    }
+
+    // Returns numHits / (numHits + numMisses). 0 if nothing has been looked up.
+    double hitRate() const
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (numHits_ + numMisses_ == 0)
+            return 0.0;
+        return static_cast<double>(numHits_) / (numHits_ + numMisses_);
+    }
+
+private:
+    struct Entry {
+        Value value;
+        int generation;
+    };
+
+    // Removes the entries of the oldest generation, unless it is the current generation.
+    // |mu_| must be held.
+    void evictOldestGeneration()
+    {
+        int oldestGeneration = generation_;
+        for (const auto& entry : entries_)
+            oldestGeneration = std::min(oldestGeneration, entry.second.generation);
+        if (oldestGeneration == generation_)
+            return;
+
+        for (auto it = entries_.begin(); it != entries_.end(); ) {
+            if (it->second.generation == oldestGeneration)
+                it = entries_.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    const size_t maxSize_;
+
+    mutable std::mutex mu_;
+    std::unordered_map<Key, Entry, Hash> entries_;
+    int generation_ = 0;
+    int numHits_ = 0;
+    int numMisses_ = 0;
+};
+
+#endif // BASE_GENERATION_CACHE_H_
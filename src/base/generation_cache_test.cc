@@ -0,0 +1,116 @@
+#include "base/generation_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(GenerationCacheTest, getAndPut)
+{
+    GenerationCache<int, string> cache(10);
+    EXPECT_EQ(0.0, cache.hitRate());
+
+    string value;
+    EXPECT_FALSE(cache.get(1, &value));
+
+    cache.put(1, "one");
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_EQ("one", value);
+
+    // put() overwrites the value.
+    cache.put(1, "ONE");
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_EQ("ONE", value);
+
+    EXPECT_FALSE(cache.get(2, &value));
+    EXPECT_FALSE(cache.get(3, &value));
+
+    EXPECT_EQ(1U, cache.size());
+    EXPECT_EQ(2, cache.numHits());
+    EXPECT_EQ(3, cache.numMisses());
+    EXPECT_DOUBLE_EQ(0.4, cache.hitRate());
+}
+
+TEST(GenerationCacheTest, maxSize)
+{
+    GenerationCache<int, string> cache(1);
+    cache.put(1, "one");
+    cache.put(2, "two");
+
+    string value;
+    EXPECT_EQ(1U, cache.size());
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_FALSE(cache.get(2, &value));
+
+    // The existing entry can be updated even when the cache is full.
+    cache.put(1, "ONE");
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_EQ("ONE", value);
+}
+
+TEST(GenerationCacheTest, evictOldestGeneration)
+{
+    GenerationCache<int, string> cache(3);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.nextGeneration();
+    cache.put(3, "three");
+
+    // 1 and 2 are in the oldest generation, so they are evicted.
+    cache.put(4, "four");
+    string value;
+    EXPECT_EQ(2U, cache.size());
+    EXPECT_FALSE(cache.get(1, &value));
+    EXPECT_FALSE(cache.get(2, &value));
+    EXPECT_TRUE(cache.get(3, &value));
+    EXPECT_TRUE(cache.get(4, &value));
+
+    cache.nextGeneration();
+    cache.put(5, "five");
+    // 3 is used in the previous generation, but it's older than the others.
+    EXPECT_TRUE(cache.get(4, &value));
+    cache.put(6, "six");
+    EXPECT_EQ(3U, cache.size());
+    EXPECT_FALSE(cache.get(3, &value));
+    EXPECT_TRUE(cache.get(4, &value));
+    EXPECT_TRUE(cache.get(5, &value));
+    EXPECT_TRUE(cache.get(6, &value));
+}
+
+TEST(GenerationCacheTest, nextGeneration)
+{
+    GenerationCache<int, string> cache(10);
+    cache.put(1, "one");
+    cache.put(2, "two");
+
+    cache.nextGeneration();
+    // 1 is used in this generation.
+    string value;
+    EXPECT_TRUE(cache.get(1, &value));
+
+    cache.nextGeneration();
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_FALSE(cache.get(2, &value));
+    EXPECT_EQ(1U, cache.size());
+
+    // Nothing is used in this generation, but 1 was used in the previous generation.
+    cache.nextGeneration();
+    EXPECT_EQ(1U, cache.size());
+    cache.nextGeneration();
+    EXPECT_EQ(0U, cache.size());
+}
+
+TEST(GenerationCacheTest, clear)
+{
+    GenerationCache<int, string> cache(10);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_EQ(2U, cache.size());
+
+    cache.clear();
+    EXPECT_EQ(0U, cache.size());
+
+    string value;
+    EXPECT_FALSE(cache.get(1, &value));
+}
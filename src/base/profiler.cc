@@ -0,0 +1,255 @@
+#include "base/profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_bool(profile, false, "If true, the cycles spent in the profiled sites are logged when each game has ended.");
+
+using namespace std;
+
+namespace {
+
+// The counters are written only by the owner thread, so relaxed atomics are enough.
+// They're atomic only to be read while dumping.
+struct Histogram : noncopyable {
+    Histogram()
+    {
+        for (auto& bucket : buckets)
+            bucket.store(0, memory_order_relaxed);
+    }
+
+    void add(unsigned long long cycles)
+    {
+        inc(&count, 1);
+        inc(&totalCycles, cycles);
+        if (maxCycles.load(memory_order_relaxed) < cycles)
+            maxCycles.store(cycles, memory_order_relaxed);
+        inc(&buckets[Profiler::bucketOf(cycles)], 1);
+    }
+
+    void clear()
+    {
+        count.store(0, memory_order_relaxed);
+        totalCycles.store(0, memory_order_relaxed);
+        maxCycles.store(0, memory_order_relaxed);
+        for (auto& bucket : buckets)
+            bucket.store(0, memory_order_relaxed);
+    }
+
+    static void inc(atomic<uint64_t>* v, uint64_t x) { v->store(v->load(memory_order_relaxed) + x, memory_order_relaxed); }
+
+    atomic<uint64_t> count { 0 };
+    atomic<uint64_t> totalCycles { 0 };
+    atomic<unsigned long long> maxCycles { 0 };
+    atomic<uint64_t> buckets[Profiler::NUM_BUCKETS];
+};
+
+struct ThreadProfile : noncopyable {
+    ThreadProfile()
+    {
+        for (auto& histogram : histograms)
+            histogram.store(nullptr, memory_order_relaxed);
+    }
+
+    atomic<Histogram*> histograms[Profiler::MAX_SITES];
+};
+
+// The profiles are kept after their threads have exited, so that their stats are dumped.
+struct Registry {
+    mutex mu;
+    vector<const char*> siteNames;
+    vector<unique_ptr<ThreadProfile>> profiles;
+    vector<unique_ptr<Histogram>> histograms;
+};
+
+Registry* registry()
+{
+    // Intentionally leaked, since threads might be profiled while exiting.
+    static Registry* registry = new Registry;
+    return registry;
+}
+
+ThreadProfile* threadProfile()
+{
+    static thread_local ThreadProfile* profile = nullptr;
+    if (profile)
+        return profile;
+
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    r->profiles.emplace_back(new ThreadProfile);
+    profile = r->profiles.back().get();
+    return profile;
+}
+
+Histogram* histogramOf(ThreadProfile* profile, int id)
+{
+    Histogram* histogram = profile->histograms[id].load(memory_order_acquire);
+    if (histogram)
+        return histogram;
+
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    r->histograms.emplace_back(new Histogram);
+    histogram = r->histograms.back().get();
+    profile->histograms[id].store(histogram, memory_order_release);
+    return histogram;
+}
+
+} // anonymous namespace
+
+ProfileSite::ProfileSite(const char* name) :
+    name_(name)
+{
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    CHECK_LT(r->siteNames.size(), static_cast<size_t>(Profiler::MAX_SITES)) << "too many profile sites";
+    id_ = static_cast<int>(r->siteNames.size());
+    r->siteNames.push_back(name);
+}
+
+void ProfileSite::add(unsigned long long cycles)
+{
+    histogramOf(threadProfile(), id_)->add(cycles);
+}
+
+unsigned long long ProfileStats::percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return min(Profiler::bucketUpperBound(static_cast<int>(i)), maxCycles);
+    }
+
+    return maxCycles;
+}
+
+const int Profiler::MAX_SITES;
+const int Profiler::NUM_SUB_BUCKETS;
+const int Profiler::NUM_BUCKETS;
+
+atomic<Profiler::State> Profiler::state_(Profiler::State::UNINITIALIZED);
+
+// static
+bool Profiler::initializeState()
+{
+    State expected = State::UNINITIALIZED;
+    state_.compare_exchange_strong(expected, FLAGS_profile ? State::ENABLED : State::DISABLED);
+    return state_.load() == State::ENABLED;
+}
+
+// static
+void Profiler::setEnabled(bool flag)
+{
+    state_ = flag ? State::ENABLED : State::DISABLED;
+}
+
+// static
+int Profiler::bucketOf(unsigned long long cycles)
+{
+    // The values less than NUM_SUB_BUCKETS have their own buckets.
+    // Otherwise, [2^k, 2^(k+1)) is divided into NUM_SUB_BUCKETS buckets.
+    if (cycles < NUM_SUB_BUCKETS)
+        return static_cast<int>(cycles);
+
+    int msb = 63 - __builtin_clzll(cycles);
+    int sub = static_cast<int>(cycles >> (msb - 2)) & (NUM_SUB_BUCKETS - 1);
+    return (msb - 1) * NUM_SUB_BUCKETS + sub;
+}
+
+// static
+unsigned long long Profiler::bucketUpperBound(int bucket)
+{
+    if (bucket < NUM_SUB_BUCKETS)
+        return bucket;
+
+    int msb = bucket / NUM_SUB_BUCKETS + 1;
+    unsigned long long sub = bucket % NUM_SUB_BUCKETS;
+    if (msb >= 63 && sub == NUM_SUB_BUCKETS - 1)
+        return ~0ULL;
+    return ((NUM_SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
+
+// static
+vector<ProfileStats> Profiler::stats()
+{
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+
+    map<string, ProfileStats> statsByName;
+    for (int id = 0; id < static_cast<int>(r->siteNames.size()); ++id) {
+        for (const auto& profile : r->profiles) {
+            const Histogram* histogram = profile->histograms[id].load(memory_order_acquire);
+            if (!histogram || histogram->count.load(memory_order_relaxed) == 0)
+                continue;
+
+            ProfileStats& stats = statsByName[r->siteNames[id]];
+            if (stats.buckets.empty()) {
+                stats.name = r->siteNames[id];
+                stats.buckets.resize(NUM_BUCKETS);
+            }
+            stats.count += histogram->count.load(memory_order_relaxed);
+            stats.totalCycles += histogram->totalCycles.load(memory_order_relaxed);
+            stats.maxCycles = max(stats.maxCycles, histogram->maxCycles.load(memory_order_relaxed));
+            for (int i = 0; i < NUM_BUCKETS; ++i)
+                stats.buckets[i] += histogram->buckets[i].load(memory_order_relaxed);
+        }
+    }
+
+    vector<ProfileStats> result;
+    for (auto& entry : statsByName)
+        result.push_back(move(entry.second));
+    return result;
+}
+
+// static
+string Profiler::toString()
+{
+    ostringstream ss;
+    ss << setw(40) << left << "name" << right
+       << setw(12) << "count" << setw(16) << "total" << setw(12) << "average"
+       << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99" << setw(12) << "max" << endl;
+    for (const ProfileStats& stats : Profiler::stats()) {
+        ss << setw(40) << left << stats.name << right
+           << setw(12) << stats.count
+           << setw(16) << stats.totalCycles
+           << setw(12) << static_cast<unsigned long long>(stats.average())
+           << setw(12) << stats.percentile(0.5)
+           << setw(12) << stats.percentile(0.9)
+           << setw(12) << stats.percentile(0.99)
+           << setw(12) << stats.maxCycles << endl;
+    }
+    return ss.str();
+}
+
+// static
+void Profiler::clear()
+{
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    for (const auto& histogram : r->histograms)
+        histogram->clear();
+}
+
+// static
+void Profiler::dumpIfRequested(const string& title)
+{
+    if (!FLAGS_profile)
+        return;
+
+    // Don't use stdout, since it's connected to the server.
+    LOG(INFO) << "profile of " << title << " [cycles]" << endl << toString();
+    clear();
+}
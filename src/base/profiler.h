@@ -0,0 +1,120 @@
+#ifndef BASE_PROFILER_H_
+#define BASE_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/time_stamp_counter.h"
+
+// Profiler collects the CPU cycles spent in the instrumented sites.
+// Put PROFILE_SCOPE("name") at the beginning of a scope to instrument it.
+// The sites having the same name are merged in the statistics, so a site in a template
+// function is reported once.
+//
+// The cycles are recorded into a per-thread histogram, so the threads don't contend.
+// The histogram has HDR-style log-linear buckets: each power of two is divided into
+// NUM_SUB_BUCKETS buckets, so the percentiles have at most 1/NUM_SUB_BUCKETS relative error.
+//
+// Profiling is disabled unless --profile is specified or setEnabled(true) is called.
+// When disabled, a site costs only a branch.
+class ProfileSite : noncopyable {
+public:
+    explicit ProfileSite(const char* name);
+
+    const char* name() const { return name_; }
+
+    void add(unsigned long long cycles);
+
+private:
+    const char* name_;
+    int id_;
+};
+
+struct ProfileStats {
+    // Returns the approximated cycles at the |p|-th percentile (0 <= p <= 1).
+    unsigned long long percentile(double p) const;
+    double average() const { return count > 0 ? static_cast<double>(totalCycles) / count : 0.0; }
+
+    std::string name;
+    std::uint64_t count = 0;
+    std::uint64_t totalCycles = 0;
+    unsigned long long maxCycles = 0;
+    std::vector<std::uint64_t> buckets;
+};
+
+class Profiler {
+public:
+    static const int MAX_SITES = 256;
+    static const int NUM_SUB_BUCKETS = 4;
+    static const int NUM_BUCKETS = 64 * NUM_SUB_BUCKETS;
+
+    static bool isEnabled()
+    {
+        State state = state_.load(std::memory_order_relaxed);
+        if (state == State::UNINITIALIZED)
+            return initializeState();
+        return state == State::ENABLED;
+    }
+    static void setEnabled(bool);
+
+    // Returns the statistics of all the sites merged over the threads, sorted by name.
+    // The sites which are never reached are omitted.
+    static std::vector<ProfileStats> stats();
+    static std::string toString();
+    static void clear();
+
+    // If --profile is specified, logs the statistics with |title| and clears them.
+    // AI calls this when a game has ended.
+    static void dumpIfRequested(const std::string& title);
+
+    static int bucketOf(unsigned long long cycles);
+    // Returns the largest value in |bucket|.
+    static unsigned long long bucketUpperBound(int bucket);
+
+private:
+    enum class State {
+        UNINITIALIZED, DISABLED, ENABLED,
+    };
+
+    // Initialized from --profile lazily, since flags are not parsed yet in static initialization.
+    static bool initializeState();
+
+    static std::atomic<State> state_;
+};
+
+// ScopedProfile adds the cycles from its construction to its destruction to |site|.
+class ScopedProfile : noncopyable {
+public:
+    explicit ScopedProfile(ProfileSite* site) :
+        site_(Profiler::isEnabled() ? site : nullptr),
+        start_(site_ ? rdtscp(&aux_) : 0)
+    {
+    }
+
+    ~ScopedProfile()
+    {
+        if (!site_)
+            return;
+
+        unsigned long long end = rdtscp(&aux_);
+        if (end > start_)
+            site_->add(end - start_);
+    }
+
+private:
+    ProfileSite* site_;
+    unsigned int aux_;
+    unsigned long long start_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name)                                                 \
+    static ProfileSite PROFILE_CONCAT(profileSite_, __LINE__)(name);        \
+    ScopedProfile PROFILE_CONCAT(scopedProfile_, __LINE__)(&PROFILE_CONCAT(profileSite_, __LINE__))
+
+#endif // BASE_PROFILER_H_
@@ -0,0 +1,116 @@
+#include "base/profiler.h"
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+const ProfileStats* findStats(const vector<ProfileStats>& stats, const string& name)
+{
+    for (const auto& s : stats) {
+        if (s.name == name)
+            return &s;
+    }
+    return nullptr;
+}
+
+void profiledFunction()
+{
+    PROFILE_SCOPE("profiledFunction");
+}
+
+}
+
+TEST(ProfilerTest, bucket)
+{
+    for (unsigned long long v = 0; v < 4; ++v)
+        EXPECT_EQ(static_cast<int>(v), Profiler::bucketOf(v));
+
+    // Each power of two is divided into 4 buckets.
+    EXPECT_EQ(4, Profiler::bucketOf(4));
+    EXPECT_EQ(7, Profiler::bucketOf(7));
+    EXPECT_EQ(8, Profiler::bucketOf(8));
+    EXPECT_EQ(8, Profiler::bucketOf(9));
+    EXPECT_EQ(9, Profiler::bucketOf(10));
+    EXPECT_EQ(Profiler::NUM_BUCKETS - 5, Profiler::bucketOf(~0ULL));
+
+    // Every value is in the bucket whose upper bound is not less than it.
+    for (unsigned long long v = 0; v < 100000; v = v * 3 / 2 + 1) {
+        int bucket = Profiler::bucketOf(v);
+        EXPECT_LE(v, Profiler::bucketUpperBound(bucket));
+        if (bucket > 0) {
+            EXPECT_LT(Profiler::bucketUpperBound(bucket - 1), v);
+        }
+    }
+    EXPECT_EQ(~0ULL, Profiler::bucketUpperBound(Profiler::bucketOf(~0ULL)));
+}
+
+TEST(ProfilerTest, disabled)
+{
+    Profiler::setEnabled(false);
+    Profiler::clear();
+
+    profiledFunction();
+
+    EXPECT_EQ(nullptr, findStats(Profiler::stats(), "profiledFunction"));
+}
+
+TEST(ProfilerTest, scope)
+{
+    Profiler::setEnabled(true);
+    Profiler::clear();
+
+    for (int i = 0; i < 10; ++i)
+        profiledFunction();
+
+    const ProfileStats* stats = findStats(Profiler::stats(), "profiledFunction");
+    ASSERT_NE(nullptr, stats);
+    EXPECT_EQ(10U, stats->count);
+    EXPECT_LE(stats->percentile(0.5), stats->maxCycles);
+    EXPECT_NE(string::npos, Profiler::toString().find("profiledFunction"));
+
+    Profiler::clear();
+    EXPECT_EQ(nullptr, findStats(Profiler::stats(), "profiledFunction"));
+
+    Profiler::setEnabled(false);
+}
+
+TEST(ProfilerTest, percentile)
+{
+    ProfileStats stats;
+    stats.buckets.resize(Profiler::NUM_BUCKETS);
+    for (unsigned long long v = 1; v <= 100; ++v) {
+        ++stats.buckets[Profiler::bucketOf(v)];
+        ++stats.count;
+        stats.totalCycles += v;
+    }
+    stats.maxCycles = 100;
+
+    EXPECT_EQ(50.5, stats.average());
+    // The percentiles are approximated with the bucket upper bounds.
+    EXPECT_EQ(55ULL, stats.percentile(0.5));
+    EXPECT_EQ(95ULL, stats.percentile(0.9));
+    EXPECT_EQ(100ULL, stats.percentile(1.0));
+}
+
+TEST(ProfilerTest, mergeThreads)
+{
+    Profiler::setEnabled(true);
+    Profiler::clear();
+
+    thread th1([]() { profiledFunction(); });
+    thread th2([]() { profiledFunction(); profiledFunction(); });
+    th1.join();
+    th2.join();
+
+    // The stats of the exited threads are still merged.
+    const ProfileStats* stats = findStats(Profiler::stats(), "profiledFunction");
+    ASSERT_NE(nullptr, stats);
+    EXPECT_EQ(3U, stats->count);
+
+    Profiler::setEnabled(false);
+}
@@ -0,0 +1,314 @@
+#include "base/trace.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_string(trace_file, "", "If specified, the traced spans are dumped to <trace_file>-<pid>.json "
+              "in Chrome trace event format.");
+
+using namespace std;
+
+namespace {
+
+enum class TraceState {
+    UNINITIALIZED, DISABLED, ENABLED,
+};
+
+// Initialized from --trace_file lazily, since flags are not parsed yet in static initialization.
+atomic<TraceState> traceState(TraceState::UNINITIALIZED);
+
+struct Span {
+    const char* name;
+    int64_t begin;
+    int64_t end;
+    int frameId;
+};
+
+// Spans of one thread. When the thread exits, the buffer is kept until its spans are dumped,
+// and then it's reused by a new thread.
+class ThreadBuffer : noncopyable {
+public:
+    ThreadBuffer(int tid, const string& name) : tid_(tid), name_(name), spans_(Tracer::BUFFER_SIZE_PER_THREAD) {}
+
+    void setName(const string& name)
+    {
+        lock_guard<mutex> lock(mu_);
+        name_ = name;
+    }
+
+    // The lock is taken only by this thread except while dumping, so it's almost free.
+    void add(const Span& span)
+    {
+        lock_guard<mutex> lock(mu_);
+        spans_[count_ % spans_.size()] = span;
+        ++count_;
+    }
+
+    // Copies the tid, the name and the spans from the oldest one. If the thread has exited,
+    // the buffer becomes reusable, since its spans won't be added any more.
+    void takeSnapshot(int* tid, string* name, vector<Span>* spans)
+    {
+        lock_guard<mutex> lock(mu_);
+        *tid = tid_;
+        *name = name_;
+        size_t size = min<size_t>(count_, spans_.size());
+        spans->clear();
+        spans->reserve(size);
+        for (size_t i = count_ - size; i < count_; ++i)
+            spans->push_back(spans_[i % spans_.size()]);
+        if (exited_)
+            dumped_ = true;
+    }
+
+    void clear()
+    {
+        lock_guard<mutex> lock(mu_);
+        count_ = 0;
+        if (exited_)
+            dumped_ = true;
+    }
+
+    void setExited()
+    {
+        lock_guard<mutex> lock(mu_);
+        exited_ = true;
+    }
+
+    // Returns true if the buffer can be used by a new thread. Unless |force| is true,
+    // the spans must have been dumped.
+    bool isReusable(bool force) const
+    {
+        lock_guard<mutex> lock(mu_);
+        return exited_ && (dumped_ || force);
+    }
+
+    void reuse(int tid, const string& name)
+    {
+        lock_guard<mutex> lock(mu_);
+        tid_ = tid;
+        name_ = name;
+        count_ = 0;
+        exited_ = false;
+        dumped_ = false;
+    }
+
+private:
+    mutable mutex mu_;
+    int tid_;
+    string name_;
+    vector<Span> spans_;
+    size_t count_ = 0;
+    bool exited_ = false;
+    bool dumped_ = false;
+};
+
+struct Registry {
+    mutex mu;
+    vector<unique_ptr<ThreadBuffer>> buffers;
+    int lastTid = 0;
+};
+
+Registry* registry()
+{
+    // Intentionally leaked, since threads might record spans while exiting.
+    static Registry* registry = new Registry;
+    return registry;
+}
+
+// The buffers of the exited threads whose spans are not dumped yet are reused
+// when the registry has this number of buffers, so that the memory is bounded.
+const size_t MAX_NUM_THREAD_BUFFERS = 64;
+
+ThreadBuffer* acquireThreadBuffer(const string& name)
+{
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    const int tid = ++r->lastTid;
+
+    for (bool force : { false, r->buffers.size() >= MAX_NUM_THREAD_BUFFERS }) {
+        for (const auto& buffer : r->buffers) {
+            if (buffer->isReusable(force)) {
+                buffer->reuse(tid, name);
+                return buffer.get();
+            }
+        }
+    }
+
+    r->buffers.emplace_back(new ThreadBuffer(tid, name));
+    return r->buffers.back().get();
+}
+
+// The buffer is allocated when the thread records the first span.
+struct ThreadState {
+    ~ThreadState()
+    {
+        if (buffer)
+            buffer->setExited();
+    }
+
+    ThreadBuffer* buffer = nullptr;
+    string name;
+};
+
+ThreadState* threadState()
+{
+    static thread_local ThreadState state;
+    return &state;
+}
+
+string escapeJson(const string& s)
+{
+    string result;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+const int Tracer::BUFFER_SIZE_PER_THREAD;
+
+// static
+bool Tracer::isEnabled()
+{
+    TraceState state = traceState.load(memory_order_relaxed);
+    if (state == TraceState::UNINITIALIZED) {
+        TraceState expected = TraceState::UNINITIALIZED;
+        traceState.compare_exchange_strong(expected, FLAGS_trace_file.empty() ? TraceState::DISABLED : TraceState::ENABLED);
+        state = traceState.load();
+    }
+
+    return state == TraceState::ENABLED;
+}
+
+// static
+void Tracer::setEnabled(bool flag)
+{
+    traceState = flag ? TraceState::ENABLED : TraceState::DISABLED;
+}
+
+// static
+int64_t Tracer::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// static
+void Tracer::setThreadName(const string& name)
+{
+    if (!isEnabled())
+        return;
+
+    ThreadState* state = threadState();
+    state->name = name;
+    if (state->buffer)
+        state->buffer->setName(name);
+}
+
+// static
+void Tracer::addSpan(const char* name, int64_t beginNanos, int64_t endNanos, int frameId)
+{
+    ThreadState* state = threadState();
+    if (!state->buffer)
+        state->buffer = acquireThreadBuffer(state->name);
+    state->buffer->add(Span { name, beginNanos, endNanos, frameId });
+}
+
+// static
+string Tracer::toChromeTraceJson()
+{
+    const int pid = getpid();
+
+    vector<ThreadBuffer*> buffers;
+    {
+        Registry* r = registry();
+        lock_guard<mutex> lock(r->mu);
+        for (const auto& buffer : r->buffers)
+            buffers.push_back(buffer.get());
+    }
+
+    ostringstream ss;
+    ss.setf(ios::fixed);
+    ss.precision(3);
+    ss << "{\"traceEvents\":[";
+    bool first = true;
+    int tid;
+    string name;
+    vector<Span> spans;
+    for (ThreadBuffer* buffer : buffers) {
+        buffer->takeSnapshot(&tid, &name, &spans);
+        if (!name.empty()) {
+            if (!first)
+                ss << ",";
+            first = false;
+            ss << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+               << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+        }
+
+        for (const Span& span : spans) {
+            if (!first)
+                ss << ",";
+            first = false;
+            // Chrome trace uses microseconds.
+            ss << "\n{\"name\":\"" << escapeJson(span.name) << "\",\"ph\":\"X\""
+               << ",\"ts\":" << (span.begin / 1000.0)
+               << ",\"dur\":" << ((span.end - span.begin) / 1000.0)
+               << ",\"pid\":" << pid << ",\"tid\":" << tid;
+            if (span.frameId >= 0)
+                ss << ",\"args\":{\"frameId\":" << span.frameId << "}";
+            ss << "}";
+        }
+    }
+    ss << "\n]}\n";
+
+    return ss.str();
+}
+
+// static
+bool Tracer::dump(const string& filename)
+{
+    ofstream ofs(filename);
+    if (!ofs) {
+        LOG(ERROR) << "failed to open " << filename;
+        return false;
+    }
+
+    ofs << toChromeTraceJson();
+    return ofs.good();
+}
+
+// static
+bool Tracer::dumpIfRequested()
+{
+    if (FLAGS_trace_file.empty())
+        return false;
+
+    string filename = FLAGS_trace_file + "-" + to_string(getpid()) + ".json";
+    LOG(INFO) << "dumping trace to " << filename;
+    return dump(filename);
+}
+
+// static
+void Tracer::clear()
+{
+    Registry* r = registry();
+    lock_guard<mutex> lock(r->mu);
+    for (const auto& buffer : r->buffers)
+        buffer->clear();
+}
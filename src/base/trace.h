@@ -0,0 +1,69 @@
+#ifndef BASE_TRACE_H_
+#define BASE_TRACE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "base/noncopyable.h"
+
+// Tracer records spans to see where time goes, e.g. from capturing a frame to sending keys.
+// Each thread records its spans into its own ring buffer, so recording a span is cheap and
+// doesn't contend with the other threads. When the buffer is full, the oldest spans are
+// overwritten. The buffer is allocated when the thread records its first span. After the thread
+// has exited, its buffer is kept until the spans are dumped, and then it's reused by another thread.
+//
+// The spans can be dumped in Chrome trace event format. Open the file with chrome://tracing.
+// The timestamps come from the monotonic clock, so the dumps of the server and the AI
+// processes on the same machine can be compared with each other.
+//
+// Tracing is disabled unless --trace_file is specified or setEnabled(true) is called.
+class Tracer {
+public:
+    static const int BUFFER_SIZE_PER_THREAD = 1 << 14;
+
+    static bool isEnabled();
+    static void setEnabled(bool);
+
+    // Returns the current time of the monotonic clock [ns].
+    static std::int64_t now();
+
+    // Names the current thread in the dump. This is ignored when tracing is disabled.
+    static void setThreadName(const std::string&);
+
+    // Records a span of the current thread. |name| must be alive until the spans are dumped,
+    // so a string literal should be used. |frameId| is shown as an argument if it's not negative.
+    static void addSpan(const char* name, std::int64_t beginNanos, std::int64_t endNanos, int frameId = -1);
+
+    // Returns the recorded spans in Chrome trace event format.
+    static std::string toChromeTraceJson();
+    static bool dump(const std::string& filename);
+    // Dumps to <trace_file>-<pid>.json if --trace_file is specified.
+    static bool dumpIfRequested();
+
+    // Removes all the recorded spans.
+    static void clear();
+};
+
+// ScopedTrace records a span from its construction to its destruction.
+class ScopedTrace : noncopyable {
+public:
+    explicit ScopedTrace(const char* name, int frameId = -1) :
+        name_(name),
+        frameId_(frameId),
+        begin_(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+
+    ~ScopedTrace()
+    {
+        if (begin_ >= 0)
+            Tracer::addSpan(name_, begin_, Tracer::now(), frameId_);
+    }
+
+private:
+    const char* name_;
+    int frameId_;
+    std::int64_t begin_;
+};
+
+#endif // BASE_TRACE_H_
@@ -0,0 +1,148 @@
+#include "base/trace.h"
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+int countOccurrences(const string& s, const string& pattern)
+{
+    int count = 0;
+    for (size_t pos = s.find(pattern); pos != string::npos; pos = s.find(pattern, pos + 1))
+        ++count;
+    return count;
+}
+
+}
+
+TEST(TraceTest, disabled)
+{
+    Tracer::setEnabled(false);
+    Tracer::clear();
+
+    {
+        ScopedTrace trace("disabledSpan");
+    }
+
+    EXPECT_EQ(string::npos, Tracer::toChromeTraceJson().find("disabledSpan"));
+}
+
+TEST(TraceTest, scopedTrace)
+{
+    Tracer::setEnabled(true);
+    Tracer::clear();
+
+    {
+        ScopedTrace trace("scopedSpan", 42);
+    }
+
+    string json = Tracer::toChromeTraceJson();
+    EXPECT_NE(string::npos, json.find("\"name\":\"scopedSpan\",\"ph\":\"X\""));
+    EXPECT_NE(string::npos, json.find("\"args\":{\"frameId\":42}"));
+
+    Tracer::setEnabled(false);
+}
+
+TEST(TraceTest, ringBuffer)
+{
+    Tracer::setEnabled(true);
+    Tracer::clear();
+
+    for (int i = 0; i < Tracer::BUFFER_SIZE_PER_THREAD + 10; ++i)
+        Tracer::addSpan("ringSpan", i, i + 1);
+
+    // The oldest spans are overwritten.
+    string json = Tracer::toChromeTraceJson();
+    EXPECT_EQ(Tracer::BUFFER_SIZE_PER_THREAD, countOccurrences(json, "ringSpan"));
+    EXPECT_EQ(string::npos, json.find("\"ts\":0.000,"));
+    EXPECT_NE(string::npos, json.find("\"ts\":0.010,"));
+
+    Tracer::setEnabled(false);
+}
+
+TEST(TraceTest, threadName)
+{
+    Tracer::setEnabled(true);
+    Tracer::clear();
+
+    thread th([]() {
+        Tracer::setThreadName("worker");
+        ScopedTrace trace("workerSpan");
+    });
+    th.join();
+
+    // The spans of the exited thread are still dumped.
+    string json = Tracer::toChromeTraceJson();
+    EXPECT_NE(string::npos, json.find("\"args\":{\"name\":\"worker\"}"));
+    EXPECT_NE(string::npos, json.find("workerSpan"));
+
+    Tracer::setEnabled(false);
+}
+
+TEST(TraceTest, threadNameWithoutSpan)
+{
+    Tracer::setEnabled(false);
+    Tracer::clear();
+
+    thread th1([]() {
+        // Ignored, since tracing is disabled.
+        Tracer::setThreadName("disabledWorker");
+        Tracer::setEnabled(true);
+        ScopedTrace trace("disabledWorkerSpan");
+    });
+    th1.join();
+
+    thread th2([]() {
+        // No buffer is allocated until a span is recorded.
+        Tracer::setThreadName("idleWorker");
+    });
+    th2.join();
+
+    string json = Tracer::toChromeTraceJson();
+    EXPECT_NE(string::npos, json.find("disabledWorkerSpan"));
+    EXPECT_EQ(string::npos, json.find("disabledWorker\""));
+    EXPECT_EQ(string::npos, json.find("idleWorker"));
+
+    Tracer::setEnabled(false);
+}
+
+TEST(TraceTest, bufferOfExitedThreadIsReusedAfterDump)
+{
+    Tracer::setEnabled(true);
+    Tracer::clear();
+
+    thread th1([]() {
+        Tracer::setThreadName("worker1");
+        ScopedTrace trace("worker1Span");
+    });
+    th1.join();
+
+    // The spans of worker1 are not dumped yet, so its buffer is not reused.
+    thread th2([]() {
+        Tracer::setThreadName("worker2");
+        ScopedTrace trace("worker2Span");
+    });
+    th2.join();
+
+    string json = Tracer::toChromeTraceJson();
+    EXPECT_NE(string::npos, json.find("worker1Span"));
+    EXPECT_NE(string::npos, json.find("worker2Span"));
+
+    // Now the buffers of worker1 and worker2 can be reused.
+    thread th3([]() {
+        Tracer::setThreadName("worker3");
+        ScopedTrace trace("worker3Span");
+    });
+    th3.join();
+
+    json = Tracer::toChromeTraceJson();
+    EXPECT_EQ(1, countOccurrences(json, "worker1Span") + countOccurrences(json, "worker2Span"));
+    EXPECT_NE(string::npos, json.find("\"args\":{\"name\":\"worker3\"}"));
+    EXPECT_NE(string::npos, json.find("worker3Span"));
+
+    Tracer::setEnabled(false);
+}
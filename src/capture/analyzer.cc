@@ -3,6 +3,9 @@
 #include <sstream>
 #include <queue>
 
+#include "base/executor.h"
+#include "base/wait_group.h"
+
 using namespace std;
 
 namespace {
@@ -159,11 +162,10 @@ std::unique_ptr<AnalyzerResult> Analyzer::analyze(const SDL_Surface* surface,
                                                   const SDL_Surface* /*prevSurface*/,
                                                   const SDL_Surface* prev2Surface,
                                                   const SDL_Surface* prev3Surface,
-                                                  const deque<unique_ptr<AnalyzerResult>>& previousResults)
+                                                  const deque<unique_ptr<AnalyzerResult>>& previousResults,
+                                                  Executor* executor)
 {
     CaptureGameState gameState = detectGameState(surface);
-    unique_ptr<DetectedField> player1FieldResult = detectField(0, surface, prev2Surface, prev3Surface);
-    unique_ptr<DetectedField> player2FieldResult = detectField(1, surface, prev2Surface, prev3Surface);
 
     switch (gameState) {
     case CaptureGameState::UNKNOWN: {
@@ -172,15 +174,34 @@ std::unique_ptr<AnalyzerResult> Analyzer::analyze(const SDL_Surface* surface,
         auto player2Result = unique_ptr<PlayerAnalyzerResult>();
         return std::unique_ptr<AnalyzerResult>(new AnalyzerResult(gameState, move(player1Result), move(player2Result)));
     }
-    case CaptureGameState::LEVEL_SELECT: {
-        auto player1Result = analyzePlayerFieldOnLevelSelect(*player1FieldResult, makePlayerOnlyResults(0, previousResults));
-        auto player2Result = analyzePlayerFieldOnLevelSelect(*player2FieldResult, makePlayerOnlyResults(1, previousResults));
-        return std::unique_ptr<AnalyzerResult>(new AnalyzerResult(gameState, move(player1Result), move(player2Result)));
-    }
+    case CaptureGameState::LEVEL_SELECT:
     case CaptureGameState::PLAYING: {
-        auto player1Result = analyzePlayerField(*player1FieldResult, makePlayerOnlyResults(0, previousResults));
-        auto player2Result = analyzePlayerField(*player2FieldResult, makePlayerOnlyResults(1, previousResults));
-        return std::unique_ptr<AnalyzerResult>(new AnalyzerResult(gameState, move(player1Result), move(player2Result)));
+        // Each player's region and previous results are independent, so the players can be
+        // analyzed concurrently.
+        unique_ptr<PlayerAnalyzerResult> playerResults[2];
+        auto analyzePlayer = [&](int pi) {
+            unique_ptr<DetectedField> detectedField = detectField(pi, surface, prev2Surface, prev3Surface);
+            if (gameState == CaptureGameState::LEVEL_SELECT)
+                playerResults[pi] = analyzePlayerFieldOnLevelSelect(*detectedField, makePlayerOnlyResults(pi, previousResults));
+            else
+                playerResults[pi] = analyzePlayerField(*detectedField, makePlayerOnlyResults(pi, previousResults));
+        };
+
+        if (executor) {
+            WaitGroup wg;
+            wg.add(1);
+            executor->submit([&analyzePlayer, &wg]() {
+                analyzePlayer(1);
+                wg.done();
+            });
+            analyzePlayer(0);
+            wg.waitUntilDone();
+        } else {
+            analyzePlayer(0);
+            analyzePlayer(1);
+        }
+
+        return std::unique_ptr<AnalyzerResult>(new AnalyzerResult(gameState, move(playerResults[0]), move(playerResults[1])));
     }
     case CaptureGameState::GAME_FINISHED_WITH_1P_WIN:
     case CaptureGameState::GAME_FINISHED_WITH_2P_WIN:
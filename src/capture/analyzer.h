@@ -17,6 +17,8 @@
 #include "gui/bounding_box.h"
 #include "capture/real_color_field.h"
 
+class Executor;
+
 // TODO(mayah): Should be renamed?
 enum class CaptureGameState {
     UNKNOWN,
@@ -161,14 +163,18 @@ public:
     virtual ~Analyzer() {}
 
     // Analyzes the specified frame. previousResults.front() should be the most recent results.
+    // If |executor| is specified, the 2P region is analyzed on |executor| while the 1P region
+    // is analyzed on the calling thread. This returns after both are analyzed.
     std::unique_ptr<AnalyzerResult> analyze(const SDL_Surface* current,
                                             const SDL_Surface* prev,
                                             const SDL_Surface* prev2,
                                             const SDL_Surface* prev3,
-                                            const std::deque<std::unique_ptr<AnalyzerResult>>& previousResults);
+                                            const std::deque<std::unique_ptr<AnalyzerResult>>& previousResults,
+                                            Executor* executor = nullptr);
 
 protected:
     // These methods should be implemented in the derived class.
+    // detectField() might be called for each player concurrently.
     virtual CaptureGameState detectGameState(const SDL_Surface*) = 0;
     virtual std::unique_ptr<DetectedField> detectField(int pi,
                                                        const SDL_Surface* current,
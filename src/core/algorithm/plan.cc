@@ -3,21 +3,13 @@
 #include <glog/logging.h>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
+#include "base/noncopyable.h"
 #include "core/kumipuyo_seq.h"
-#include "core/puyo_controller.h"
 
 using namespace std;
 
-static const Decision DECISIONS[] = {
-    Decision(2, 3), Decision(3, 3), Decision(3, 1), Decision(4, 1),
-    Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2),
-    Decision(4, 2), Decision(5, 2), Decision(6, 2), Decision(1, 1),
-    Decision(2, 1), Decision(4, 3), Decision(5, 3), Decision(6, 3),
-    Decision(1, 0), Decision(2, 0), Decision(3, 0), Decision(4, 0),
-    Decision(5, 0), Decision(6, 0),
-};
-
 static const Kumipuyo ALL_KUMIPUYO_KINDS[] = {
     Kumipuyo(PuyoColor::RED, PuyoColor::RED),
     Kumipuyo(PuyoColor::RED, PuyoColor::BLUE),
@@ -70,6 +62,73 @@ std::string RefPlan::decisionText() const
     return ss.str();
 }
 
+namespace {
+
+// PlanDeduplicator remembers the cheapest cost of the fields which have appeared at each depth.
+class PlanDeduplicator : noncopyable {
+public:
+    PlanDeduplicator(const KumipuyoSeq& kumipuyoSeq, int maxDepth, Plan::IterationStats* stats) :
+        seen_(maxDepth),
+        enabled_(maxDepth),
+        stats_(stats)
+    {
+        // The same field can be made by different decisions only when the kumipuyos so far
+        // share a color. Otherwise, each puyo in the field tells which decision has placed it.
+        // Unknown kumipuyos make too many fields to remember, so they are not deduplicated.
+        bool sharesColor = false;
+        for (int depth = 0; depth < maxDepth && depth < kumipuyoSeq.size(); ++depth) {
+            const Kumipuyo& kumipuyo = kumipuyoSeq.get(depth);
+            for (int i = 0; i < depth; ++i) {
+                const Kumipuyo& previous = kumipuyoSeq.get(i);
+                if (kumipuyo.axis == previous.axis || kumipuyo.axis == previous.child ||
+                    kumipuyo.child == previous.axis || kumipuyo.child == previous.child) {
+                    sharesColor = true;
+                }
+            }
+            enabled_[depth] = sharesColor;
+        }
+    }
+
+    // Returns true if |field| has appeared at |depth| with no more frames and no more chigiris.
+    // Otherwise, |field| is remembered with its cost.
+    bool isDuplicated(int depth, const CoreField& field, int totalFrames, int numChigiri)
+    {
+        if (stats_)
+            ++stats_->numPlans;
+        if (!enabled_[depth])
+            return false;
+
+        auto& seen = seen_[depth];
+        auto it = seen.find(field);
+        if (it == seen.end()) {
+            seen.emplace(field, Cost { totalFrames, numChigiri });
+            return false;
+        }
+
+        Cost& cost = it->second;
+        if (cost.totalFrames <= totalFrames && cost.numChigiri <= numChigiri) {
+            if (stats_)
+                ++stats_->numPrunedPlans;
+            return true;
+        }
+        if (totalFrames <= cost.totalFrames && numChigiri <= cost.numChigiri)
+            cost = Cost { totalFrames, numChigiri };
+        return false;
+    }
+
+private:
+    struct Cost {
+        int totalFrames;
+        int numChigiri;
+    };
+
+    std::vector<std::unordered_map<CoreField, Cost>> seen_;
+    std::vector<bool> enabled_;
+    Plan::IterationStats* stats_;
+};
+
+} // anonymous namespace
+
 template<typename Callback>
 void iterateAvailablePlansInternal(CoreField field,
                                    const KumipuyoSeq& kumipuyoSeq,
@@ -80,6 +139,7 @@ void iterateAvailablePlansInternal(CoreField field,
                                    int maxDepth,
                                    int currentNumChigiri,
                                    int totalFrames,
+                                   PlanDeduplicator* deduplicator,
                                    Callback callback)
 {
     const Kumipuyo* ptr;
@@ -115,19 +175,19 @@ void iterateAvailablePlansInternal(CoreField field,
             return;
     }
 
-    for (int j = 0; j < 22; j++) {
-        const Decision& decision = DECISIONS[j];
-        if (!PuyoController::isReachable(field, decision))
-            continue;
+    CoreField::KumipuyoPlacement placements[22];
+    int numRepPlacements;
+    const int numPlacements = field.computeKumipuyoPlacements(placements, &numRepPlacements);
 
-        bool isChigiri = field.isChigiriDecision(decision);
-        int dropFrames = field.framesToDropNext(decision);
+    for (int j = 0; j < numPlacements; j++) {
+        const Decision& decision = placements[j].decision;
+        const bool isChigiri = placements[j].isChigiri;
+        const int dropFrames = placements[j].dropFrames;
 
         decisions.push_back(decision);
         for (int i = 0; i < n; ++i) {
             const Kumipuyo& kumipuyo = ptr[i];
-            int num_decisions = (kumipuyo.axis == kumipuyo.child) ? 11 : 22;
-            if (j >= num_decisions)
+            if (kumipuyo.isRep() && j >= numRepPlacements)
                 continue;
 
             CoreField nextField(field);
@@ -138,11 +198,15 @@ void iterateAvailablePlansInternal(CoreField field,
             if (!shouldFire && !nextField.isEmpty(3, 12))
                 continue;
 
+            if (deduplicator->isDuplicated(currentDepth, nextField, totalFrames + dropFrames, currentNumChigiri + isChigiri))
+                continue;
+
             if (currentDepth + 1 == maxDepth || shouldFire) {
                 callback(nextField, decisions, currentNumChigiri + isChigiri, totalFrames, dropFrames, shouldFire);
             } else {
                 iterateAvailablePlansInternal(nextField, kumipuyoSeq, decisions, events, eventIndex, currentDepth + 1,
-                                              maxDepth, currentNumChigiri + isChigiri, totalFrames + dropFrames, callback);
+                                              maxDepth, currentNumChigiri + isChigiri, totalFrames + dropFrames,
+                                              deduplicator, callback);
             }
         }
         decisions.pop_back();
@@ -153,10 +217,11 @@ void iterateAvailablePlansInternal(CoreField field,
 void Plan::iterateAvailablePlans(const CoreField& field,
                                  const KumipuyoSeq& kumipuyoSeq,
                                  int maxDepth,
-                                 const Plan::IterationCallback& callback)
+                                 const Plan::IterationCallback& callback,
+                                 Plan::IterationStats* stats)
 {
     std::vector<Event> events;
-    iterateAvailablePlansWithEvents(field, kumipuyoSeq, maxDepth, events, callback);
+    iterateAvailablePlansWithEvents(field, kumipuyoSeq, maxDepth, events, callback, stats);
 }
 
 // static
@@ -164,7 +229,8 @@ void Plan::iterateAvailablePlansWithEvents(const CoreField& field,
                                            const KumipuyoSeq& kumipuyoSeq,
                                            int maxDepth,
                                            const std::vector<Event>& events,
-                                           const Plan::IterationCallback& callback)
+                                           const Plan::IterationCallback& callback,
+                                           Plan::IterationStats* stats)
 {
     std::vector<Decision> decisions;
     decisions.reserve(maxDepth);
@@ -189,17 +255,19 @@ void Plan::iterateAvailablePlansWithEvents(const CoreField& field,
         }
     };
 
-    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, events, 0, 0, maxDepth, 0, 0, f);
+    PlanDeduplicator deduplicator(kumipuyoSeq, maxDepth, stats);
+    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, events, 0, 0, maxDepth, 0, 0, &deduplicator, f);
 }
 
 // static
 void Plan::iterateAvailablePlansWithoutFiring(const CoreField& field,
                                               const KumipuyoSeq& kumipuyoSeq,
                                               int maxDepth,
-                                              const Plan::RensaIterationCallback& callback)
+                                              const Plan::RensaIterationCallback& callback,
+                                              Plan::IterationStats* stats)
 {
     std::vector<Event> events;
-    iterateAvailablePlansWithoutFiringWithEvents(field, kumipuyoSeq, maxDepth, events, callback);
+    iterateAvailablePlansWithoutFiringWithEvents(field, kumipuyoSeq, maxDepth, events, callback, stats);
 }
 
 // static
@@ -207,9 +275,11 @@ void Plan::iterateAvailablePlansWithoutFiringWithEvents(const CoreField& field,
                                                         const KumipuyoSeq& kumipuyoSeq,
                                                         int maxDepth,
                                                         const std::vector<Event>& events,
-                                                        const Plan::RensaIterationCallback& callback)
+                                                        const Plan::RensaIterationCallback& callback,
+                                                        Plan::IterationStats* stats)
 {
     std::vector<Decision> decisions;
     decisions.reserve(maxDepth);
-    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, events, 0, 0, maxDepth, 0, 0, callback);
+    PlanDeduplicator deduplicator(kumipuyoSeq, maxDepth, stats);
+    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, events, 0, 0, maxDepth, 0, 0, &deduplicator, callback);
 }
@@ -47,19 +47,37 @@ public:
     {
     }
 
+    // Statistics of iterateAvailablePlans*().
+    // While the kumipuyos are known, a plan is pruned when another plan has already reached
+    // the same field at the same depth with no more frames and no more chigiris, e.g. the same
+    // kumipuyos are placed in the other order. So, the cheapest decisions are always iterated,
+    // but a more expensive plan which is found earlier is also iterated.
+    struct IterationStats {
+        // The number of the fields made by dropping a kumipuyo.
+        int numPlans = 0;
+        // The number of the fields which are pruned as duplicated.
+        int numPrunedPlans = 0;
+
+        double pruningRate() const { return numPlans > 0 ? static_cast<double>(numPrunedPlans) / numPlans : 0.0; }
+    };
+
     typedef std::function<void (const RefPlan&)> IterationCallback;
     // if |kumipuyos.size()| < |depth|, we will add extra kumipuyo.
-    static void iterateAvailablePlans(const CoreField&, const KumipuyoSeq&, int depth, const IterationCallback&);
+    static void iterateAvailablePlans(const CoreField&, const KumipuyoSeq&, int depth, const IterationCallback&,
+                                      IterationStats* stats = nullptr);
     // We assume events are sorted in increasing order of frames.
     static void iterateAvailablePlansWithEvents(const CoreField&, const KumipuyoSeq&, int depth,
-                                                const std::vector<Event>& events, const IterationCallback&);
+                                                const std::vector<Event>& events, const IterationCallback&,
+                                                IterationStats* stats = nullptr);
 
     typedef std::function<void (const CoreField&, const std::vector<Decision>&,
                                 int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire)> RensaIterationCallback;
-    static void iterateAvailablePlansWithoutFiring(const CoreField&, const KumipuyoSeq&, int depth, const RensaIterationCallback&);
+    static void iterateAvailablePlansWithoutFiring(const CoreField&, const KumipuyoSeq&, int depth, const RensaIterationCallback&,
+                                                   IterationStats* stats = nullptr);
     // We assume events are sorted in increasing order of frames.
     static void iterateAvailablePlansWithoutFiringWithEvents(const CoreField&, const KumipuyoSeq&, int depth,
-                                                             const std::vector<Event>& events, const RensaIterationCallback&);
+                                                             const std::vector<Event>& events, const RensaIterationCallback&,
+                                                             IterationStats* stats = nullptr);
 
     const CoreField& field() const { return field_; }
 
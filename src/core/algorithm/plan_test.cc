@@ -129,3 +129,38 @@ TEST(Plan, numChigiri)
 
     EXPECT_TRUE(found);
 }
+
+TEST(Plan, iterateAvailablePlansPrunesDuplicatedFields)
+{
+    CoreField field;
+    KumipuyoSeq seq("RBRB");
+
+    // (1, 0)-(2, 0) and (2, 0)-(1, 0) make the same field with the same cost.
+    const vector<Decision> decisions1 { Decision(1, 0), Decision(2, 0) };
+    const vector<Decision> decisions2 { Decision(2, 0), Decision(1, 0) };
+
+    int count = 0;
+    Plan::IterationStats stats;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan& plan) {
+        if (plan.decisions() == decisions1 || plan.decisions() == decisions2)
+            ++count;
+    }, &stats);
+
+    EXPECT_EQ(1, count);
+    EXPECT_LT(0, stats.numPrunedPlans);
+    EXPECT_LT(stats.numPrunedPlans, stats.numPlans);
+    EXPECT_DOUBLE_EQ(static_cast<double>(stats.numPrunedPlans) / stats.numPlans, stats.pruningRate());
+}
+
+TEST(Plan, iterateAvailablePlansDoesNotPruneDistinctKumipuyos)
+{
+    CoreField field;
+    KumipuyoSeq seq("RRBB");
+
+    int count = 0;
+    Plan::IterationStats stats;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan&) { ++count; }, &stats);
+
+    EXPECT_EQ(11 * 11, count);
+    EXPECT_EQ(0, stats.numPrunedPlans);
+}
@@ -4,9 +4,13 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 #include "base/base.h"
+#include "base/profiler.h"
+#include "core/algorithm/rensa_detector_cache.h"
 #include "core/column_puyo.h"
 #include "core/column_puyo_list.h"
 #include "core/core_field.h"
@@ -76,6 +80,24 @@ const int EXTENTIONS[][3][2] = {
     {{-1, 1}, { 0, 1}, { 0, 2}},
 };
 
+// Returns the number of puyos to drop on column |x| to make them vanish, where |colorBits|
+// is the puyos of the same color. 0 if more than |maxComplementPuyos| puyos are necessary.
+// Only bit operations are used, so we don't need to make a CoreField for the candidates
+// which won't fire.
+int countNecessaryPuyosToVanish(const CoreField& field, int x, FieldBits colorBits,
+                                int maxComplementPuyos, int maxPuyoHeight)
+{
+    // Puyos on the 13th row cannot be vanished.
+    const int maxY = std::min(std::min(FieldConstant::HEIGHT, maxPuyoHeight), field.height(x) + maxComplementPuyos);
+    for (int y = field.height(x) + 1; y <= maxY; ++y) {
+        colorBits.set(x, y);
+        if (FieldBits(x, y).expand4(colorBits).popcount() >= 4)
+            return y - field.height(x);
+    }
+
+    return 0;
+}
+
 }  // namespace anomymous
 
 // detectByDropStrategy complements puyos in |originalField|, and fires a rensa.
@@ -89,79 +111,94 @@ void RensaDetector::detectByDropStrategy(const CoreField& originalField,
                                          int maxPuyoHeight,
                                          const RensaDetector::ComplementCallback& callback)
 {
-    bool visited[FieldConstant::MAP_WIDTH][NUM_PUYO_COLORS] {};
-
-    FieldBits normalColorBits = originalField.bitField().normalColorBits();
-    FieldBits emptyBits = originalField.bitField().bits(PuyoColor::EMPTY);
-
-    FieldBits edgeBits = (normalColorBits & emptyBits.expandEdge()).maskedField12();
-
-    edgeBits.iterateBitPositions([&](int x, int y) {
-        DCHECK(originalField.isNormalColor(x, y));
+    const FieldBits emptyBits = originalField.bitField().bits(PuyoColor::EMPTY);
+    // The puyos whose left, upper, and right cell is empty.
+    const FieldBits leftEmptyBits = _mm_slli_si128(emptyBits, 2);
+    const FieldBits upperEmptyBits = _mm_srli_epi16(emptyBits, 1);
+    const FieldBits rightEmptyBits = _mm_srli_si128(emptyBits, 2);
+
+    // For each color, computes the puyos where we try to drop the same color puyos on
+    // the left, the same, and the right column with bit operations, instead of checking
+    // every edge puyo.
+    //
+    // The candidates are tried in the same order as iterating the edge puyos and then
+    // d = -1, 0, 1. So, the order of a candidate is (the bit position of the first puyo
+    // which makes it) * 3 + (d + 1). orderBits is the bitset of the orders, and
+    // candidates[order] has the column and the color of the candidate.
+    const int NUM_ORDERS = 128 * 3;
+    std::uint64_t orderBits[NUM_ORDERS / 64] {};
+    std::uint8_t candidates[NUM_ORDERS];
+    int orders[FieldConstant::MAP_WIDTH][NUM_NORMAL_PUYO_COLORS];
+    std::fill(&orders[0][0], &orders[0][0] + FieldConstant::MAP_WIDTH * NUM_NORMAL_PUYO_COLORS, NUM_ORDERS);
+
+    FieldBits colorBits[NUM_NORMAL_PUYO_COLORS];
+    for (int i = 0; i < NUM_NORMAL_PUYO_COLORS; ++i) {
+        colorBits[i] = originalField.bitField().bits(NORMAL_PUYO_COLORS[i]).maskedField12();
+
+        FieldBits triggerBits[3] {
+            colorBits[i] & leftEmptyBits,
+            colorBits[i] & upperEmptyBits,
+            colorBits[i] & rightEmptyBits,
+        };
 
-        PuyoColor c = originalField.color(x, y);
+        // If the first rensa is this, any rensa won't continue.
+        // This is like erasing the following X.
+        // ......
+        // .YXY..
+        // BZZZBB
+        // CAAACC
+        //
+        // So, we should be able to skip this.
+        if (purpose == PurposeForFindingRensa::FOR_FIRE)
+            triggerBits[1] = triggerBits[1] & colorBits[i].expandEdge();
 
-        // Drop puyo on
         for (int d = -1; d <= 1; ++d) {
-            if (prohibits[x + d])
-                continue;
+            triggerBits[d + 1].iterateBitPositions([&](int x, int y) {
+                int order = ((x << 4) | y) * 3 + (d + 1);
+                orders[x + d][i] = std::min(orders[x + d][i], order);
+            });
+        }
+    }
 
-            if (visited[x + d][ordinal(c)])
+    for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+        if (prohibits[x])
+            continue;
+        for (int i = 0; i < NUM_NORMAL_PUYO_COLORS; ++i) {
+            int order = orders[x][i];
+            if (order == NUM_ORDERS)
                 continue;
+            orderBits[order / 64] |= 1ULL << (order % 64);
+            candidates[order] = static_cast<std::uint8_t>((x << 2) | i);
+        }
+    }
 
-            if (x + d <= 0 || FieldConstant::WIDTH < x + d)
+    for (int k = 0; k < NUM_ORDERS / 64; ++k) {
+        for (std::uint64_t bits = orderBits[k]; bits != 0; bits &= bits - 1) {
+            const std::uint8_t candidate = candidates[k * 64 + __builtin_ctzll(bits)];
+            const int x = candidate >> 2;
+            const int i = candidate & 3;
+            const PuyoColor c = NORMAL_PUYO_COLORS[i];
+
+            // Only the candidates which will fire are materialized.
+            int necessaryPuyos = countNecessaryPuyosToVanish(originalField, x, colorBits[i],
+                                                             maxComplementPuyos, maxPuyoHeight);
+            if (necessaryPuyos == 0)
                 continue;
-            if (d == 0) {
-                if (!originalField.isEmpty(x, y + 1))
-                    continue;
-
-                // If the first rensa is this, any rensa won't continue.
-                // This is like erasing the following X.
-                // ......
-                // .YXY..
-                // BZZZBB
-                // CAAACC
-                //
-                // So, we should be able to skip this.
-                if (purpose == PurposeForFindingRensa::FOR_FIRE && !originalField.isConnectedPuyo(x, y))
-                    continue;
-            } else {
-                if (!originalField.isEmpty(x + d, y))
-                    continue;
-            }
 
-            visited[x + d][ordinal(c)] = true;
-
-            int necessaryPuyos = 0;
+            ColumnPuyoList cpl;
+            if (!cpl.add(x, c, necessaryPuyos))
+                continue;
 
-            bool ok = true;
             CoreField cf(originalField);
-            while (true) {
-                if (!cf.dropPuyoOnWithMaxHeight(x + d, c, maxPuyoHeight)) {
-                    ok = false;
-                    break;
-                }
-
-                ++necessaryPuyos;
-
-                if (maxComplementPuyos < necessaryPuyos) {
-                    ok = false;
-                    break;
-                }
-                if (cf.countConnectedPuyosMax4(x + d, cf.height(x + d), c) >= 4)
-                    break;
+            for (int j = 0; j < necessaryPuyos; ++j) {
+                bool dropped = cf.dropPuyoOnWithMaxHeight(x, c, maxPuyoHeight);
+                DCHECK(dropped);
+                UNUSED_VARIABLE(dropped);
             }
 
-            if (!ok)
-                continue;
-
-            ColumnPuyoList cpl;
-            if (!cpl.add(x + d, c, necessaryPuyos))
-                continue;
-
             callback(std::move(cf), cpl);
         }
-    });
+    }
 }
 
 // static
@@ -470,11 +507,16 @@ void RensaDetector::detectSingle(const CoreField& cf,
 void RensaDetector::detectIteratively(const CoreField& originalField,
                                       const RensaDetectorStrategy& strategy,
                                       int maxIteration,
-                                      const RensaSimulationCallback& callback)
+                                      const RensaSimulationCallback& callback,
+                                      const CancellationToken& cancellationToken)
 {
+    PROFILE_SCOPE("RensaDetector::detectIteratively");
     DCHECK_LE(1, maxIteration);
 
     auto detectCallback = [&](CoreField&& complementedField, const ColumnPuyoList& firePuyos) {
+        if (cancellationToken.shouldStop())
+            return;
+
         CoreField cf(complementedField);
         RensaLastVanishedPositionTracker tracker;
 
@@ -488,13 +530,48 @@ void RensaDetector::detectIteratively(const CoreField& originalField,
         bool prohibits[FieldConstant::MAP_WIDTH] {};
         makeProhibitArray(originalField, strategy, tracker.result(), firePuyos, prohibits);
         detectIterativelyInternal(originalField, strategy, cf, maxIteration - 1,
-                                  ColumnPuyoList(), firePuyos, chains, prohibits, callback);
+                                  ColumnPuyoList(), firePuyos, chains, prohibits, callback, cancellationToken);
     };
 
     bool prohibits[FieldConstant::MAP_WIDTH] {};
     detect(originalField, strategy, PurposeForFindingRensa::FOR_FIRE, prohibits, detectCallback);
 }
 
+// static
+void RensaDetector::detectIterativelyWithCache(const CoreField& originalField,
+                                               const RensaDetectorStrategy& strategy,
+                                               int maxIteration,
+                                               RensaDetectorCache* cache,
+                                               const SimulatedRensaCallback& callback,
+                                               const CancellationToken& cancellationToken)
+{
+    if (cache) {
+        if (auto detectedRensas = cache->get(originalField, strategy, maxIteration)) {
+            for (const auto& detected : *detectedRensas) {
+                if (cancellationToken.shouldStop())
+                    return;
+                CoreField cf(detected.fieldAfterRensa);
+                callback(std::move(cf), detected.complementedColumnPuyoList, detected.rensaResult, detected.coefResult);
+            }
+            return;
+        }
+    }
+
+    auto detectedRensas = std::make_shared<RensaDetectorCache::DetectedRensas>();
+    auto detectCallback = [&](CoreField&& complementedField, const ColumnPuyoList& cpl) -> RensaResult {
+        RensaCoefTracker tracker;
+        RensaResult rensaResult = complementedField.simulate(&tracker);
+        if (cache)
+            detectedRensas->emplace_back(complementedField, cpl, rensaResult, tracker.result());
+        callback(std::move(complementedField), cpl, rensaResult, tracker.result());
+        return rensaResult;
+    };
+    detectIteratively(originalField, strategy, maxIteration, detectCallback, cancellationToken);
+
+    if (cache && !cancellationToken.shouldStop())
+        cache->put(originalField, strategy, maxIteration, std::move(detectedRensas));
+}
+
 // static
 void RensaDetector::detectIterativelyInternal(const CoreField& originalField,
                                               const RensaDetectorStrategy& strategy,
@@ -504,12 +581,16 @@ void RensaDetector::detectIterativelyInternal(const CoreField& originalField,
                                               const ColumnPuyoList& firstRensaFirePuyos,
                                               int currentTotalChains,
                                               const bool prohibits[FieldConstant::MAP_WIDTH],
-                                              const RensaSimulationCallback& callback)
+                                              const RensaSimulationCallback& callback,
+                                              const CancellationToken& cancellationToken)
 {
     if (restIterations <= 0)
         return;
 
     auto detectCallback = [&](CoreField&& complementedField, const ColumnPuyoList& currentFirePuyos) {
+        if (cancellationToken.shouldStop())
+            return;
+
         RensaLastVanishedPositionTracker tracker;
         int partialChains = complementedField.simulateFast(&tracker);
         if (partialChains == 0)
@@ -551,7 +632,7 @@ void RensaDetector::detectIterativelyInternal(const CoreField& originalField,
 
         detectIterativelyInternal(originalField, strategy, complementedField,
                                   restIterations - 1, combinedKeyPuyos, firstRensaFirePuyos,
-                                  combinedRensaResult.chains, newProhibits, callback);
+                                  combinedRensaResult.chains, newProhibits, callback, cancellationToken);
     };
 
     detect(currentField, strategy, PurposeForFindingRensa::FOR_KEY, prohibits, detectCallback);
@@ -4,12 +4,15 @@
 #include <functional>
 
 #include "base/base.h"
+#include "base/cancellation_token.h"
 #include "core/algorithm/rensa_detector_strategy.h"
 #include "core/core_field.h"
 #include "core/field_constant.h"
+#include "core/rensa_tracker/rensa_coef_tracker.h"
 #include "core/rensa_tracker/rensa_last_vanished_position_tracker.h"
 
 class ColumnPuyoList;
+class RensaDetectorCache;
 struct RensaResult;
 
 enum class PurposeForFindingRensa {
@@ -27,6 +30,11 @@ public:
     typedef std::function<RensaResult (CoreField&& complementedField,
                                        const ColumnPuyoList& complementedColumnPuyoList)> RensaSimulationCallback;
 
+    typedef std::function<void (CoreField&& fieldAfterRensa,
+                                const ColumnPuyoList& complementedColumnPuyoList,
+                                const RensaResult& rensaResult,
+                                const RensaCoefResult& coefResult)> SimulatedRensaCallback;
+
     // Detects a rensa from the field with the specified strategy.
     static void detectSingle(const CoreField&,
                              const RensaDetectorStrategy&,
@@ -38,10 +46,25 @@ public:
     // 2. Try to detect another rensa after the field where the previous rensa is finished.
     // 3. Complement 2's ColumnPuyoList, and 1's ColumnPuyoList, and check the size of rensa.
     // Do (2)-(3) |maxIteration - 1| times.
+    // Once |cancellationToken| says to stop, |callback| won't be called any more.
     static void detectIteratively(const CoreField&,
                                   const RensaDetectorStrategy&,
                                   int maxIteration,
-                                  const RensaSimulationCallback&);
+                                  const RensaSimulationCallback&,
+                                  const CancellationToken& cancellationToken = CancellationToken());
+
+    // Same as detectIteratively(), but the detected rensas are memoized in |cache|.
+    // When the rensas from the same field are detected with the same strategy and maxIteration again,
+    // |callback| is called with the memoized rensas, which is almost free.
+    // Since the memoized rensas must not depend on |callback|, the complemented field is simulated
+    // here with RensaCoefTracker, and the field after the rensa and the results are passed to |callback|.
+    // |cache| can be nullptr. The detection cancelled by |cancellationToken| is not memoized.
+    static void detectIterativelyWithCache(const CoreField&,
+                                           const RensaDetectorStrategy&,
+                                           int maxIteration,
+                                           RensaDetectorCache* cache,
+                                           const SimulatedRensaCallback&,
+                                           const CancellationToken& cancellationToken = CancellationToken());
 
     // Finds 2-double (or more).
     static void detectSideChain(const CoreField&,
@@ -107,7 +130,8 @@ private:
                                           const ColumnPuyoList& firstRensaFirePuyos,
                                           int currentTotalChains,
                                           const bool prohibits[FieldConstant::MAP_WIDTH],
-                                          const RensaSimulationCallback&);
+                                          const RensaSimulationCallback&,
+                                          const CancellationToken&);
 
     static void complementKeyPuyos13thRowInternal(CoreField& currentField,
                                                   ColumnPuyoList& currentKeyPuyos,
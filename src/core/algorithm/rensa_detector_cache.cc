@@ -0,0 +1,18 @@
+#include "core/algorithm/rensa_detector_cache.h"
+
+using namespace std;
+
+shared_ptr<const RensaDetectorCache::DetectedRensas>
+RensaDetectorCache::get(const CoreField& field, const RensaDetectorStrategy& strategy, int maxIteration)
+{
+    shared_ptr<const DetectedRensas> detectedRensas;
+    if (!cache_.get(Key(field, strategy, maxIteration), &detectedRensas))
+        return nullptr;
+    return detectedRensas;
+}
+
+void RensaDetectorCache::put(const CoreField& field, const RensaDetectorStrategy& strategy, int maxIteration,
+                             shared_ptr<const DetectedRensas> detectedRensas)
+{
+    cache_.put(Key(field, strategy, maxIteration), std::move(detectedRensas));
+}
@@ -0,0 +1,88 @@
+#ifndef CORE_ALGORITHM_RENSA_DETECTOR_CACHE_H_
+#define CORE_ALGORITHM_RENSA_DETECTOR_CACHE_H_
+
+#include <memory>
+#include <vector>
+
+#include "base/generation_cache.h"
+#include "base/noncopyable.h"
+#include "core/algorithm/rensa_detector_strategy.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/rensa_result.h"
+#include "core/rensa_tracker/rensa_coef_tracker.h"
+
+// RensaDetectorCache memoizes the rensas detected by RensaDetector::detectIterativelyWithCache().
+// The detected rensas depend only on the field, the strategy, and the max iteration,
+// so they are used as the key. Evaluators often detect rensas from the same field
+// across consecutive frames (e.g. the enemy field while gazing), and such detection becomes
+// almost free.
+// This class is thread-safe.
+class RensaDetectorCache : noncopyable {
+public:
+    static const size_t DEFAULT_MAX_SIZE = 1 << 12;
+
+    struct DetectedRensa {
+        DetectedRensa(const CoreField& fieldAfterRensa,
+                      const ColumnPuyoList& complementedColumnPuyoList,
+                      const RensaResult& rensaResult,
+                      const RensaCoefResult& coefResult) :
+            fieldAfterRensa(fieldAfterRensa),
+            complementedColumnPuyoList(complementedColumnPuyoList),
+            rensaResult(rensaResult),
+            coefResult(coefResult)
+        {
+        }
+
+        CoreField fieldAfterRensa;
+        ColumnPuyoList complementedColumnPuyoList;
+        RensaResult rensaResult;
+        RensaCoefResult coefResult;
+    };
+    typedef std::vector<DetectedRensa> DetectedRensas;
+
+    explicit RensaDetectorCache(size_t maxSize = DEFAULT_MAX_SIZE) : cache_(maxSize) {}
+
+    // Returns the detected rensas if they are cached. Otherwise, nullptr is returned.
+    std::shared_ptr<const DetectedRensas> get(const CoreField&, const RensaDetectorStrategy&, int maxIteration);
+    // When the cache is full, the old entries are evicted. See GenerationCache::put().
+    void put(const CoreField&, const RensaDetectorStrategy&, int maxIteration,
+             std::shared_ptr<const DetectedRensas> detectedRensas);
+
+    // Starts a new generation. See GenerationCache::nextGeneration().
+    void nextGeneration() { cache_.nextGeneration(); }
+    void clear() { cache_.clear(); }
+
+    size_t size() const { return cache_.size(); }
+    int numHits() const { return cache_.numHits(); }
+    int numMisses() const { return cache_.numMisses(); }
+    double hitRate() const { return cache_.hitRate(); }
+
+private:
+    struct Key {
+        Key(const CoreField& field, const RensaDetectorStrategy& strategy, int maxIteration) :
+            field(field), strategy(strategy), maxIteration(maxIteration) {}
+
+        friend bool operator==(const Key& lhs, const Key& rhs)
+        {
+            return lhs.maxIteration == rhs.maxIteration &&
+                lhs.strategy == rhs.strategy &&
+                lhs.field == rhs.field;
+        }
+
+        CoreField field;
+        RensaDetectorStrategy strategy;
+        int maxIteration;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const
+        {
+            return (key.field.hash() * 31 + static_cast<size_t>(key.strategy.mode()) * 7) + key.maxIteration;
+        }
+    };
+
+    GenerationCache<Key, std::shared_ptr<const DetectedRensas>, KeyHash> cache_;
+};
+
+#endif // CORE_ALGORITHM_RENSA_DETECTOR_CACHE_H_
@@ -0,0 +1,40 @@
+#include "core/algorithm/rensa_detector_cache.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+shared_ptr<const RensaDetectorCache::DetectedRensas> makeDetectedRensas(const CoreField& field, int chains)
+{
+    auto detectedRensas = make_shared<RensaDetectorCache::DetectedRensas>();
+    detectedRensas->emplace_back(field, ColumnPuyoList(), RensaResult(chains, 40 * chains, 0, false), RensaCoefResult());
+    return detectedRensas;
+}
+
+} // namespace anonymous
+
+TEST(RensaDetectorCacheTest, getAndPut)
+{
+    const CoreField field("RRR...");
+    const RensaDetectorStrategy strategy = RensaDetectorStrategy::defaultDropStrategy();
+
+    RensaDetectorCache cache;
+    EXPECT_EQ(0.0, cache.hitRate());
+    EXPECT_FALSE(cache.get(field, strategy, 3));
+
+    cache.put(field, strategy, 3, makeDetectedRensas(field, 1));
+    auto detectedRensas = cache.get(field, strategy, 3);
+    ASSERT_TRUE(detectedRensas.get());
+    ASSERT_EQ(1U, detectedRensas->size());
+    EXPECT_EQ(1, detectedRensas->front().rensaResult.chains);
+
+    EXPECT_FALSE(cache.get(field, strategy, 2));
+    EXPECT_FALSE(cache.get(field, RensaDetectorStrategy::defaultFloatStrategy(), 3));
+    EXPECT_FALSE(cache.get(CoreField("RRRB.."), strategy, 3));
+
+    EXPECT_EQ(1, cache.numHits());
+    EXPECT_EQ(4, cache.numMisses());
+    EXPECT_DOUBLE_EQ(0.2, cache.hitRate());
+}
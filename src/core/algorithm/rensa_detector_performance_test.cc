@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "base/time_stamp_counter.h"
+#include "core/algorithm/rensa_detector_cache.h"
 #include "core/core_field.h"
 
 class ColumnPuyoList;
@@ -79,3 +80,62 @@ TEST(RensaDetectorPerformanceTest, detectIteratively_Extend)
 
     tsc.showStatistics();
 }
+
+TEST(RensaDetectorPerformanceTest, detectByDropStrategy)
+{
+    TimeStampCounterData tsc;
+
+    const CoreField original(
+        "  B   "
+        " YRG  "
+        "RBGYBY"
+        "RRYBBG"
+        "BGRGYR"
+        "RBGYBR"
+        "RRYGBB");
+
+    const bool prohibits[FieldConstant::MAP_WIDTH] {};
+    int count = 0;
+    auto callback = [&](CoreField&&, const ColumnPuyoList&) {
+        ++count;
+    };
+
+    for (int i = 0; i < 100000; ++i) {
+        ScopedTimeStampCounter stsc(&tsc);
+        RensaDetector::detectByDropStrategy(original, prohibits, PurposeForFindingRensa::FOR_FIRE, 3, 12, callback);
+    }
+
+    cout << "callbacks: " << count / 100000 << endl;
+    tsc.showStatistics();
+}
+
+TEST(RensaDetectorPerformanceTest, detectIterativelyWithCache_Drop)
+{
+    TimeStampCounterData tscMiss;
+    TimeStampCounterData tscHit;
+
+    const CoreField original(
+        "  R G "
+        "R GRBG"
+        "RBGRBG"
+        "RBGRBG");
+
+    auto callback = [&](CoreField&&, const ColumnPuyoList&, const RensaResult&, const RensaCoefResult&) {};
+
+    for (int i = 0; i < 10000; ++i) {
+        RensaDetectorCache cache;
+        {
+            ScopedTimeStampCounter stsc(&tscMiss);
+            RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultDropStrategy(), 3, &cache, callback);
+        }
+        {
+            ScopedTimeStampCounter stsc(&tscHit);
+            RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultDropStrategy(), 3, &cache, callback);
+        }
+    }
+
+    cout << "miss: " << endl;
+    tscMiss.showStatistics();
+    cout << "hit: " << endl;
+    tscHit.showStatistics();
+}
@@ -28,6 +28,15 @@ public:
     bool allowsPuttingKeyPuyoOn13thRow() const { return allowsPuttingKeyPuyoOn13thRow_; }
     int maxKeyPuyoHeight() const { return allowsPuttingKeyPuyoOn13thRow() ? 13 : 12; }
 
+    friend bool operator==(const RensaDetectorStrategy& lhs, const RensaDetectorStrategy& rhs)
+    {
+        return lhs.mode_ == rhs.mode_ &&
+            lhs.maxNumOfComplementPuyosForKey_ == rhs.maxNumOfComplementPuyosForKey_ &&
+            lhs.maxNumOfComplementPuyosForFire_ == rhs.maxNumOfComplementPuyosForFire_ &&
+            lhs.allowsPuttingKeyPuyoOn13thRow_ == rhs.allowsPuttingKeyPuyoOn13thRow_;
+    }
+    friend bool operator!=(const RensaDetectorStrategy& lhs, const RensaDetectorStrategy& rhs) { return !(lhs == rhs); }
+
 private:
     Mode mode_;
     int maxNumOfComplementPuyosForKey_;
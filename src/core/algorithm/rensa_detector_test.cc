@@ -5,8 +5,10 @@
 #include <cstddef>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/base.h"
+#include "core/algorithm/rensa_detector_cache.h"
 #include "core/column_puyo.h"
 #include "core/column_puyo_list.h"
 #include "core/core_field.h"
@@ -47,6 +49,46 @@ TEST(RensaDetectorTest, detectByDropStrategy1)
     EXPECT_TRUE(found);
 }
 
+TEST(RensaDetectorTest, detectByDropStrategy2)
+{
+    const CoreField original(
+        ".B...."
+        "RB....");
+
+    const CoreField expected(
+        "R....."
+        "R....."
+        "RB...."
+        "RB....");
+
+    const bool noProhibits[FieldConstant::MAP_WIDTH] {};
+    // 3 puyos are necessary.
+    for (int maxComplementPuyos = 1; maxComplementPuyos <= 4; ++maxComplementPuyos) {
+        for (int maxPuyoHeight = 3; maxPuyoHeight <= 4; ++maxPuyoHeight) {
+            int numFound = 0;
+            int numCallbacks = 0;
+            auto callback = [&](const CoreField& actual, const ColumnPuyoList& cpl) {
+                ++numCallbacks;
+                CoreField cf(original);
+                EXPECT_TRUE(cf.dropPuyoList(cpl));
+                EXPECT_EQ(cf, actual);
+                if (actual == expected)
+                    ++numFound;
+            };
+
+            RensaDetector::detectByDropStrategy(original, noProhibits, PurposeForFindingRensa::FOR_KEY,
+                                                maxComplementPuyos, maxPuyoHeight, callback);
+
+            EXPECT_EQ(maxComplementPuyos >= 3 && maxPuyoHeight >= 4 ? 1 : 0, numFound)
+                << maxComplementPuyos << ' ' << maxPuyoHeight;
+            // BB on column 1 and 3 (and column 2 if height 4 is allowed) will also fire.
+            int numBlueCallbacks = maxComplementPuyos >= 2 ? (maxPuyoHeight >= 4 ? 3 : 2) : 0;
+            EXPECT_EQ(numFound + numBlueCallbacks, numCallbacks)
+                << maxComplementPuyos << ' ' << maxPuyoHeight;
+        }
+    }
+}
+
 TEST(RensaDetectorTest, detectByFloatStrategy1)
 {
     const CoreField original(
@@ -674,6 +716,94 @@ TEST(RensaDetectorTest, detectIteratively_depth3_1)
     EXPECT_TRUE(foundExpected);
 }
 
+TEST(RensaDetectorTest, detectIterativelyCancelled)
+{
+    const CoreField original(
+        "  G   "
+        "RBBBR ");
+
+    CancellationToken token = CancellationToken::create();
+    int numCalled = 0;
+    auto callback = [&](CoreField&& complementedField, const ColumnPuyoList&) -> RensaResult {
+        ++numCalled;
+        token.cancel();
+        return complementedField.simulate();
+    };
+
+    RensaDetector::detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 3, callback, token);
+
+    EXPECT_EQ(1, numCalled);
+}
+
+TEST(RensaDetectorTest, detectIterativelyWithCache)
+{
+    const CoreField original(
+        "  G   "
+        "RBBBR ");
+
+    vector<pair<ColumnPuyoList, RensaResult>> expected;
+    auto callback = [&](CoreField&& complementedField, const ColumnPuyoList& cpl) -> RensaResult {
+        RensaResult rensaResult = complementedField.simulate();
+        expected.emplace_back(cpl, rensaResult);
+        return rensaResult;
+    };
+    RensaDetector::detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 3, callback);
+    ASSERT_FALSE(expected.empty());
+
+    RensaDetectorCache cache;
+    for (int i = 0; i < 2; ++i) {
+        vector<pair<ColumnPuyoList, RensaResult>> actual;
+        auto cachedCallback = [&](CoreField&& fieldAfterRensa, const ColumnPuyoList& cpl,
+                                  const RensaResult& rensaResult, const RensaCoefResult& coefResult) {
+            CoreField cf(original);
+            EXPECT_TRUE(cf.dropPuyoList(cpl));
+            RensaCoefTracker tracker;
+            EXPECT_EQ(rensaResult, cf.simulate(&tracker));
+            EXPECT_EQ(cf, fieldAfterRensa);
+            for (int nth = 1; nth <= rensaResult.chains; ++nth) {
+                EXPECT_EQ(tracker.result().numErased(nth), coefResult.numErased(nth));
+                EXPECT_EQ(tracker.result().coef(nth), coefResult.coef(nth));
+            }
+            actual.emplace_back(cpl, rensaResult);
+        };
+        RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultDropStrategy(), 3, &cache, cachedCallback);
+        EXPECT_EQ(expected, actual);
+    }
+
+    EXPECT_EQ(1, cache.numHits());
+    EXPECT_EQ(1, cache.numMisses());
+
+    // Another strategy or iteration is not the same rensa.
+    RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultDropStrategy(), 2, &cache,
+                                              [](CoreField&&, const ColumnPuyoList&, const RensaResult&, const RensaCoefResult&) {});
+    RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultFloatStrategy(), 3, &cache,
+                                              [](CoreField&&, const ColumnPuyoList&, const RensaResult&, const RensaCoefResult&) {});
+    EXPECT_EQ(1, cache.numHits());
+    EXPECT_EQ(3, cache.numMisses());
+    EXPECT_EQ(3U, cache.size());
+}
+
+TEST(RensaDetectorTest, detectIterativelyWithCacheCancelled)
+{
+    const CoreField original(
+        "  G   "
+        "RBBBR ");
+
+    CancellationToken token = CancellationToken::create();
+    RensaDetectorCache cache;
+    int numCalled = 0;
+    auto callback = [&](CoreField&&, const ColumnPuyoList&, const RensaResult&, const RensaCoefResult&) {
+        ++numCalled;
+        token.cancel();
+    };
+
+    RensaDetector::detectIterativelyWithCache(original, RensaDetectorStrategy::defaultDropStrategy(), 3, &cache, callback, token);
+
+    EXPECT_EQ(1, numCalled);
+    // The partial result should not be cached.
+    EXPECT_EQ(0U, cache.size());
+}
+
 TEST(RensaDetectorTest, detectIteratively_depth3_2)
 {
     const CoreField original(
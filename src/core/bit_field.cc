@@ -5,6 +5,7 @@
 
 #include <sstream>
 
+#include "base/cpu.h"
 #include "core/frame.h"
 #include "core/plain_field.h"
 #include "core/position.h"
@@ -12,10 +13,54 @@
 
 using namespace std;
 
+namespace {
+
+BitField::Kernel detectKernel()
+{
+#ifdef HAVE_TARGET_AVX2_BMI2
+    if (cpu::hasAVX2() && cpu::hasBMI2())
+        return cpu::hasFastBMI2() ? BitField::Kernel::AVX2_BMI2 : BitField::Kernel::AVX2;
+#endif
+    return BitField::Kernel::SSE;
+}
+
+} // namespace anonymous
+
+// SSE is used until this is initialized, since it's zero-initialized first.
+BitField::Kernel BitField::s_kernel = detectKernel();
+
+// static
+bool BitField::isKernelSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::SSE:
+        return true;
+#ifdef HAVE_TARGET_AVX2_BMI2
+    case Kernel::AVX2:
+    case Kernel::AVX2_BMI2:
+        // AVX2_BMI2 is supported even if PDEP and PEXT are slow.
+        return cpu::hasAVX2() && cpu::hasBMI2();
+#else
+    case Kernel::AVX2:
+    case Kernel::AVX2_BMI2:
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+// static
+void BitField::setKernel(Kernel kernel)
+{
+    CHECK(isKernelSupported(kernel));
+    s_kernel = kernel;
+}
+
 BitField::BitField()
 {
     // Sets WALL
-    m_[1].setAll(_mm_set_epi16(0xFFFF, 0x8001, 0x8001, 0x8001, 0x8001, 0x8001, 0x8001, 0xFFFF));
+    setColorAll(_mm_set_epi16(0xFFFF, 0x8001, 0x8001, 0x8001, 0x8001, 0x8001, 0x8001, 0xFFFF), PuyoColor::WALL);
 }
 
 BitField::BitField(const PlainField& pf) : BitField()
@@ -49,12 +94,16 @@ BitField::BitField(const PlainField& pf) : BitField()
         xmm.s[6] = _mm_movemask_epi8(_mm_cmpeq_epi8(m6, mask));
         xmm.s[7] = 0;
 
+#ifdef BIT_FIELD_PER_COLOR_LAYOUT
+        m_[ordinal(c) - 1].setAll(FieldBits(xmm.m));
+#else
         if (ordinal(c) & 1)
             m_[0].setAll(FieldBits(xmm.m));
         if (ordinal(c) & 2)
             m_[1].setAll(FieldBits(xmm.m));
         if (ordinal(c) & 4)
             m_[2].setAll(FieldBits(xmm.m));
+#endif
     }
 }
 
@@ -169,15 +218,15 @@ size_t BitField::hash() const
     static_assert(sizeof(std::uint64_t) == sizeof(size_t), "assumed 64bit");
 
     union {
-        std::uint64_t v[6];
-        __m128i m[3];
+        std::uint64_t v[NUM_PLANES * 2];
+        __m128i m[NUM_PLANES];
     };
 
-    for (int i = 0; i < 3; ++i)
+    for (int i = 0; i < NUM_PLANES; ++i)
         m[i] = m_[i].xmm();
 
     size_t r = 0;
-    for (int i = 0; i < 6; ++i)
+    for (int i = 0; i < NUM_PLANES * 2; ++i)
         r = r * p + v[i];
 
     return r;
@@ -185,7 +234,7 @@ size_t BitField::hash() const
 
 bool operator==(const BitField& lhs, const BitField& rhs)
 {
-    for (int i = 0; i < 3; ++i)
+    for (int i = 0; i < BitField::NUM_PLANES; ++i)
         if (lhs.m_[i] != rhs.m_[i])
             return false;
     return true;
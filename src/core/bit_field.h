@@ -1,6 +1,7 @@
 #ifndef CORE_BIT_FIELD_H_
 #define CORE_BIT_FIELD_H_
 
+#include <cstdint>
 #include <string>
 
 #include <glog/logging.h>
@@ -18,6 +19,14 @@ class PlainField;
 struct Position;
 
 // BitsField is a field implementation that uses FieldBits.
+//
+// The layout of the colors is selected at compile time.
+// - By default, the colors are stored in 3 bit-planes. The i-th plane has the i-th bit of
+//   each PuyoColor. This is small (48 bytes), so copying is cheap.
+// - If BIT_FIELD_PER_COLOR_LAYOUT is defined (cmake -DPUYOAI_BIT_FIELD_PER_COLOR=ON), each color
+//   except EMPTY has its own plane. bits(c) doesn't need any computation, but BitField is
+//   112 bytes, and taking the non-empty cells needs more computation.
+// See bit_field_performance_test.cc to compare them.
 class BitField {
 public:
     struct SimulationContext {
@@ -26,28 +35,44 @@ public:
         int currentChain = 1;
     };
 
+    // Kernel is the implementation of simulation. The fastest kernel which the running CPU
+    // supports is selected at startup, so the same binary can run on any CPU.
+    // CoreField dispatches simulate(), vanishDrop() etc. to the selected kernel.
+    enum class Kernel {
+        SSE,        // simulate(), vanishDrop() etc.
+        AVX2,       // simulateAVX2(), vanishDropAVX2() etc. Puyos are dropped without PDEP/PEXT.
+        AVX2_BMI2,  // simulateAVX2(), vanishDropAVX2() etc. Puyos are dropped with PDEP/PEXT.
+    };
+
+    static Kernel kernel() { return s_kernel; }
+    static bool isKernelSupported(Kernel);
+    // Changes the kernel for benchmarks and tests. Call this before starting simulations in
+    // other threads. The kernel must be supported.
+    static void setKernel(Kernel);
+
     BitField();
     explicit BitField(const PlainField&);
     explicit BitField(const std::string&);
 
     FieldBits bits(PuyoColor c) const;
-    FieldBits normalColorBits() const { return m_[2]; }
-    FieldBits field13Bits() const { return (m_[0] | m_[1] | m_[2]).maskedField13(); }
+    FieldBits normalColorBits() const;
+    FieldBits field13Bits() const { return nonEmptyBits().maskedField13(); }
 
-    FieldBits differentBits(const BitField& bf) const {
-        return (m_[0] ^ bf.m_[0]) | (m_[1] ^ bf.m_[1]) | (m_[2] ^ bf.m_[2]);
-    }
+    FieldBits differentBits(const BitField& bf) const;
 
     PuyoColor color(int x, int y) const;
     bool isColor(int x, int y, PuyoColor c) const { return bits(c).get(x, y); }
-    bool isNormalColor(int x, int y) const { return m_[2].get(x, y); }
-    bool isEmpty(int x, int y) const { return !(m_[0] | m_[1] | m_[2]).get(x, y); }
+    bool isNormalColor(int x, int y) const { return normalColorBits().get(x, y); }
+    bool isEmpty(int x, int y) const { return !nonEmptyBits().get(x, y); }
 
     void setColor(int x, int y, PuyoColor c);
     void setColorAll(FieldBits, PuyoColor);
     void setColorAllIfEmpty(FieldBits, PuyoColor);
+    // Sets the colors on column |x| from row |y| at once. |colorBits[i]| has the i-th bit of
+    // each PuyoColor from the bottom. See ColumnPuyoList::colorBitsOn(). The cells must be empty.
+    void setColumnColorBits(int x, int y, const std::uint32_t colorBits[3]);
 
-    bool isZenkeshi() const { return FieldBits(m_[0] | m_[1] | m_[2]).maskedField13().isEmpty(); }
+    bool isZenkeshi() const { return nonEmptyBits().maskedField13().isEmpty(); }
 
     bool isConnectedPuyo(int x, int y) const { return isConnectedPuyo(x, y, color(x, y)); }
     bool isConnectedPuyo(int x, int y, PuyoColor c) const;
@@ -65,6 +90,12 @@ public:
     template<typename Tracker> RensaResult simulate(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
     // Faster version of simulate(). Returns the number of chains.
     template<typename Tracker> int simulateFast(Tracker*);
+    // Bounded versions of simulateFast() and simulate(). They stop as soon as the bound is reached,
+    // and the field is left in the middle of the rensa in that case.
+    // Simulates at most |maxChains| chains. Returns the number of the simulated chains.
+    template<typename Tracker> int simulateFastUntil(int maxChains, Tracker*);
+    // Simulates until the score reaches |minScore|. Returns the result of the simulated chains.
+    template<typename Tracker> RensaResult simulateUntilScore(int minScore, SimulationContext*, Tracker*);
     // Vanishes the connected puyos, and drop the puyos in the air. Score will be returned.
     template<typename Tracker> RensaStepResult vanishDrop(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
     template<typename Tracker> bool vanishDropFast(SimulationContext*, Tracker*);
@@ -88,15 +119,31 @@ public:
     friend bool operator==(const BitField&, const BitField&);
     friend std::ostream& operator<<(std::ostream&, const BitField&);
 
-#if defined(__AVX2__) && defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
     // Faster version of simulate() that uses AVX2 instruction set.
-    template<typename Tracker> RensaResult simulateAVX2(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
-    template<typename Tracker> int simulateFastAVX2(Tracker*);
-    template<typename Tracker> RensaStepResult vanishDropAVX2(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
-    template<typename Tracker> bool vanishDropFastAVX2(SimulationContext*, Tracker*);
+    // Call these only when the kernel is AVX2 or AVX2_BMI2, which decides how puyos are dropped.
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaResult simulateAVX2(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
+    template<typename Tracker> TARGET_AVX2_BMI2 int simulateFastAVX2(Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 int simulateFastUntilAVX2(int maxChains, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaResult simulateUntilScoreAVX2(int minScore, SimulationContext*, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaStepResult vanishDropAVX2(SimulationContext*, Tracker*) NOINLINE_UNLESS_RELEASE;
+    template<typename Tracker> TARGET_AVX2_BMI2 bool vanishDropFastAVX2(SimulationContext*, Tracker*);
 #endif
 
 private:
+#ifdef BIT_FIELD_PER_COLOR_LAYOUT
+    // m_[ordinal(c) - 1] has the cells of PuyoColor c.
+    static const int NUM_PLANES = NUM_PUYO_COLORS - 1;
+#else
+    // m_[i] has the i-th bit of PuyoColor.
+    static const int NUM_PLANES = 3;
+#endif
+
+    FieldBits nonEmptyBits() const;
+    // Sets the cells of 2 normal colors in field 12 to |high| and |low|.
+    // i == 0: BLUE and RED. i == 1: GREEN and YELLOW.
+    void normalColorPairBits(int i, FieldBits* high, FieldBits* low) const;
+
     BitField escapeInvisible();
     void recoverInvisible(const BitField&);
 
@@ -114,20 +161,87 @@ private:
     template<typename Tracker>
     void dropAfterVanishFast(FieldBits erased, Tracker* tracker);
 
-#if defined(__AVX2__) && defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
     template<typename Tracker>
-    int vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
+    TARGET_AVX2_BMI2 int vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
     template<typename Tracker>
-    bool vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
+    TARGET_AVX2_BMI2 bool vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
     template<typename Tracker>
-    int dropAfterVanishAVX2(FieldBits erased, Tracker* tracker);
+    TARGET_AVX2_BMI2 int dropAfterVanishAVX2(FieldBits erased, Tracker* tracker);
     template<typename Tracker>
-    void dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker);
+    TARGET_AVX2_BMI2 void dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker);
 #endif
 
-    FieldBits m_[3];
+    static Kernel s_kernel;
+
+    FieldBits m_[NUM_PLANES];
 };
 
+#ifdef BIT_FIELD_PER_COLOR_LAYOUT
+
+inline
+FieldBits BitField::bits(PuyoColor c) const
+{
+    if (c == PuyoColor::EMPTY)
+        return nonEmptyBits() ^ sse::mm_setone_si128();
+    return m_[ordinal(c) - 1];
+}
+
+inline
+FieldBits BitField::normalColorBits() const
+{
+    return (m_[ordinal(PuyoColor::RED) - 1] | m_[ordinal(PuyoColor::BLUE) - 1]) |
+        (m_[ordinal(PuyoColor::YELLOW) - 1] | m_[ordinal(PuyoColor::GREEN) - 1]);
+}
+
+inline
+FieldBits BitField::nonEmptyBits() const
+{
+    return ((m_[0] | m_[1]) | (m_[2] | m_[3])) | ((m_[4] | m_[5]) | m_[6]);
+}
+
+inline
+void BitField::normalColorPairBits(int i, FieldBits* high, FieldBits* low) const
+{
+    if (i == 0) {
+        *high = m_[ordinal(PuyoColor::BLUE) - 1].maskedField12();
+        *low = m_[ordinal(PuyoColor::RED) - 1].maskedField12();
+    } else {
+        *high = m_[ordinal(PuyoColor::GREEN) - 1].maskedField12();
+        *low = m_[ordinal(PuyoColor::YELLOW) - 1].maskedField12();
+    }
+}
+
+inline
+PuyoColor BitField::color(int x, int y) const
+{
+    for (int i = 0; i < NUM_PLANES; ++i) {
+        if (m_[i].get(x, y))
+            return static_cast<PuyoColor>(i + 1);
+    }
+    return PuyoColor::EMPTY;
+}
+
+inline
+void BitField::setColor(int x, int y, PuyoColor c)
+{
+    for (int i = 0; i < NUM_PLANES; ++i)
+        m_[i].unset(x, y);
+    if (c != PuyoColor::EMPTY)
+        m_[ordinal(c) - 1].set(x, y);
+}
+
+inline
+void BitField::setColorAll(FieldBits bits, PuyoColor c)
+{
+    for (int i = 0; i < NUM_PLANES; ++i)
+        m_[i].unsetAll(bits);
+    if (c != PuyoColor::EMPTY)
+        m_[ordinal(c) - 1].setAll(bits);
+}
+
+#else
+
 inline
 FieldBits BitField::bits(PuyoColor c) const
 {
@@ -157,23 +271,26 @@ FieldBits BitField::bits(PuyoColor c) const
 }
 
 inline
-BitField BitField::escapeInvisible()
+FieldBits BitField::normalColorBits() const
 {
-    BitField escaped;
-    for (int i = 0; i < 3; ++i) {
-        escaped.m_[i] = m_[i].notmask(FieldBits::FIELD_MASK_13);
-        m_[i] = m_[i].mask(FieldBits::FIELD_MASK_13);
-    }
+    return m_[2];
+}
 
-    return escaped;
+inline
+FieldBits BitField::nonEmptyBits() const
+{
+    return m_[0] | m_[1] | m_[2];
 }
 
 inline
-void BitField::recoverInvisible(const BitField& bf)
+void BitField::normalColorPairBits(int i, FieldBits* high, FieldBits* low) const
 {
-    for (int i = 0; i < 3; ++i) {
-        m_[i].setAll(bf.m_[i]);
-    }
+    // RED (100) & BLUE (101), or YELLOW (110) & GREEN (111).
+    FieldBits t = (i == 0) ? FieldBits(_mm_andnot_si128(m_[1], m_[2])) : m_[2] & m_[1];
+    t = t.maskedField12();
+
+    *high = m_[0] & t;
+    *low = _mm_andnot_si128(m_[0], t);
 }
 
 inline
@@ -198,14 +315,6 @@ void BitField::setColor(int x, int y, PuyoColor c)
     }
 }
 
-inline
-RensaResult BitField::simulate(int initialChain)
-{
-    RensaNonTracker tracker;
-    SimulationContext context(initialChain);
-    return simulate(&context, &tracker);
-}
-
 inline
 void BitField::setColorAll(FieldBits bits, PuyoColor c)
 {
@@ -218,15 +327,82 @@ void BitField::setColorAll(FieldBits bits, PuyoColor c)
     }
 }
 
+#endif // BIT_FIELD_PER_COLOR_LAYOUT
+
+inline
+FieldBits BitField::differentBits(const BitField& bf) const
+{
+    FieldBits different = m_[0] ^ bf.m_[0];
+    for (int i = 1; i < NUM_PLANES; ++i)
+        different = different | (m_[i] ^ bf.m_[i]);
+    return different;
+}
+
+inline
+BitField BitField::escapeInvisible()
+{
+    BitField escaped;
+    for (int i = 0; i < NUM_PLANES; ++i) {
+        escaped.m_[i] = m_[i].notmask(FieldBits::FIELD_MASK_13);
+        m_[i] = m_[i].mask(FieldBits::FIELD_MASK_13);
+    }
+
+    return escaped;
+}
+
+inline
+void BitField::recoverInvisible(const BitField& bf)
+{
+    for (int i = 0; i < NUM_PLANES; ++i) {
+        m_[i].setAll(bf.m_[i]);
+    }
+}
+
+inline
+RensaResult BitField::simulate(int initialChain)
+{
+    RensaNonTracker tracker;
+    SimulationContext context(initialChain);
+    return simulate(&context, &tracker);
+}
+
 inline
 void BitField::setColorAllIfEmpty(FieldBits bits, PuyoColor c)
 {
-    FieldBits nonEmpty = (m_[0] | m_[1] | m_[2]);
+    FieldBits nonEmpty = nonEmptyBits();
     bits = bits.notmask(nonEmpty);
 
     setColorAll(bits, c);
 }
 
+inline
+void BitField::setColumnColorBits(int x, int y, const std::uint32_t colorBits[3])
+{
+    DCHECK(0 <= x && x < 8 && 0 <= y && y < 16) << "x=" << x << " y=" << y;
+
+    int shift = ((x & 3) << 4) | y;
+#ifdef BIT_FIELD_PER_COLOR_LAYOUT
+    for (int i = 0; i < 3; ++i)
+        DCHECK_EQ(colorBits[i] >> (16 - y), 0U) << "overflow x=" << x << " y=" << y;
+    for (int i = 0; i < NUM_PLANES; ++i) {
+        // The cells whose color is i + 1.
+        std::uint32_t cbits = ~0U;
+        for (int j = 0; j < 3; ++j)
+            cbits &= ((i + 1) & (1 << j)) ? colorBits[j] : ~colorBits[j];
+        if (cbits == 0)
+            continue;
+        std::uint64_t v = static_cast<std::uint64_t>(cbits) << shift;
+        m_[i].setAll(x < 4 ? _mm_set_epi64x(0, v) : _mm_set_epi64x(v, 0));
+    }
+#else
+    for (int i = 0; i < 3; ++i) {
+        DCHECK_EQ(colorBits[i] >> (16 - y), 0U) << "overflow x=" << x << " y=" << y;
+        std::uint64_t v = static_cast<std::uint64_t>(colorBits[i]) << shift;
+        m_[i].setAll(x < 4 ? _mm_set_epi64x(0, v) : _mm_set_epi64x(v, 0));
+    }
+#endif
+}
+
 inline
 bool BitField::isConnectedPuyo(int x, int y, PuyoColor c) const
 {
@@ -282,7 +458,7 @@ inline
 void BitField::calculateHeight(int heights[FieldConstant::MAP_WIDTH]) const
 {
     const __m128i zero = _mm_setzero_si128();
-    __m128i whole = (m_[0] | m_[1] | m_[2]).maskedField13();
+    __m128i whole = nonEmptyBits().maskedField13();
 
    __m128i count = sse::mm_popcnt_epi16(whole);
 
@@ -305,7 +481,7 @@ struct hash<BitField>
 
 #include "bit_field_inl.h"
 
-#if defined(__AVX2__) and defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
 #include "bit_field_avx2_inl.h"
 #endif
 
@@ -1,7 +1,7 @@
 #ifndef CORE_BIT_FIELD_AVX2_INL_256_H_
 #define CORE_BIT_FIELD_AVX2_INL_256_H_
 
-#if !defined(__AVX2__) || !defined(__BMI2__)
+#ifndef HAVE_TARGET_AVX2_BMI2
 # error "Needs AVX2 and BMI2 to use this header."
 #endif
 
@@ -13,6 +13,7 @@
 #include "field_bits_256.h"
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 RensaResult BitField::simulateAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -40,6 +41,7 @@ RensaResult BitField::simulateAVX2(SimulationContext* context, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 int BitField::simulateFastAVX2(Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -56,6 +58,52 @@ int BitField::simulateFastAVX2(Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
+int BitField::simulateFastUntilAVX2(int maxChains, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+    int currentChain = 1;
+
+    FieldBits erased;
+    while (currentChain <= maxChains && vanishFastAVX2(currentChain, &erased, tracker)) {
+        currentChain += 1;
+        dropAfterVanishFastAVX2(erased, tracker);
+    }
+
+    recoverInvisible(escaped);
+    return currentChain - 1;
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
+RensaResult BitField::simulateUntilScoreAVX2(int minScore, SimulationContext* context, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+
+    int score = 0;
+    int frames = 0;
+    int nthChainScore;
+    bool quick = false;
+    FieldBits erased;
+
+    while (score < minScore && (nthChainScore = vanishAVX2(context->currentChain, &erased, tracker)) > 0) {
+        context->currentChain += 1;
+        score += nthChainScore;
+        frames += FRAMES_VANISH_ANIMATION;
+        int maxDrops = dropAfterVanishAVX2(erased, tracker);
+        if (maxDrops > 0) {
+            frames += FRAMES_TO_DROP_FAST[maxDrops] + FRAMES_GROUNDING;
+        } else {
+            quick = true;
+        }
+    }
+
+    recoverInvisible(escaped);
+    return RensaResult(context->currentChain - 1, score, frames, quick);
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
 RensaStepResult BitField::vanishDropAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -82,6 +130,7 @@ RensaStepResult BitField::vanishDropAVX2(SimulationContext* context, Tracker* tr
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 bool BitField::vanishDropFastAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -99,7 +148,7 @@ bool BitField::vanishDropFastAVX2(SimulationContext* context, Tracker* tracker)
 }
 
 template<typename Tracker>
-CLANG_ALWAYS_INLINE
+CLANG_ALWAYS_INLINE TARGET_AVX2_BMI2
 int BitField::vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const
 {
     FieldBits256 erased256;
@@ -110,11 +159,8 @@ int BitField::vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker)
     bool didErase = false;
 
     for (int i = 0; i < 2; ++i) {
-        FieldBits t = (i == 0) ? FieldBits(_mm_andnot_si128(m_[1], m_[2])) : m_[2] & m_[1];
-        t = t.maskedField12();
-
-        FieldBits highMask = m_[0] & t;
-        FieldBits lowMask = _mm_andnot_si128(m_[0], t);
+        FieldBits highMask, lowMask;
+        normalColorPairBits(i, &highMask, &lowMask);
 
         FieldBits256 mask(highMask, lowMask);
         FieldBits256 vanishing;
@@ -179,29 +225,18 @@ int BitField::vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 bool BitField::vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const
 {
     FieldBits256 erased256;
 
     bool didErase = false;
 
-    // RED (100) & BLUE (101)
-    {
-        FieldBits t = _mm_andnot_si128(m_[1], m_[2]);
-        t = t.maskedField12();
-        FieldBits256 mask(m_[0] & t, _mm_andnot_si128(m_[0], t));
-        FieldBits256 vanishing;
-        if (mask.findVanishingBits(&vanishing)) {
-            erased256.setAll(vanishing);
-            didErase = true;
-        }
-    }
-
-    // YELLOW (110) & GREEN (111)
-    {
-        FieldBits t = m_[2] & m_[1];
-        t = t.maskedField12();
-        FieldBits256 mask(m_[0] & t, _mm_andnot_si128(m_[0], t));
+    // RED & BLUE, and YELLOW & GREEN.
+    for (int i = 0; i < 2; ++i) {
+        FieldBits highMask, lowMask;
+        normalColorPairBits(i, &highMask, &lowMask);
+        FieldBits256 mask(highMask, lowMask);
         FieldBits256 vanishing;
         if (mask.findVanishingBits(&vanishing)) {
             erased256.setAll(vanishing);
@@ -226,11 +261,11 @@ bool BitField::vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* trac
 }
 
 template<typename Tracker>
-CLANG_ALWAYS_INLINE
+CLANG_ALWAYS_INLINE TARGET_AVX2_BMI2
 int BitField::dropAfterVanishAVX2(FieldBits erased, Tracker* tracker)
 {
     // Set 1 at non-empty position.
-    __m128i nonempty = (m_[0] | m_[1] | m_[2]).xmm();
+    __m128i nonempty = nonEmptyBits().xmm();
     // Remove 1 bits from the positions where they are  erased.
     nonempty = _mm_andnot_si128(erased, nonempty);
 
@@ -246,8 +281,15 @@ int BitField::dropAfterVanishAVX2(FieldBits erased, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 void BitField::dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker)
 {
+    // PDEP and PEXT are slow on this CPU.
+    if (s_kernel != Kernel::AVX2_BMI2) {
+        dropAfterVanishFast(erased, tracker);
+        return;
+    }
+
     const __m128i ones = sse::mm_setone_si128();
 
     sse::Decomposer t;
@@ -265,30 +307,25 @@ void BitField::dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker)
     const std::uint64_t newLowBits = y.ui64[0];
     const std::uint64_t newHighBits = y.ui64[2];
 
-    sse::Decomposer d[3];
-    d[0].m = m_[0];
-    d[1].m = m_[1];
-    d[2].m = m_[2];
+    sse::Decomposer d[NUM_PLANES];
+    for (int i = 0; i < NUM_PLANES; ++i)
+        d[i].m = m_[i];
 
     if (newLowBits != 0xFFFFFFFFFFFFFFFFULL) {
-        d[0].ui64[0] = _pdep_u64(_pext_u64(d[0].ui64[0], oldLowBits), newLowBits);
-        d[1].ui64[0] = _pdep_u64(_pext_u64(d[1].ui64[0], oldLowBits), newLowBits);
-        d[2].ui64[0] = _pdep_u64(_pext_u64(d[2].ui64[0], oldLowBits), newLowBits);
+        for (int i = 0; i < NUM_PLANES; ++i)
+            d[i].ui64[0] = _pdep_u64(_pext_u64(d[i].ui64[0], oldLowBits), newLowBits);
 
         if (newHighBits != 0xFFFFFFFFFFFFFFFFULL) {
-            d[0].ui64[1] = _pdep_u64(_pext_u64(d[0].ui64[1], oldHighBits), newHighBits);
-            d[1].ui64[1] = _pdep_u64(_pext_u64(d[1].ui64[1], oldHighBits), newHighBits);
-            d[2].ui64[1] = _pdep_u64(_pext_u64(d[2].ui64[1], oldHighBits), newHighBits);
+            for (int i = 0; i < NUM_PLANES; ++i)
+                d[i].ui64[1] = _pdep_u64(_pext_u64(d[i].ui64[1], oldHighBits), newHighBits);
         }
     } else {
-        d[0].ui64[1] = _pdep_u64(_pext_u64(d[0].ui64[1], oldHighBits), newHighBits);
-        d[1].ui64[1] = _pdep_u64(_pext_u64(d[1].ui64[1], oldHighBits), newHighBits);
-        d[2].ui64[1] = _pdep_u64(_pext_u64(d[2].ui64[1], oldHighBits), newHighBits);
+        for (int i = 0; i < NUM_PLANES; ++i)
+            d[i].ui64[1] = _pdep_u64(_pext_u64(d[i].ui64[1], oldHighBits), newHighBits);
     }
 
-    m_[0] = d[0].m;
-    m_[1] = d[1].m;
-    m_[2] = d[2].m;
+    for (int i = 0; i < NUM_PLANES; ++i)
+        m_[i] = d[i].m;
 
     tracker->trackDropBMI2(oldLowBits, oldHighBits, newLowBits, newHighBits);
 }
@@ -44,6 +44,49 @@ int BitField::simulateFast(Tracker* tracker)
     return currentChain - 1;
 }
 
+template<typename Tracker>
+int BitField::simulateFastUntil(int maxChains, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+    int currentChain = 1;
+
+    FieldBits erased;
+    while (currentChain <= maxChains && vanishFast(currentChain, &erased, tracker)) {
+        currentChain += 1;
+        dropAfterVanishFast(erased, tracker);
+    }
+
+    recoverInvisible(escaped);
+    return currentChain - 1;
+}
+
+template<typename Tracker>
+RensaResult BitField::simulateUntilScore(int minScore, SimulationContext* context, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+
+    int score = 0;
+    int frames = 0;
+    int nthChainScore;
+    bool quick = false;
+    FieldBits erased;
+
+    while (score < minScore && (nthChainScore = vanish(context->currentChain, &erased, tracker)) > 0) {
+        context->currentChain += 1;
+        score += nthChainScore;
+        frames += FRAMES_VANISH_ANIMATION;
+        int maxDrops = dropAfterVanish(erased, tracker);
+        if (maxDrops > 0) {
+            frames += FRAMES_TO_DROP_FAST[maxDrops] + FRAMES_GROUNDING;
+        } else {
+            quick = true;
+        }
+    }
+
+    recoverInvisible(escaped);
+    return RensaResult(context->currentChain - 1, score, frames, quick);
+}
+
 template<typename Tracker>
 RensaStepResult BitField::vanishDrop(SimulationContext* context, Tracker* tracker)
 {
@@ -187,7 +230,7 @@ int BitField::dropAfterVanish(FieldBits erased, Tracker* tracker)
     const __m128i zero = _mm_setzero_si128();
     const __m128i ones = _mm_cmpeq_epi8(zero, zero);
     const __m128i whole = _mm_andnot_si128(erased.xmm(),
-        _mm_or_si128(m_[0].xmm(), _mm_or_si128(m_[1].xmm(), m_[2].xmm())));
+        nonEmptyBits().xmm());
 
     int wholeErased = erased.horizontalOr16();
     int maxY = 31 - __builtin_clz(wholeErased);
@@ -219,7 +262,7 @@ int BitField::dropAfterVanish(FieldBits erased, Tracker* tracker)
 
         tracker->trackDrop(blender, leftOnes, rightOnes);
 
-        for (int i = 0; i < 3; ++i) {
+        for (int i = 0; i < NUM_PLANES; ++i) {
             __m128i m = m_[i].xmm();
             __m128i v1 = _mm_and_si128(rightOnes, m);
             __m128i v2 = _mm_and_si128(leftOnes, m);
@@ -268,7 +311,7 @@ void BitField::dropAfterVanishFast(FieldBits erased, Tracker* tracker)
 
         tracker->trackDrop(blender, leftOnes, rightOnes);
 
-        for (int i = 0; i < 3; ++i) {
+        for (int i = 0; i < NUM_PLANES; ++i) {
             __m128i m = m_[i].xmm();
             __m128i v1 = _mm_and_si128(rightOnes, m);
             __m128i v2 = _mm_and_si128(leftOnes, m);
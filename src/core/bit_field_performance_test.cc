@@ -1,5 +1,7 @@
 #include "core/bit_field.h"
 
+#include <iostream>
+
 #include <gtest/gtest.h>
 
 #include "base/base.h"
@@ -25,6 +27,70 @@ TEST(BitFieldPerformanceTest, hash)
     tscd.showStatistics();
 }
 
+// The following benchmarks and the simulate benchmarks are used to compare the layouts of
+// BitField. Run them with and without -DPUYOAI_BIT_FIELD_PER_COLOR=ON.
+
+TEST(BitFieldPerformanceTest, copy)
+{
+    // Search algorithms copy a field for each node.
+    const int N = 100000;
+    const int M = 64;
+
+    TimeStampCounterData tsc;
+    BitField bfOriginal(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR");
+
+    BitField src[M];
+    BitField dst[M];
+    for (int j = 0; j < M; ++j)
+        src[j] = bfOriginal;
+
+    for (int i = 0; i < N; ++i) {
+        ScopedTimeStampCounter stsc(&tsc);
+        for (int j = 0; j < M; ++j)
+            dst[j] = src[j];
+    }
+
+    EXPECT_EQ(bfOriginal, dst[M - 1]);
+    cout << "sizeof(BitField) = " << sizeof(BitField) << endl;
+    tsc.showStatistics();
+}
+
+TEST(BitFieldPerformanceTest, bits_filled)
+{
+    // vanish() takes bits(c) of each color for each chain.
+    const int N = 1000000;
+
+    TimeStampCounterData tsc;
+    BitField bf(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR"
+        "YGYRBY"
+        "YGBGYR"
+        "GRBGYR"
+        "BRBYBY"
+        "RYYBYY"
+        "BRBYBR"
+        "BGBYRR"
+        "YGBGBG"
+        "RBGBGG");
+
+    for (int i = 0; i < N; ++i) {
+        ScopedTimeStampCounter stsc(&tsc);
+        int count = 0;
+        for (PuyoColor c : NORMAL_PUYO_COLORS)
+            count += bf.bits(c).maskedField12().popcount();
+        EXPECT_EQ(72, count);
+    }
+
+    tsc.showStatistics();
+}
+
 TEST(BitFieldPerformanceTest, bitfield_simulate_filled)
 {
     const int N = 1000000;
@@ -86,12 +152,11 @@ TEST(BitFieldPerformanceTest, bitfield_simulate_fast_filled)
     tsc.showStatistics();
 }
 
-#if defined(__AVX2__) && defined(__BMI2__)
-TEST(BitFieldPerformanceTest, bitfield_simulate_avx2_filled)
+TEST(BitFieldPerformanceTest, bitfield_simulate_until_filled)
 {
+    // Compares the bounded simulation with the full one on a 19 rensa field.
     const int N = 1000000;
 
-    TimeStampCounterData tsc;
     BitField bfOriginal(
         ".G.BRG"
         "GBRRYR"
@@ -107,22 +172,88 @@ TEST(BitFieldPerformanceTest, bitfield_simulate_avx2_filled)
         "YGBGBG"
         "RBGBGG");
 
-    for (int i = 0; i < N; i++) {
-        BitField bf(bfOriginal);
-        BitField::SimulationContext context;
-        RensaNonTracker tracker;
-        ScopedTimeStampCounter stsc(&tsc);
-        EXPECT_EQ(19, bf.simulateAVX2(&context, &tracker).chains);
+    for (int maxChains : { 3, 10 }) {
+        TimeStampCounterData tsc;
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            RensaNonTracker tracker;
+            ScopedTimeStampCounter stsc(&tsc);
+            EXPECT_EQ(maxChains, bf.simulateFastUntil(maxChains, &tracker));
+        }
+
+        cout << "simulateFastUntil(" << maxChains << "):" << endl;
+        tsc.showStatistics();
     }
 
-    tsc.showStatistics();
+    // 10 rensa makes about 30 ojama puyos.
+    for (int minScore : { 2100, 70 * 30 * 4 }) {
+        TimeStampCounterData tsc;
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            BitField::SimulationContext context;
+            RensaNonTracker tracker;
+            ScopedTimeStampCounter stsc(&tsc);
+            EXPECT_LE(minScore, bf.simulateUntilScore(minScore, &context, &tracker).score);
+        }
+
+        cout << "simulateUntilScore(" << minScore << "):" << endl;
+        tsc.showStatistics();
+    }
+}
+
+#ifdef HAVE_TARGET_AVX2_BMI2
+// Runs |f| with each AVX2 kernel which the CPU supports. The kernels differ in how puyos are dropped.
+template<typename F>
+static void forEachAVX2Kernel(F f)
+{
+    BitField::Kernel original = BitField::kernel();
+    for (BitField::Kernel kernel : { BitField::Kernel::AVX2, BitField::Kernel::AVX2_BMI2 }) {
+        if (!BitField::isKernelSupported(kernel))
+            continue;
+        cout << (kernel == BitField::Kernel::AVX2 ? "AVX2:" : "AVX2_BMI2:") << endl;
+        BitField::setKernel(kernel);
+        f();
+    }
+    BitField::setKernel(original);
+}
+
+TEST(BitFieldPerformanceTest, bitfield_simulate_avx2_filled)
+{
+    const int N = 1000000;
+
+    BitField bfOriginal(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR"
+        "YGYRBY"
+        "YGBGYR"
+        "GRBGYR"
+        "BRBYBY"
+        "RYYBYY"
+        "BRBYBR"
+        "BGBYRR"
+        "YGBGBG"
+        "RBGBGG");
+
+    forEachAVX2Kernel([&]() {
+        TimeStampCounterData tsc;
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            BitField::SimulationContext context;
+            RensaNonTracker tracker;
+            ScopedTimeStampCounter stsc(&tsc);
+            EXPECT_EQ(19, bf.simulateAVX2(&context, &tracker).chains);
+        }
+
+        tsc.showStatistics();
+    });
 }
 
 TEST(BitFieldPerformanceTest, bitfield_simulate_fast_avx2_filled)
 {
     const int N = 1000000;
 
-    TimeStampCounterData tsc;
     BitField bfOriginal(
         ".G.BRG"
         "GBRRYR"
@@ -138,13 +269,16 @@ TEST(BitFieldPerformanceTest, bitfield_simulate_fast_avx2_filled)
         "YGBGBG"
         "RBGBGG");
 
-    for (int i = 0; i < N; i++) {
-        BitField bf(bfOriginal);
-        RensaNonTracker tracker;
-        ScopedTimeStampCounter stsc(&tsc);
-        EXPECT_EQ(19, bf.simulateFastAVX2(&tracker));
-    }
+    forEachAVX2Kernel([&]() {
+        TimeStampCounterData tsc;
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            RensaNonTracker tracker;
+            ScopedTimeStampCounter stsc(&tsc);
+            EXPECT_EQ(19, bf.simulateFastAVX2(&tracker));
+        }
 
-    tsc.showStatistics();
+        tsc.showStatistics();
+    });
 }
-#endif // defined(__AVX2__) && defined(__BMI2__)
+#endif // HAVE_TARGET_AVX2_BMI2
@@ -94,6 +94,23 @@ const struct SimulationTestCase {
     },
 };
 
+#ifdef HAVE_TARGET_AVX2_BMI2
+// Runs |f| with each AVX2 kernel which the CPU supports.
+template<typename F>
+void forEachAVX2Kernel(F f)
+{
+    BitField::Kernel original = BitField::kernel();
+    for (BitField::Kernel kernel : { BitField::Kernel::AVX2, BitField::Kernel::AVX2_BMI2 }) {
+        if (!BitField::isKernelSupported(kernel))
+            continue;
+        SCOPED_TRACE(kernel == BitField::Kernel::AVX2 ? "AVX2" : "AVX2_BMI2");
+        BitField::setKernel(kernel);
+        f();
+    }
+    BitField::setKernel(original);
+}
+#endif
+
 } // anonymous namespace
 
 TEST(BitFieldTest, constructor1)
@@ -517,31 +534,97 @@ TEST(BitFieldTest, simulateFast)
     }
 }
 
-#if defined(__AVX2__) && defined(__BMI2__)
-TEST(BitFieldTest, simulateAVX2)
+TEST(BitFieldTest, simulateFastUntil)
 {
     for (const auto& testcase : SIMULATION_TEST_CASES) {
-        BitField bf(testcase.field);
-        BitField::SimulationContext context;
-        RensaNonTracker tracker;
-        RensaResult result = bf.simulateAVX2(&context, &tracker);
+        for (int maxChains = 0; maxChains <= testcase.chains + 1; ++maxChains) {
+            BitField bf(testcase.field);
+            RensaNonTracker tracker;
+            int chains = bf.simulateFastUntil(maxChains, &tracker);
+            EXPECT_EQ(std::min(maxChains, testcase.chains), chains) << testcase.field.toDebugString();
+        }
+    }
+}
 
-        EXPECT_EQ(testcase.chains, result.chains) << testcase.field.toDebugString();
-        EXPECT_EQ(testcase.score, result.score) << testcase.field.toDebugString();
-        EXPECT_EQ(testcase.frames, result.frames) << testcase.field.toDebugString();
-        EXPECT_EQ(testcase.quick, result.quick) << testcase.field.toDebugString();
+TEST(BitFieldTest, simulateUntilScore)
+{
+    for (const auto& testcase : SIMULATION_TEST_CASES) {
+        {
+            BitField bf(testcase.field);
+            BitField::SimulationContext context;
+            RensaNonTracker tracker;
+            RensaResult result = bf.simulateUntilScore(testcase.score, &context, &tracker);
+            EXPECT_EQ(testcase.chains, result.chains) << testcase.field.toDebugString();
+            EXPECT_EQ(testcase.score, result.score) << testcase.field.toDebugString();
+            EXPECT_EQ(testcase.frames, result.frames) << testcase.field.toDebugString();
+        }
+        if (testcase.chains >= 2) {
+            // Stops just after the first chain.
+            BitField bf(testcase.field);
+            BitField::SimulationContext context;
+            RensaNonTracker tracker;
+            RensaResult result = bf.simulateUntilScore(1, &context, &tracker);
+            EXPECT_EQ(1, result.chains) << testcase.field.toDebugString();
+            EXPECT_LT(result.score, testcase.score) << testcase.field.toDebugString();
+        }
     }
 }
 
+#ifdef HAVE_TARGET_AVX2_BMI2
+TEST(BitFieldTest, simulateAVX2)
+{
+    forEachAVX2Kernel([]() {
+        for (const auto& testcase : SIMULATION_TEST_CASES) {
+            BitField bf(testcase.field);
+            BitField::SimulationContext context;
+            RensaNonTracker tracker;
+            RensaResult result = bf.simulateAVX2(&context, &tracker);
+
+            EXPECT_EQ(testcase.chains, result.chains) << testcase.field.toDebugString();
+            EXPECT_EQ(testcase.score, result.score) << testcase.field.toDebugString();
+            EXPECT_EQ(testcase.frames, result.frames) << testcase.field.toDebugString();
+            EXPECT_EQ(testcase.quick, result.quick) << testcase.field.toDebugString();
+        }
+    });
+}
+
 TEST(BitFieldTest, simulateFastAVX2)
 {
-    for (const auto& testcase : SIMULATION_TEST_CASES) {
-        BitField bf(testcase.field);
-        RensaNonTracker tracker;
-        int chains = bf.simulateFastAVX2(&tracker);
+    forEachAVX2Kernel([]() {
+        for (const auto& testcase : SIMULATION_TEST_CASES) {
+            BitField bf(testcase.field);
+            RensaNonTracker tracker;
+            int chains = bf.simulateFastAVX2(&tracker);
 
-        EXPECT_EQ(testcase.chains, chains) << testcase.field.toDebugString();
-    }
+            EXPECT_EQ(testcase.chains, chains) << testcase.field.toDebugString();
+        }
+    });
+}
+#endif
+
+#ifdef HAVE_TARGET_AVX2_BMI2
+TEST(BitFieldTest, simulateBoundedAVX2)
+{
+    forEachAVX2Kernel([]() {
+        for (const auto& testcase : SIMULATION_TEST_CASES) {
+            for (int maxChains = 0; maxChains <= testcase.chains + 1; ++maxChains) {
+                BitField bf(testcase.field);
+                BitField expected(testcase.field);
+                RensaNonTracker tracker;
+                EXPECT_EQ(expected.simulateFastUntil(maxChains, &tracker), bf.simulateFastUntilAVX2(maxChains, &tracker));
+                EXPECT_EQ(expected, bf) << testcase.field.toDebugString();
+            }
+
+            BitField bf(testcase.field);
+            BitField expected(testcase.field);
+            BitField::SimulationContext context;
+            BitField::SimulationContext expectedContext;
+            RensaNonTracker tracker;
+            EXPECT_EQ(expected.simulateUntilScore(1, &expectedContext, &tracker),
+                      bf.simulateUntilScoreAVX2(1, &context, &tracker));
+            EXPECT_EQ(expected, bf) << testcase.field.toDebugString();
+        }
+    });
 }
 #endif
 
@@ -583,46 +666,61 @@ TEST(BitFieldTest, vanishDropFast)
     }
 }
 
-#if defined(__AVX2__) && defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
 TEST(BitFieldTest, vanishDropAVX2)
 {
-    for (const auto& testcase : SIMULATION_TEST_CASES) {
-        BitField bf(testcase.field);
-        RensaNonTracker tracker;
-        BitField::SimulationContext context;
+    forEachAVX2Kernel([]() {
+        for (const auto& testcase : SIMULATION_TEST_CASES) {
+            BitField bf(testcase.field);
+            RensaNonTracker tracker;
+            BitField::SimulationContext context;
+
+            int sumScore = 0;
+            for (int i = 0; i < testcase.chains; ++i) {
+                RensaStepResult stepResult = bf.vanishDropAVX2(&context, &tracker);
+                EXPECT_LT(0, stepResult.score);
+
+                sumScore += stepResult.score;
+            }
 
-        int sumScore = 0;
-        for (int i = 0; i < testcase.chains; ++i) {
-            RensaStepResult stepResult = bf.vanishDropAVX2(&context, &tracker);
-            EXPECT_LT(0, stepResult.score);
+            EXPECT_EQ(testcase.score, sumScore);
 
-            sumScore += stepResult.score;
+            // This should not exist a rensa anymore.
+            RensaStepResult stepResult = bf.vanishDropAVX2(&context, &tracker);
+            EXPECT_EQ(0, stepResult.score);
         }
-
-        EXPECT_EQ(testcase.score, sumScore);
-
-        // This should not exist a rensa anymore.
-        RensaStepResult stepResult = bf.vanishDropAVX2(&context, &tracker);
-        EXPECT_EQ(0, stepResult.score);
-    }
+    });
 }
 
 TEST(BitFieldTest, vanishDropFastAVX2)
 {
-    for (const auto& testcase : SIMULATION_TEST_CASES) {
-        BitField bf(testcase.field);
-        RensaNonTracker tracker;
-        BitField::SimulationContext context;
+    forEachAVX2Kernel([]() {
+        for (const auto& testcase : SIMULATION_TEST_CASES) {
+            BitField bf(testcase.field);
+            RensaNonTracker tracker;
+            BitField::SimulationContext context;
+
+            for (int i = 0; i < testcase.chains; ++i) {
+                EXPECT_TRUE(bf.vanishDropFastAVX2(&context, &tracker));
+            }
 
-        for (int i = 0; i < testcase.chains; ++i) {
-            EXPECT_TRUE(bf.vanishDropFastAVX2(&context, &tracker));
+            EXPECT_FALSE(bf.vanishDropFastAVX2(&context, &tracker));
         }
-
-        EXPECT_FALSE(bf.vanishDropFastAVX2(&context, &tracker));
-    }
+    });
 }
 #endif
 
+TEST(BitFieldTest, kernel)
+{
+    EXPECT_TRUE(BitField::isKernelSupported(BitField::Kernel::SSE));
+    EXPECT_TRUE(BitField::isKernelSupported(BitField::kernel()));
+
+#if defined(__AVX2__) && defined(__BMI2__)
+    // Compiled with -mavx2 -mbmi2 and running, so AVX2 must be selected.
+    EXPECT_NE(BitField::Kernel::SSE, BitField::kernel());
+#endif
+}
+
 TEST(BitFieldTest, ignitionPuyoBits)
 {
     BitField bf(
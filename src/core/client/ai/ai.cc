@@ -1,10 +1,14 @@
 #include "core/client/ai/ai.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <thread>
 
 #include "base/base.h"
+#include "base/profiler.h"
+#include "base/trace.h"
 #include "core/core_field.h"
 #include "core/decision.h"
 #include "core/field_pretty_printer.h"
@@ -16,6 +20,9 @@
 #include "core/rensa_result.h"
 #include "core/user_event.h"
 
+DEFINE_int32(think_timeout_ms, 0, "If positive, think is asked to finish in this time [ms].");
+DEFINE_int32(fast_think_timeout_ms, 0, "If positive, fast think is asked to finish in this time [ms].");
+
 using namespace std;
 
 struct DecisionSending {
@@ -47,12 +54,23 @@ AI::AI(const string& name) :
     desynced_(false),
     rethinkRequested_(false),
     enemyDecisionRequestFrameId_(0),
-    behaviorRethinkAfterOpponentRensa_(false)
+    behaviorRethinkAfterOpponentRensa_(false),
+    behaviorPonder_(false)
 {
 }
 
 AI::~AI()
 {
+    if (!ponderThread_.joinable())
+        return;
+
+    stopPondering();
+    {
+        lock_guard<mutex> lock(ponderMu_);
+        ponderThreadStopping_ = true;
+    }
+    ponderCondVar_.notify_all();
+    ponderThread_.join();
 }
 
 // TODO(mayah): Consider to introduce state. It's hard to maintain flags.
@@ -66,11 +84,20 @@ void AI::runLoop()
     // nextThinkFrameId is frameId in which the decision of think() is sent.
     int nextThinkFrameId = 0;
 
+    Tracer::setThreadName(name_);
+
+    thread receiverThread([this]() { runReceiverLoop(); });
+
     while (true) {
         google::FlushLogFiles(google::INFO);
 
         FrameRequest frameRequest;
-        if (!connector_.receive(&frameRequest)) {
+        bool received;
+        {
+            ScopedTrace trace("AI::receiveFrameRequest");
+            received = popFrameRequest(&frameRequest);
+        }
+        if (!received) {
             if (connector_.isClosed()) {
                 LOG(INFO) << "connection is closed";
                 break;
@@ -79,17 +106,22 @@ void AI::runLoop()
             break;
         }
 
+        // Covers from handling the request to sending the response.
+        ScopedTrace frameTrace("AI::frame", frameRequest.frameId);
+
         if (!frameRequest.isValid()) {
             connector_.send(FrameResponse(frameRequest.frameId));
             continue;
         }
 
         if (frameRequest.hasGameEnd()) {
+            stopPondering();
             gameHasEnded(frameRequest);
         }
         // Before starting a new game, we need to think the first hand.
         // TODO(mayah): Maybe game server should send some information that we should initialize.
         if (frameRequest.shouldInitialize()) {
+            stopPondering();
             next1.clear();
             nextThinkFrameId = 0;
             gameWillBegin(frameRequest);
@@ -134,8 +166,12 @@ void AI::runLoop()
                 CHECK_EQ(kumipuyoSeq.get(2), seq.get(1));
 
             next1.fieldBeforeThink = me_.field;
-            next1.dropDecision = think(nextThinkFrameId, me_.field, seq,
-                                       myPlayerState(), enemyPlayerState(), false);
+            bool cancelled = false;
+            next1.dropDecision = thinkInRunLoop(nextThinkFrameId, me_.field, seq, false, true, &cancelled);
+            // The urgent request which has cancelled the think will be handled soon,
+            // but make sure that the stale decision is never sent.
+            if (cancelled)
+                next1.needsRethink = true;
 
             next1.kumipuyo = kumipuyoSeq.get(1);
             next1.ready = true;
@@ -164,12 +200,10 @@ void AI::runLoop()
             VLOG(1) << "REQUEST_AGAIN";
             DCHECK(!frameRequest.myPlayerFrameRequest().event.decisionRequest)
                 << "decisionRequestAgain should not come with decisionRequest.";
-            DropDecision dropDecision = think(frameRequest.frameId,
-                                              CoreField(frameRequest.myPlayerFrameRequest().field),
-                                              frameRequest.myPlayerFrameRequest().kumipuyoSeq,
-                                              myPlayerState(),
-                                              enemyPlayerState(),
-                                              true);
+            DropDecision dropDecision = thinkInRunLoop(frameRequest.frameId,
+                                                       CoreField(frameRequest.myPlayerFrameRequest().field),
+                                                       frameRequest.myPlayerFrameRequest().kumipuyoSeq,
+                                                       true, false, nullptr);
             connector_.send(FrameResponse(frameRequest.frameId, dropDecision.decision(), dropDecision.message()));
             continue;
         }
@@ -210,7 +244,8 @@ void AI::runLoop()
             CHECK_EQ(kumipuyoSeq.get(0), seq.get(0));
             CHECK_EQ(kumipuyoSeq.get(1), seq.get(1));
 
-            next1.dropDecision = think(frameRequest.frameId, me_.field, seq, myPlayerState(), enemyPlayerState(), true);
+            // We need to send this decision now, so this cannot be cancelled.
+            next1.dropDecision = thinkInRunLoop(frameRequest.frameId, me_.field, seq, true, false, nullptr);
             next1.kumipuyo = kumipuyoSeq.get(0);
             next1.ready = true;
             next1.needsRethink = false;
@@ -230,12 +265,250 @@ void AI::runLoop()
             if (!me_.field.dropKumipuyo(next1.dropDecision.decision(), next1.kumipuyo)) {
                 LOG(WARNING) << "failed to drop kumipuyo. Moving to impossible position?";
             }
-            me_.field.simulate();
+            RensaResult rensaResult = me_.field.simulate();
+            // When rensa occurs, we cannot predict the frameId of the next think.
+            if (behaviorPonder_ && rensaResult.chains == 0)
+                startPondering(nextThinkFrameId);
         }
         next1.clear();
     }
 
+    stopPondering();
+    // The receiver thread has already finished, since the connection is closed.
+    receiverThread.join();
+
     LOG(INFO) << "will exit run loop";
+    Tracer::dumpIfRequested();
+}
+
+void AI::runReceiverLoop()
+{
+    Tracer::setThreadName(name_ + "-receiver");
+
+    while (true) {
+        FrameRequest frameRequest;
+        bool received = connector_.receive(&frameRequest);
+
+        lock_guard<mutex> lock(receiverMu_);
+        if (!received) {
+            receiverClosed_ = true;
+            receiverCondVar_.notify_all();
+            return;
+        }
+
+        if (isUrgentFrameRequest(frameRequest))
+            thinkCancellationToken_.cancel();
+        receivedRequests_.push_back(std::move(frameRequest));
+        receiverCondVar_.notify_all();
+    }
+}
+
+bool AI::popFrameRequest(FrameRequest* frameRequest)
+{
+    unique_lock<mutex> lock(receiverMu_);
+    while (receivedRequests_.empty() && !receiverClosed_)
+        receiverCondVar_.wait(lock);
+
+    if (receivedRequests_.empty())
+        return false;
+
+    *frameRequest = std::move(receivedRequests_.front());
+    receivedRequests_.pop_front();
+    return true;
+}
+
+bool AI::isUrgentFrameRequest(const FrameRequest& frameRequest) const
+{
+    if (!frameRequest.isValid())
+        return false;
+
+    // The decision is for the finished game.
+    if (frameRequest.hasGameEnd() || frameRequest.shouldInitialize())
+        return true;
+
+    // runLoop() rethinks when ojamas are dropped.
+    if (frameRequest.myPlayerFrameRequest().event.ojamaDropped)
+        return true;
+
+    // groundedForEnemy() requests rethink when the enemy has started his rensa.
+    if (behaviorRethinkAfterOpponentRensa_ && frameRequest.enemyPlayerFrameRequest().event.grounded) {
+        CoreField cf(CoreField::fromPlainFieldWithDrop(frameRequest.enemyPlayerFrameRequest().field));
+        if (cf.rensaWillOccur())
+            return true;
+    }
+
+    return false;
+}
+
+DropDecision AI::thinkInRunLoop(int frameId, const CoreField& field, const KumipuyoSeq& seq, bool fast,
+                                bool cancellable, bool* cancelled)
+{
+    ScopedTrace trace("AI::think", frameId);
+
+    DropDecision ponderedDecision;
+    if (takePonderedDecision(ThinkRequest { frameId, field, seq, me_, enemy_, fast }, &ponderedDecision)) {
+        LOG(INFO) << "use the pondered decision: frameId=" << frameId;
+        return ponderedDecision;
+    }
+
+    int timeoutMs = fast ? FLAGS_fast_think_timeout_ms : FLAGS_think_timeout_ms;
+    CancellationToken token = timeoutMs > 0 ?
+        CancellationToken::createWithTimeout(timeoutMs / 1000.0) : CancellationToken::create();
+
+    if (cancellable) {
+        lock_guard<mutex> lock(receiverMu_);
+        // An urgent request might have come before starting to think.
+        for (const auto& req : receivedRequests_) {
+            if (isUrgentFrameRequest(req))
+                token.cancel();
+        }
+        thinkCancellationToken_ = token;
+    }
+
+    DropDecision dropDecision = thinkCancellable(frameId, field, seq, myPlayerState(), enemyPlayerState(), fast, token);
+
+    if (cancellable) {
+        lock_guard<mutex> lock(receiverMu_);
+        thinkCancellationToken_ = CancellationToken();
+    }
+
+    if (token.isCancelled()) {
+        LOG(INFO) << "think has been cancelled: frameId=" << frameId;
+        if (cancelled)
+            *cancelled = true;
+    }
+
+    return dropDecision;
+}
+
+void AI::startPondering(int frameId)
+{
+    stopPondering();
+
+    KumipuyoSeq seq = rememberedSequence(me_.hand + 1, KumipuyoSeq());
+    if (seq.size() < 2)
+        return;
+
+    if (!ponderThread_.joinable())
+        ponderThread_ = thread([this]() { runPonderLoop(); });
+
+    unique_ptr<Pondering> pondering(new Pondering);
+    pondering->request = ThinkRequest { frameId, me_.field, seq, me_, enemy_, false };
+    pondering->cancellationToken = CancellationToken::create();
+
+    {
+        lock_guard<mutex> lock(ponderMu_);
+        pondering_ = std::move(pondering);
+    }
+    ponderCondVar_.notify_all();
+}
+
+void AI::runPonderLoop()
+{
+    Tracer::setThreadName(name_ + "-ponder");
+
+    unique_lock<mutex> lock(ponderMu_);
+    while (true) {
+        ponderCondVar_.wait(lock, [this]() {
+            return ponderThreadStopping_ || (pondering_ && !pondering_->started);
+        });
+        if (ponderThreadStopping_)
+            return;
+
+        // |p| is alive until |done| is set, since pondering_ is reset only after that.
+        Pondering* p = pondering_.get();
+        p->started = true;
+        lock.unlock();
+
+        DropDecision dropDecision;
+        {
+            ScopedTrace trace("AI::ponder", p->request.frameId);
+            const ThinkRequest& req = p->request;
+            dropDecision = thinkCancellable(req.frameId, req.field, req.kumipuyoSeq, req.me, req.enemy, req.fast,
+                                            p->cancellationToken);
+        }
+
+        lock.lock();
+        p->dropDecision = dropDecision;
+        p->done = true;
+        ponderCondVar_.notify_all();
+    }
+}
+
+bool AI::takePonderedDecision(const ThinkRequest& request, DropDecision* dropDecision)
+{
+    unique_lock<mutex> lock(ponderMu_);
+    if (!pondering_)
+        return false;
+
+    if (!canReusePonderedDecision(pondering_->request, request)) {
+        lock.unlock();
+        stopPondering();
+        return false;
+    }
+
+    ponderCondVar_.wait(lock, [this]() { return pondering_->done; });
+    *dropDecision = pondering_->dropDecision;
+    pondering_.reset();
+    return true;
+}
+
+void AI::stopPondering()
+{
+    unique_lock<mutex> lock(ponderMu_);
+    if (!pondering_)
+        return;
+
+    // The pondering that has not started yet won't be started, since it's reset here.
+    pondering_->cancellationToken.cancel();
+    ponderCondVar_.wait(lock, [this]() { return !pondering_->started || pondering_->done; });
+    pondering_.reset();
+}
+
+// static
+bool AI::canReusePonderedDecision(const ThinkRequest& pondered, const ThinkRequest& actual)
+{
+    // Compare what think() can see, except the enemy field. The enemy moves while pondering,
+    // but it matters only through the ojama and the ongoing rensa, which are compared here.
+    const PlayerState& pm = pondered.me;
+    const PlayerState& am = actual.me;
+    const PlayerState& pe = pondered.enemy;
+    const PlayerState& ae = actual.enemy;
+
+    return pondered.frameId == actual.frameId &&
+        pondered.fast == actual.fast &&
+        pondered.field == actual.field &&
+        pondered.kumipuyoSeq == actual.kumipuyoSeq &&
+        pm.hand == am.hand &&
+        pm.hasZenkeshi == am.hasZenkeshi &&
+        pm.fixedOjama == am.fixedOjama &&
+        pm.pendingOjama == am.pendingOjama &&
+        pm.unusedScore == am.unusedScore &&
+        pe.hasZenkeshi == ae.hasZenkeshi &&
+        pe.fixedOjama == ae.fixedOjama &&
+        pe.pendingOjama == ae.pendingOjama &&
+        pe.unusedScore == ae.unusedScore &&
+        pe.currentChainStartedFrameId == ae.currentChainStartedFrameId &&
+        pe.currentRensaResult == ae.currentRensaResult;
+}
+
+DropDecision AI::thinkCancellable(int frameId, const CoreField& field, const KumipuyoSeq& seq,
+                                  const PlayerState& me, const PlayerState& enemy, bool fast,
+                                  const CancellationToken& cancellationToken) const
+{
+    UNUSED_VARIABLE(cancellationToken);
+    return think(frameId, field, seq, me, enemy, fast);
+}
+
+vector<DropDecision> AI::thinkBatch(const vector<ThinkRequest>& requests)
+{
+    vector<DropDecision> decisions;
+    decisions.reserve(requests.size());
+    for (const auto& req : requests) {
+        gaze(req.frameId, req.enemy.field, req.enemy.seq);
+        decisions.push_back(think(req.frameId, req.field, req.kumipuyoSeq, req.me, req.enemy, req.fast));
+    }
+    return decisions;
 }
 
 void AI::gaze(int frameId, const CoreField&, const KumipuyoSeq&)
@@ -259,6 +532,7 @@ void AI::gameWillBegin(const FrameRequest& frameRequest)
 void AI::gameHasEnded(const FrameRequest& frameRequest)
 {
     onGameHasEnded(frameRequest);
+    Profiler::dumpIfRequested(name_);
 }
 
 void AI::preDecisionRequestedForMe(const FrameRequest& frameRequest)
@@ -316,6 +590,8 @@ void AI::groundedForEnemy(const FrameRequest& frameRequest)
 {
     enemy_.fieldWhenGrounded = CoreField::fromPlainFieldWithDrop(frameRequest.enemyPlayerFrameRequest().field);
     groundedForCommon(&enemy_, frameRequest.frameId);
+    if (behaviorRethinkAfterOpponentRensa_ && enemy_.currentRensaResult.chains > 0)
+        requestRethink();
     onGroundedForEnemy(frameRequest);
 }
 
@@ -1,16 +1,34 @@
 #ifndef CORE_CLIENT_AI_H_
 #define CORE_CLIENT_AI_H_
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "base/cancellation_token.h"
 #include "core/client/ai/drop_decision.h"
 #include "core/client/connector/client_connector.h"
+#include "core/frame_request.h"
 #include "core/kumipuyo_seq.h"
 #include "core/player_state.h"
 
 class CoreField;
 class PlainField;
-struct FrameRequest;
+
+// ThinkRequest holds the arguments of AI::think() for one game.
+// This is used to pass the requests of several games at once.
+struct ThinkRequest {
+    int frameId;
+    CoreField field;
+    KumipuyoSeq kumipuyoSeq;
+    PlayerState me;
+    PlayerState enemy;
+    bool fast;
+};
 
 // AI is a utility class of AI.
 // You need to implement think() at least.
@@ -23,6 +41,13 @@ public:
 
     // Set AI's behavior. If true, you can rethink next decision when the enemy has started his rensa.
     void setBehaviorRethinkAfterOpponentRensa(bool flag) { behaviorRethinkAfterOpponentRensa_ = flag; }
+    // Set AI's behavior. If true, after sending a decision, the next think() is started in background
+    // for the predicted state (our field after the decision), while the enemy moves and animations
+    // play out. When the actual state matches the predicted one, the pondered decision is used.
+    // Pondering needs the next 2 kumipuyos, so it happens only when we know them in advance,
+    // e.g. the enemy is ahead of us. Enable this only if think() is safe to run while the
+    // callbacks and gaze() are called in another thread.
+    void setBehaviorPonder(bool flag) { behaviorPonder_ = flag; }
 
 protected:
     AI(int argc, char* argv[], const std::string& name);
@@ -43,6 +68,25 @@ protected:
     virtual DropDecision think(int frameId, const CoreField&, const KumipuyoSeq&,
                                const PlayerState& me, const PlayerState& enemy, bool fast) const = 0;
 
+    // thinkCancellable is think() which can be interrupted. runLoop() calls this instead of think().
+    // |cancellationToken| is cancelled when the decision has turned out to be stale while thinking,
+    // e.g. ojamas are dropped or the enemy has fired some rensa (if you set behavior), and
+    // it expires when --think_timeout_ms (or --fast_think_timeout_ms) has passed.
+    // Once cancellationToken.shouldStop() becomes true, return as soon as possible.
+    // A decision made with a cancelled token is discarded, and the hand is thought again.
+    // The default implementation ignores |cancellationToken| and calls think().
+    virtual DropDecision thinkCancellable(int frameId, const CoreField&, const KumipuyoSeq&,
+                                          const PlayerState& me, const PlayerState& enemy, bool fast,
+                                          const CancellationToken& cancellationToken) const;
+
+    // thinkBatch will be called when the decisions of several independent games are
+    // necessary at once, e.g. in the batched endless mode. The i-th decision should be
+    // the decision for the i-th request.
+    // The default implementation calls gaze() with |enemy.field| and |enemy.seq|, and then
+    // think() for each request, so each decision is the same as the one of the unbatched game.
+    // Override this if your AI can share the setup among the requests or can think them together.
+    virtual std::vector<DropDecision> thinkBatch(const std::vector<ThinkRequest>&);
+
     // gaze will be called when AI should gaze the enemy's field.
     // |frameId| is the frameId where the enemy has started moving his puyo.
     // His moving puyo is the front puyo of the KumipuyoSeq.
@@ -127,6 +171,36 @@ private:
     // Returns the remembered sequence. If desynced, provided is returned as is.
     KumipuyoSeq rememberedSequence(int indexFrom, const KumipuyoSeq& provided) const;
 
+    // The requests are received in another thread, so that the current think can be
+    // cancelled as soon as an urgent request comes.
+    void runReceiverLoop();
+    // Returns false when the connection is closed and all the received requests are popped.
+    bool popFrameRequest(FrameRequest*);
+    // Returns true if the decision being thought will be stale by |frameRequest|.
+    bool isUrgentFrameRequest(const FrameRequest&) const;
+    // Calls thinkCancellable(). When |cancellable| is true, the think is cancelled by urgent requests.
+    DropDecision thinkInRunLoop(int frameId, const CoreField&, const KumipuyoSeq&, bool fast,
+                                bool cancellable, bool* cancelled);
+
+    struct Pondering {
+        ThinkRequest request;
+        CancellationToken cancellationToken;
+        DropDecision dropDecision;
+        bool started = false;
+        bool done = false;
+    };
+
+    // Starts pondering the next think if the next 2 kumipuyos are known.
+    void startPondering(int frameId);
+    // Returns true and sets |dropDecision| if the pondered request is the same as |request|.
+    // Otherwise, stops pondering. In both cases, nothing is pondered after this returns.
+    bool takePonderedDecision(const ThinkRequest& request, DropDecision* dropDecision);
+    void stopPondering();
+    static bool canReusePonderedDecision(const ThinkRequest& pondered, const ThinkRequest& actual);
+    // The ponder thread is started with the first pondering, and waits for the next one
+    // until the AI is destructed.
+    void runPonderLoop();
+
     std::string name_;
     ClientConnector connector_;
 
@@ -139,6 +213,19 @@ private:
     PlayerState enemy_;
 
     bool behaviorRethinkAfterOpponentRensa_;
+    bool behaviorPonder_;
+
+    std::mutex ponderMu_;
+    std::condition_variable ponderCondVar_;
+    std::unique_ptr<Pondering> pondering_;
+    std::thread ponderThread_;
+    bool ponderThreadStopping_ = false;
+
+    std::mutex receiverMu_;
+    std::condition_variable receiverCondVar_;
+    std::deque<FrameRequest> receivedRequests_;
+    bool receiverClosed_ = false;
+    CancellationToken thinkCancellationToken_;
 };
 
 #endif
@@ -1,5 +1,10 @@
 #include "core/client/ai/ai.h"
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include "core/core_field.h"
@@ -31,6 +36,43 @@ private:
     static const char* argv[];
 };
 
+// PonderTestAI counts the thinks. The think for BLOCKING_FRAME_ID continues until it's cancelled.
+class PonderTestAI : public AI {
+public:
+    static const int BLOCKING_FRAME_ID = 10;
+
+    PonderTestAI() : AI("ponder-test") {}
+
+    using AI::mutableMyPlayerState;
+
+    int numThinks() const { return numThinks_; }
+    bool blockingThinkCancelled() const { return blockingThinkCancelled_; }
+
+protected:
+    DropDecision think(int frameId, const CoreField& field, const KumipuyoSeq& seq,
+                       const PlayerState& me, const PlayerState& enemy, bool fast) const override
+    {
+        return thinkCancellable(frameId, field, seq, me, enemy, fast, CancellationToken());
+    }
+
+    DropDecision thinkCancellable(int frameId, const CoreField&, const KumipuyoSeq&,
+                                  const PlayerState&, const PlayerState&, bool,
+                                  const CancellationToken& token) const override
+    {
+        ++numThinks_;
+        if (frameId == BLOCKING_FRAME_ID) {
+            while (!token.shouldStop())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            blockingThinkCancelled_ = true;
+        }
+        return DropDecision(Decision(frameId % 6 + 1, 0), "frame " + std::to_string(frameId));
+    }
+
+private:
+    mutable std::atomic<int> numThinks_ { 0 };
+    mutable std::atomic<bool> blockingThinkCancelled_ { false };
+};
+
 class AITest : public testing::Test {
 protected:
     static bool isFieldInconsistent(const PlainField& lhs, const PlainField& rhs)
@@ -43,6 +85,17 @@ protected:
         return AI::mergeField(ours, provided, ojamaDropped);
     }
 
+    static bool canReusePonderedDecision(const ThinkRequest& pondered, const ThinkRequest& actual)
+    {
+        return AI::canReusePonderedDecision(pondered, actual);
+    }
+
+    static void startPondering(AI* ai, int frameId) { ai->startPondering(frameId); }
+    static DropDecision thinkInRunLoop(AI* ai, int frameId, const CoreField& field, const KumipuyoSeq& seq)
+    {
+        return ai->thinkInRunLoop(frameId, field, seq, false, false, nullptr);
+    }
+
     const PlayerState& myPlayerState() { return ai_.myPlayerState(); }
     const PlayerState& enemyPlayerState() { return ai_.enemyPlayerState(); }
 
@@ -593,3 +646,124 @@ TEST_F(AITest, mergeFieldOjama)
     EXPECT_EQ(expected1, mergeField(original, provided1, true));
     EXPECT_EQ(expected2, mergeField(original, provided2, true));
 }
+
+TEST(AIThinkBatchTest, defaultThinkBatch)
+{
+    // Returns a decision derived from the request, so that we can check the order.
+    class ColumnAI : public AI {
+    public:
+        ColumnAI() : AI("column") {}
+        using AI::thinkBatch;
+    protected:
+        DropDecision think(int frameId, const CoreField&, const KumipuyoSeq&,
+                           const PlayerState&, const PlayerState&, bool fast) const override
+        {
+            return DropDecision(Decision(frameId, fast ? 1 : 0), "column");
+        }
+        void gaze(int frameId, const CoreField&, const KumipuyoSeq&) override
+        {
+            gazedFrameIds.push_back(frameId);
+        }
+    public:
+        std::vector<int> gazedFrameIds;
+    };
+
+    ColumnAI ai;
+    std::vector<ThinkRequest> requests;
+    for (int x = 1; x <= 6; ++x) {
+        requests.push_back(ThinkRequest {
+            .frameId = x,
+            .field = CoreField(),
+            .kumipuyoSeq = KumipuyoSeq("RRBB"),
+            .me = PlayerState(),
+            .enemy = PlayerState(),
+            .fast = x % 2 == 0,
+        });
+    }
+
+    std::vector<DropDecision> decisions = ai.thinkBatch(requests);
+    ASSERT_EQ(6U, decisions.size());
+    for (int x = 1; x <= 6; ++x)
+        EXPECT_EQ(Decision(x, x % 2 == 0 ? 1 : 0), decisions[x - 1].decision());
+    EXPECT_EQ((std::vector<int> { 1, 2, 3, 4, 5, 6 }), ai.gazedFrameIds);
+
+    EXPECT_TRUE(ai.thinkBatch(std::vector<ThinkRequest>()).empty());
+}
+
+TEST_F(AITest, canReusePonderedDecision)
+{
+    PlayerState me;
+    me.hand = 3;
+    PlayerState enemy;
+    enemy.field = CoreField("  RR  ");
+    const ThinkRequest pondered { 100, CoreField("  BB  "), KumipuyoSeq("RRBB"), me, enemy, false };
+
+    EXPECT_TRUE(canReusePonderedDecision(pondered, pondered));
+
+    // The enemy may move while pondering.
+    ThinkRequest enemyMoved(pondered);
+    enemyMoved.enemy.field = CoreField("  RRGG");
+    EXPECT_TRUE(canReusePonderedDecision(pondered, enemyMoved));
+
+    ThinkRequest differentFrameId(pondered);
+    differentFrameId.frameId = 101;
+    EXPECT_FALSE(canReusePonderedDecision(pondered, differentFrameId));
+
+    ThinkRequest differentField(pondered);
+    differentField.field = CoreField("  BBY ");
+    EXPECT_FALSE(canReusePonderedDecision(pondered, differentField));
+
+    ThinkRequest differentSeq(pondered);
+    differentSeq.kumipuyoSeq = KumipuyoSeq("RRBBYY");
+    EXPECT_FALSE(canReusePonderedDecision(pondered, differentSeq));
+
+    ThinkRequest ojamaComing(pondered);
+    ojamaComing.me.pendingOjama = 6;
+    EXPECT_FALSE(canReusePonderedDecision(pondered, ojamaComing));
+
+    ThinkRequest enemyRensa(pondered);
+    enemyRensa.enemy.currentChainStartedFrameId = 90;
+    EXPECT_FALSE(canReusePonderedDecision(pondered, enemyRensa));
+}
+
+TEST_F(AITest, ponder)
+{
+    PonderTestAI ai;
+    ai.mutableMyPlayerState()->seq = KumipuyoSeq("RRBBGGYY");
+    const CoreField field;
+    const KumipuyoSeq seq("BBGGYY");
+
+    startPondering(&ai, 4);
+    DropDecision decision = thinkInRunLoop(&ai, 4, field, seq);
+    EXPECT_EQ(Decision(5, 0), decision.decision());
+    EXPECT_EQ(1, ai.numThinks());
+
+    // The pondered decision is used only once.
+    decision = thinkInRunLoop(&ai, 4, field, seq);
+    EXPECT_EQ(Decision(5, 0), decision.decision());
+    EXPECT_EQ(2, ai.numThinks());
+
+    // The same ponder thread is used for the next pondering.
+    startPondering(&ai, 5);
+    decision = thinkInRunLoop(&ai, 5, field, seq);
+    EXPECT_EQ(Decision(6, 0), decision.decision());
+    EXPECT_EQ(3, ai.numThinks());
+}
+
+TEST_F(AITest, ponderIsCancelledByDifferentRequest)
+{
+    PonderTestAI ai;
+    ai.mutableMyPlayerState()->seq = KumipuyoSeq("RRBBGGYY");
+    const CoreField field;
+    const KumipuyoSeq seq("BBGGYY");
+
+    startPondering(&ai, PonderTestAI::BLOCKING_FRAME_ID);
+    while (ai.numThinks() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // The frameId is different from the pondered one, so the pondering is cancelled.
+    DropDecision decision = thinkInRunLoop(&ai, 11, field, seq);
+    EXPECT_TRUE(ai.blockingThinkCancelled());
+    EXPECT_EQ(Decision(6, 0), decision.decision());
+    EXPECT_EQ(2, ai.numThinks());
+}
@@ -0,0 +1,136 @@
+#include "core/color_permutation.h"
+
+#include <smmintrin.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+#include "core/bit_field.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/kumipuyo_seq.h"
+
+using namespace std;
+
+namespace {
+
+const int NOT_FOUND = 1 << 16;
+
+// Returns the index of the lowest bit of |bits|. Since a column takes 16 bits,
+// this is the first position when scanning from the bottom of the leftmost column.
+int lowestBitIndex(const FieldBits& bits)
+{
+    const uint64_t low = _mm_cvtsi128_si64(bits.xmm());
+    if (low)
+        return __builtin_ctzll(low);
+    const uint64_t high = _mm_extract_epi64(bits.xmm(), 1);
+    if (high)
+        return 64 + __builtin_ctzll(high);
+    return NOT_FOUND;
+}
+
+} // namespace anonymous
+
+ColorPermutation::ColorPermutation()
+{
+    for (int i = 0; i < NUM_PUYO_COLORS; ++i)
+        colors_[i] = static_cast<PuyoColor>(i);
+}
+
+// static
+ColorPermutation ColorPermutation::canonicalize(const BitField& field)
+{
+    return canonicalize(field, KumipuyoSeq());
+}
+
+// static
+ColorPermutation ColorPermutation::canonicalize(const BitField& field, const KumipuyoSeq& seq)
+{
+    int firstAppearance[NUM_NORMAL_PUYO_COLORS];
+    for (int i = 0; i < NUM_NORMAL_PUYO_COLORS; ++i)
+        firstAppearance[i] = lowestBitIndex(field.bits(NORMAL_PUYO_COLORS[i]));
+
+    // The colors in |seq| come after all the colors in the field.
+    int order = 128;
+    for (const Kumipuyo& kp : seq) {
+        for (PuyoColor c : { kp.axis, kp.child }) {
+            if (!isNormalColor(c))
+                continue;
+            int& appearance = firstAppearance[normalColorIndex(c)];
+            if (appearance == NOT_FOUND)
+                appearance = order++;
+        }
+    }
+
+    PuyoColor sorted[NUM_NORMAL_PUYO_COLORS];
+    copy(begin(NORMAL_PUYO_COLORS), end(NORMAL_PUYO_COLORS), sorted);
+    stable_sort(begin(sorted), end(sorted), [&](PuyoColor lhs, PuyoColor rhs) {
+        return firstAppearance[normalColorIndex(lhs)] < firstAppearance[normalColorIndex(rhs)];
+    });
+
+    ColorPermutation perm;
+    for (int i = 0; i < NUM_NORMAL_PUYO_COLORS; ++i)
+        perm.colors_[ordinal(sorted[i])] = NORMAL_PUYO_COLORS[i];
+    return perm;
+}
+
+BitField ColorPermutation::apply(const BitField& field) const
+{
+    BitField result(field);
+    for (PuyoColor c : NORMAL_PUYO_COLORS)
+        result.setColorAll(field.bits(c), apply(c));
+    return result;
+}
+
+CoreField ColorPermutation::apply(const CoreField& field) const
+{
+    return CoreField(apply(field.bitField()));
+}
+
+ColumnPuyoList ColorPermutation::apply(const ColumnPuyoList& cpl) const
+{
+    ColumnPuyoList result;
+    for (int x = 1; x <= 6; ++x) {
+        for (int i = 0; i < cpl.sizeOn(x); ++i)
+            result.add(x, apply(cpl.get(x, i)));
+    }
+    return result;
+}
+
+KumipuyoSeq ColorPermutation::apply(const KumipuyoSeq& seq) const
+{
+    KumipuyoSeq result;
+    for (const Kumipuyo& kp : seq)
+        result.add(Kumipuyo(apply(kp.axis), apply(kp.child)));
+    return result;
+}
+
+ColorPermutation ColorPermutation::inverse() const
+{
+    ColorPermutation perm;
+    for (int i = 0; i < NUM_PUYO_COLORS; ++i)
+        perm.colors_[ordinal(colors_[i])] = static_cast<PuyoColor>(i);
+    return perm;
+}
+
+bool ColorPermutation::isIdentity() const
+{
+    return *this == ColorPermutation();
+}
+
+string ColorPermutation::toString() const
+{
+    ostringstream ss;
+    for (int i = 0; i < NUM_NORMAL_PUYO_COLORS; ++i) {
+        if (i > 0)
+            ss << ' ';
+        ss << toChar(NORMAL_PUYO_COLORS[i]) << "->" << toChar(apply(NORMAL_PUYO_COLORS[i]));
+    }
+    return ss.str();
+}
+
+bool operator==(const ColorPermutation& lhs, const ColorPermutation& rhs)
+{
+    return equal(begin(lhs.colors_), end(lhs.colors_), begin(rhs.colors_));
+}
@@ -0,0 +1,55 @@
+#ifndef CORE_COLOR_PERMUTATION_H_
+#define CORE_COLOR_PERMUTATION_H_
+
+#include <string>
+
+#include "core/puyo_color.h"
+
+class BitField;
+class ColumnPuyoList;
+class CoreField;
+class KumipuyoSeq;
+
+// ColorPermutation is a permutation of the normal puyo colors.
+// The other colors (EMPTY, OJAMA, WALL, IRON) are always mapped to themselves.
+//
+// Most of evaluations don't depend on the actual colors of puyos, so the fields that differ
+// only by the colors can share the evaluation. canonicalize() returns the permutation that
+// relabels such fields to the same field:
+//
+//   ColorPermutation perm = ColorPermutation::canonicalize(field.bitField(), seq);
+//   CoreField canonicalField = perm.apply(field);
+//   ... (evaluate canonicalField) ...
+//   ColumnPuyoList actualPuyos = perm.inverse().apply(canonicalPuyos);
+class ColorPermutation {
+public:
+    // Creates the identity permutation.
+    ColorPermutation();
+
+    // Returns the permutation that relabels the colors in the order of their first appearance:
+    // the color of the puyo which appears first when scanning the field from the bottom of
+    // the leftmost column becomes RED, the next one becomes BLUE, and so on. The colors that
+    // don't appear in the field are ordered by the first appearance in |seq|.
+    static ColorPermutation canonicalize(const BitField&, const KumipuyoSeq& seq);
+    static ColorPermutation canonicalize(const BitField&);
+
+    PuyoColor apply(PuyoColor c) const { return colors_[ordinal(c)]; }
+
+    BitField apply(const BitField&) const;
+    CoreField apply(const CoreField&) const;
+    ColumnPuyoList apply(const ColumnPuyoList&) const;
+    KumipuyoSeq apply(const KumipuyoSeq&) const;
+
+    ColorPermutation inverse() const;
+    bool isIdentity() const;
+
+    std::string toString() const;
+
+    friend bool operator==(const ColorPermutation&, const ColorPermutation&);
+    friend bool operator!=(const ColorPermutation& lhs, const ColorPermutation& rhs) { return !(lhs == rhs); }
+
+private:
+    PuyoColor colors_[NUM_PUYO_COLORS];
+};
+
+#endif // CORE_COLOR_PERMUTATION_H_
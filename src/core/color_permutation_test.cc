@@ -0,0 +1,88 @@
+#include "core/color_permutation.h"
+
+#include <gtest/gtest.h>
+
+#include "core/bit_field.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/kumipuyo_seq.h"
+
+TEST(ColorPermutationTest, identity)
+{
+    ColorPermutation perm;
+    EXPECT_TRUE(perm.isIdentity());
+    for (int i = 0; i < NUM_PUYO_COLORS; ++i)
+        EXPECT_EQ(static_cast<PuyoColor>(i), perm.apply(static_cast<PuyoColor>(i)));
+}
+
+TEST(ColorPermutationTest, canonicalize)
+{
+    BitField bf(
+        "GG...."
+        "YBO..."
+        "YBBR..");
+
+    ColorPermutation perm = ColorPermutation::canonicalize(bf);
+    // Scanning from the bottom of the leftmost column: Y, G, B, R.
+    EXPECT_EQ(PuyoColor::RED, perm.apply(PuyoColor::YELLOW));
+    EXPECT_EQ(PuyoColor::BLUE, perm.apply(PuyoColor::GREEN));
+    EXPECT_EQ(PuyoColor::YELLOW, perm.apply(PuyoColor::BLUE));
+    EXPECT_EQ(PuyoColor::GREEN, perm.apply(PuyoColor::RED));
+    EXPECT_EQ(PuyoColor::OJAMA, perm.apply(PuyoColor::OJAMA));
+    EXPECT_EQ(PuyoColor::EMPTY, perm.apply(PuyoColor::EMPTY));
+
+    BitField expected(
+        "BB...."
+        "RYO..."
+        "RYYG..");
+    EXPECT_EQ(expected, perm.apply(bf));
+}
+
+TEST(ColorPermutationTest, canonicalizeWithKumipuyoSeq)
+{
+    BitField bf(
+        "G.....");
+
+    ColorPermutation perm = ColorPermutation::canonicalize(bf, KumipuyoSeq("GYRY"));
+    EXPECT_EQ(PuyoColor::RED, perm.apply(PuyoColor::GREEN));
+    EXPECT_EQ(PuyoColor::BLUE, perm.apply(PuyoColor::YELLOW));
+    EXPECT_EQ(PuyoColor::YELLOW, perm.apply(PuyoColor::RED));
+    EXPECT_EQ(PuyoColor::GREEN, perm.apply(PuyoColor::BLUE));
+
+    EXPECT_EQ(KumipuyoSeq("RBYB"), perm.apply(KumipuyoSeq("GYRY")));
+}
+
+TEST(ColorPermutationTest, canonicalFieldIsSharedAmongRelabeledFields)
+{
+    CoreField f1(
+        "RRB..."
+        "BBYY..");
+    CoreField f2(
+        "GGR..."
+        "RRBB..");
+
+    CoreField c1 = ColorPermutation::canonicalize(f1.bitField()).apply(f1);
+    CoreField c2 = ColorPermutation::canonicalize(f2.bitField()).apply(f2);
+    EXPECT_EQ(c1, c2);
+    EXPECT_EQ(2, c1.height(1));
+    EXPECT_EQ(2, c1.height(3));
+}
+
+TEST(ColorPermutationTest, inverse)
+{
+    CoreField cf(
+        "GGR..."
+        "RYBB..");
+
+    ColorPermutation perm = ColorPermutation::canonicalize(cf.bitField());
+    EXPECT_FALSE(perm.isIdentity());
+    EXPECT_TRUE(perm.inverse().inverse() == perm);
+    EXPECT_EQ(cf, perm.inverse().apply(perm.apply(cf)));
+
+    ColumnPuyoList cpl;
+    cpl.add(1, PuyoColor::RED, 2);
+    cpl.add(3, PuyoColor::GREEN);
+    cpl.add(3, PuyoColor::YELLOW);
+    EXPECT_EQ(cpl, perm.inverse().apply(perm.apply(cpl)));
+    EXPECT_EQ(perm.apply(PuyoColor::GREEN), perm.apply(cpl).get(3, 0));
+}
@@ -9,9 +9,9 @@ using namespace std;
 string ColumnPuyoList::toString() const
 {
     ostringstream oss;
-    for (int i = 0; i < 6; ++i) {
-        for (int j = 0; j < size_[i]; ++j) {
-            oss << '(' << (i + 1) << toChar(puyos_[i][j]) << ')';
+    for (int x = 1; x <= 6; ++x) {
+        for (int i = 0; i < sizeOn(x); ++i) {
+            oss << '(' << x << toChar(get(x, i)) << ')';
         }
     }
 
@@ -21,16 +21,5 @@ string ColumnPuyoList::toString() const
 // static
 bool operator==(const ColumnPuyoList& lhs, const ColumnPuyoList& rhs)
 {
-    for (int i = 0; i < 6; ++i) {
-        if (lhs.size_[i] != rhs.size_[i])
-            return false;
-    }
-
-    for (int i = 0; i < 6; ++i) {
-        for (int j = 0; j < lhs.size_[i]; ++j) {
-            if (lhs.puyos_[i][j] != rhs.puyos_[i][j])
-                return false;
-        }
-    }
-    return true;
+    return std::equal(lhs.columns_, lhs.columns_ + 6, rhs.columns_);
 }
@@ -1,27 +1,33 @@
 #ifndef CORE_COLUMN_PUYO_LIST_H_
 #define CORE_COLUMN_PUYO_LIST_H_
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <iterator>
 #include <string>
 
 #include <glog/logging.h>
 
-#include "base/small_int_set.h"
+#include "base/bmi.h"
 #include "core/column_puyo.h"
 #include "core/puyo_color.h"
 
 // ColumnPuyoList is a list of PuyoColor for each column.
 // You can think this is a list of ColumnPuyo, however, the implementation is different.
+//
+// Each column is packed into 32 bits: the i-th PuyoColor takes 3 bits from bit 3*i,
+// and the size takes 4 bits from bit 24. So copying a ColumnPuyoList is cheap, and
+// most of operations are done with bit operations.
 class ColumnPuyoList {
 public:
-    ColumnPuyoList() : size_{}, placeHolders_{} {}
+    ColumnPuyoList() : columns_{} {}
 
     // Returns the size of column |x|.
     int sizeOn(int x) const
     {
         DCHECK(1 <= x && x <= 6) << x;
-        return size_[x-1];
+        return columns_[x-1] >> SIZE_SHIFT;
     }
 
     // Returns the |i|-th PuyoColor of column |x|
@@ -29,7 +35,7 @@ public:
     {
         DCHECK(1 <= x && x <= 6) << x;
         DCHECK(0 <= i && i < sizeOn(x)) << x << ' ' << i;
-        return puyos_[x-1][i];
+        return static_cast<PuyoColor>((columns_[x-1] >> (3 * i)) & 0x7);
     }
 
     PuyoColor top(int x) const
@@ -39,36 +45,42 @@ public:
         return get(x, sizeOn(x) - 1);
     }
 
+    // Returns the |bit|-th bit of each PuyoColor on column |x|.
+    // The lowest bit corresponds to the 0-th PuyoColor.
+    // This is useful to set the puyos to BitField at once.
+    std::uint32_t colorBitsOn(int x, int bit) const
+    {
+        DCHECK(1 <= x && x <= 6) << x;
+        DCHECK(0 <= bit && bit < 3) << bit;
+        return static_cast<std::uint32_t>(bmi::extractBits(colorsOn(x - 1) >> bit, SLOT_LSB_MASK));
+    }
+
     bool isEmpty() const { return size() == 0; }
-    int size() const { return size_[0] + size_[1] + size_[2] + size_[3] + size_[4] + size_[5]; }
-    void clear() { std::fill(size_, size_ + 6, 0); }
+    int size() const
+    {
+        int s = 0;
+        for (int i = 0; i < 6; ++i)
+            s += columns_[i] >> SIZE_SHIFT;
+        return s;
+    }
+    void clear() { std::fill(columns_, columns_ + 6, 0); }
 
     bool add(const ColumnPuyo& cp) { return add(cp.x, cp.color); }
 
     // Adds PuyoColor |c| to column |x|. Returns false if failed.
     // TODO(mayah): If |c| is PuyoColor::EMPTY or PuyoColor::IRON, these are should be
     // treated as a placeholder.
-    bool add(int x, PuyoColor c)
-    {
-        DCHECK(1 <= x && x <= 6);
-        if (MAX_SIZE <= size_[x-1])
-            return false;
-        if (isPlaceHolder(c))
-            placeHolders_[x-1].set(size_[x-1]);
-        puyos_[x-1][size_[x-1]++] = c;
-        return true;
-    }
+    bool add(int x, PuyoColor c) { return add(x, c, 1); }
     bool add(int x, PuyoColor c, int n)
     {
         DCHECK(1 <= x && x <= 6);
-        if (MAX_SIZE < size_[x-1] + n)
+        DCHECK_GE(n, 0);
+        int s = sizeOn(x);
+        if (MAX_SIZE < s + n)
             return false;
-        for (int i = 0; i < n; ++i) {
-            if (isPlaceHolder(c))
-                placeHolders_[x-1].set(size_[x-1] + i);
-            puyos_[x-1][size_[x-1] + i] = c;
-        }
-        size_[x-1] += n;
+        // Repeats |c| |n| times by multiplying the LSB of each slot.
+        std::uint32_t repeated = ordinal(c) * (SLOT_LSB_MASK & ((1U << (3 * n)) - 1));
+        set(x - 1, s + n, colorsOn(x - 1) | (repeated << (3 * s)));
         return true;
     }
 
@@ -77,39 +89,40 @@ public:
     bool merge(const ColumnPuyoList& cpl)
     {
         for (int i = 0; i < 6; ++i) {
-            if (MAX_SIZE < size_[i] + std::max(0, cpl.size_[i] - placeHolders_[i].size()))
+            int size = columns_[i] >> SIZE_SHIFT;
+            int otherSize = cpl.columns_[i] >> SIZE_SHIFT;
+            int numPlaceHolders = __builtin_popcount(placeHolderBits(i));
+            if (MAX_SIZE < size + std::max(0, otherSize - numPlaceHolders))
                 return false;
         }
 
         for (int i = 0; i < 6; ++i) {
-            if (cpl.size_[i] < placeHolders_[i].size()) {
-                int discard = placeHolders_[i].size() - cpl.size_[i];
-                for (int j = 0; j < discard; ++j)
-                    placeHolders_[i].removeSmallest();
-                for (int j = 0; j < cpl.size_[i]; ++j) {
-                    int k = placeHolders_[i].smallest();
-                    placeHolders_[i].removeSmallest();
-                    puyos_[i][k] = cpl.puyos_[i][j];
-                }
-            } else {
-                int j = 0;
-                while (!placeHolders_[i].isEmpty()) {
-                    int k = placeHolders_[i].smallest();
-                    placeHolders_[i].removeSmallest();
-                    puyos_[i][k] = cpl.puyos_[i][j];
-                    ++j;
-                }
-
-                for (; j < cpl.size_[i]; ++j)
-                    puyos_[i][size_[i]++] = cpl.puyos_[i][j];
+            int size = columns_[i] >> SIZE_SHIFT;
+            int otherSize = cpl.columns_[i] >> SIZE_SHIFT;
+            std::uint32_t colors = colorsOn(i);
+            std::uint32_t otherColors = cpl.colorsOn(i);
+
+            // Fast path: no place holder. Just concatenate the bits.
+            std::uint32_t placeHolders = placeHolderBits(i);
+            if (placeHolders == 0) {
+                set(i, size + otherSize, colors | (otherColors << (3 * size)));
+                continue;
             }
 
-            SmallIntSet newPlaceHolder;
-            for (int j = 0; j < size_[i]; ++j) {
-                if (isPlaceHolder(cpl.puyos_[i][j]))
-                    newPlaceHolder.set(j);
+            // When the place holders are more than |cpl|, the lower place holders are discarded.
+            for (int discard = __builtin_popcount(placeHolders) - otherSize; discard > 0; --discard)
+                placeHolders &= placeHolders - 1;
+
+            int j = 0;
+            while (placeHolders) {
+                int shift = __builtin_ctz(placeHolders);
+                colors = (colors & ~(0x7U << shift)) | (((otherColors >> (3 * j)) & 0x7) << shift);
+                placeHolders &= placeHolders - 1;
+                ++j;
             }
-            placeHolders_[i] = newPlaceHolder;
+
+            colors |= (otherColors >> (3 * j)) << (3 * size);
+            set(i, size + otherSize - j, colors);
         }
 
         return true;
@@ -119,10 +132,8 @@ public:
     {
         DCHECK(1 <= x && x <= 6);
         DCHECK_GT(sizeOn(x), 0);
-        PuyoColor c = puyos_[x-1][size_[x-1] - 1];
-        if (isPlaceHolder(c))
-            placeHolders_[x-1].unset(size_[x-1] - 1);
-        size_[x-1] -= 1;
+        int s = sizeOn(x) - 1;
+        set(x - 1, s, colorsOn(x - 1) & ((1U << (3 * s)) - 1));
     }
 
     // Calls |f| for each pair of (x, PuyoColor).
@@ -144,25 +155,38 @@ public:
     size_t hash() const
     {
         size_t v = 0;
-        for (int i = 0; i < 6; ++i) {
-            v += 37 * v + size_[i];
-            for (int j = 0; j < size_[i]; ++j) {
-                v += 37 * v + ordinal(puyos_[i][j]);
-            }
-        }
+        for (int i = 0; i < 6; ++i)
+            v += 37 * v + columns_[i];
 
         return v;
     }
 
 private:
     static const int MAX_SIZE = 8;
+    static const int SIZE_SHIFT = 24;
+    static const std::uint32_t COLORS_MASK = (1U << SIZE_SHIFT) - 1;
+    // The lowest bit of each 3-bit slot.
+    static const std::uint32_t SLOT_LSB_MASK = 0x249249;
 
-    static bool isPlaceHolder(PuyoColor c) { return c == PuyoColor::IRON; }
+    std::uint32_t colorsOn(int i) const { return columns_[i] & COLORS_MASK; }
+    void set(int i, int size, std::uint32_t colors)
+    {
+        DCHECK(0 <= size && size <= MAX_SIZE) << size;
+        columns_[i] = (static_cast<std::uint32_t>(size) << SIZE_SHIFT) | colors;
+    }
+
+    // Returns the bits where the place holder (PuyoColor::IRON = 011) exists.
+    // The bit is set on the lowest bit of each slot.
+    std::uint32_t placeHolderBits(int i) const
+    {
+        std::uint32_t c = colorsOn(i);
+        std::uint32_t sizeMask = (1U << (3 * (columns_[i] >> SIZE_SHIFT))) - 1;
+        return c & (c >> 1) & ~(c >> 2) & SLOT_LSB_MASK & sizeMask;
+    }
 
     // We don't make this std::vector due to performance reason.
-    int size_[6];
-    PuyoColor puyos_[6][MAX_SIZE];
-    SmallIntSet placeHolders_[6];
+    // Colors beyond the size are always 0, so we can compare columns_ directly.
+    std::uint32_t columns_[6];
 };
 
 namespace std {
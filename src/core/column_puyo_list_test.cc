@@ -36,6 +36,35 @@ TEST(ColumnPuyoListTest, add)
     EXPECT_FALSE(cpl.isEmpty());
 }
 
+TEST(ColumnPuyoListTest, removeTopFrom)
+{
+    ColumnPuyoList cpl;
+    ASSERT_TRUE(cpl.add(2, PuyoColor::RED));
+    ASSERT_TRUE(cpl.add(2, PuyoColor::BLUE));
+
+    ColumnPuyoList expected;
+    ASSERT_TRUE(expected.add(2, PuyoColor::RED));
+
+    cpl.removeTopFrom(2);
+    EXPECT_EQ(1, cpl.sizeOn(2));
+    EXPECT_EQ(PuyoColor::RED, cpl.top(2));
+    EXPECT_TRUE(expected == cpl);
+}
+
+TEST(ColumnPuyoListTest, colorBitsOn)
+{
+    ColumnPuyoList cpl;
+    ASSERT_TRUE(cpl.add(4, PuyoColor::RED));    // 100
+    ASSERT_TRUE(cpl.add(4, PuyoColor::BLUE));   // 101
+    ASSERT_TRUE(cpl.add(4, PuyoColor::YELLOW)); // 110
+    ASSERT_TRUE(cpl.add(4, PuyoColor::OJAMA));  // 001
+
+    EXPECT_EQ(0xAU, cpl.colorBitsOn(4, 0));
+    EXPECT_EQ(0x4U, cpl.colorBitsOn(4, 1));
+    EXPECT_EQ(0x7U, cpl.colorBitsOn(4, 2));
+    EXPECT_EQ(0U, cpl.colorBitsOn(1, 0));
+}
+
 TEST(ColumnPuyoListTest, merge)
 {
     ColumnPuyoList cpl;
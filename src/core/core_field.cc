@@ -156,6 +156,69 @@ int CoreField::valleyDepth(int x) const
     return std::min(left, right);
 }
 
+int CoreField::computeKumipuyoPlacements(KumipuyoPlacement placements[22], int* numRepPlacements) const
+{
+    // The first 11 decisions cover all the placements of a kumipuyo whose colors are the same.
+    static const Decision DECISIONS[] = {
+        Decision(2, 3), Decision(3, 3), Decision(3, 1), Decision(4, 1),
+        Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2),
+        Decision(4, 2), Decision(5, 2), Decision(6, 2),
+        Decision(1, 1), Decision(2, 1), Decision(4, 3), Decision(5, 3),
+        Decision(6, 3), Decision(1, 0), Decision(2, 0), Decision(3, 0),
+        Decision(4, 0), Decision(5, 0), Decision(6, 0),
+    };
+
+    // reachable[x] is true if a kumipuyo can be moved to column x. The kumipuyo goes from column 3
+    // to the left or to the right, so each column is checked only once.
+    // See PuyoController::isReachable() for the rule.
+    bool reachable[MAP_WIDTH] {};
+    reachable[3] = true;
+    for (int dx = -1; dx <= 1; dx += 2) {
+        bool yMightBe13 = height(2) >= 12 && height(4) >= 12;
+        for (int x = 3 + dx; 1 <= x && x <= WIDTH; x += dx) {
+            if (height(x) <= 11) {
+                yMightBe13 = false;
+            } else if (height(x) == 12 &&
+                       (yMightBe13 || height(x - dx) == 11 || (std::abs(x - 3) >= 2 && height(x - 2 * dx) == 12))) {
+                yMightBe13 = true;
+            } else {
+                break;
+            }
+            reachable[x] = true;
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < 22; ++i) {
+        if (i == 11 && numRepPlacements)
+            *numRepPlacements = n;
+
+        const Decision& decision = DECISIONS[i];
+        const int x1 = decision.axisX();
+        const int x2 = decision.childX();
+        // The farther column from column 3 decides the reachability.
+        if (!reachable[std::abs(x1 - 3) >= std::abs(x2 - 3) ? x1 : x2])
+            continue;
+
+        // Checks that dropKumipuyo() will succeed. This also covers the rotation check of
+        // PuyoController::isReachable() for r == 2.
+        if (x1 == x2) {
+            if (height(x1) >= 12)
+                continue;
+        } else {
+            if (height(x1) >= 13 || height(x2) >= 13)
+                continue;
+        }
+
+        KumipuyoPlacement& placement = placements[n++];
+        placement.decision = decision;
+        placement.dropFrames = framesToDropNext(decision);
+        placement.isChigiri = x1 != x2 && height(x1) != height(x2);
+    }
+
+    return n;
+}
+
 bool CoreField::dropKumipuyo(const Decision& decision, const Kumipuyo& kumiPuyo)
 {
     int x1 = decision.axisX();
@@ -291,13 +354,21 @@ bool CoreField::dropPuyoOnWithMaxHeight(int x, PuyoColor c, int maxHeight)
 
 bool CoreField::dropPuyoListWithMaxHeight(const ColumnPuyoList& cpl, int maxHeight)
 {
+    const int limitHeight = std::min(13, maxHeight);
+
+    // Since ColumnPuyoList is packed, we can put the whole column at once.
     for (int x = 1; x <= 6; ++x) {
         int s = cpl.sizeOn(x);
-        for (int i = 0; i < s; ++i) {
-            PuyoColor pc = cpl.get(x, i);
-            if (!dropPuyoOnWithMaxHeight(x, pc, maxHeight))
-                return false;
-        }
+        if (s == 0)
+            continue;
+        if (height(x) + s > limitHeight)
+            return false;
+
+        const std::uint32_t colorBits[3] {
+            cpl.colorBitsOn(x, 0), cpl.colorBitsOn(x, 1), cpl.colorBitsOn(x, 2)
+        };
+        field_.setColumnColorBits(x, height(x) + 1, colorBits);
+        heights_[x] += s;
     }
 
     return true;
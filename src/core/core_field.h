@@ -103,8 +103,25 @@ public:
     // ----------------------------------------------------------------------
     // field manipulation
 
+    // KumipuyoPlacement is a decision computed by computeKumipuyoPlacements().
+    struct KumipuyoPlacement {
+        Decision decision;
+        int dropFrames;
+        bool isChigiri;
+    };
+    // Computes all the decisions where a kumipuyo can be reached and dropped, with their chigiri
+    // flags and drop frames, in one pass over the heights. This is the same as checking
+    // PuyoController::isReachable(), dropKumipuyo(), isChigiriDecision() and framesToDropNext()
+    // for each of the 22 decisions, but the reachability is computed once per column.
+    // The placements of a kumipuyo whose axis and child have the same color are the first
+    // |*numRepPlacements| ones. Returns the number of placements.
+    int computeKumipuyoPlacements(KumipuyoPlacement placements[22], int* numRepPlacements = nullptr) const;
+
     // Drop kumipuyo with decision.
     bool dropKumipuyo(const Decision&, const Kumipuyo&);
+    // Reverts dropKumipuyo(|decision|, ...) which has succeeded. The field must not have been changed
+    // since then, e.g. by simulate(). So, apply/undo is usable only when no rensa occurs.
+    void undoDropKumipuyo(const Decision& decision);
 
     // Returns #frame to drop the next KumiPuyo with decision. This function does not drop the puyo.
     int framesToDropNext(const Decision&) const;
@@ -169,6 +186,20 @@ public:
     int simulateFast();
     template<typename Tracker> int simulateFast(Tracker*);
 
+    // Bounded simulation. When you only need to compare the rensa with a bound, these are faster
+    // than simulate(), since they stop as soon as the bound is reached. In that case, the field
+    // is left in the middle of the rensa.
+    // Simulates at most |maxChains| chains, and returns the number of the simulated chains.
+    // e.g. simulateUntil(n + 1) <= n means the rensa has at most n chains.
+    int simulateUntil(int maxChains);
+    template<typename Tracker> int simulateUntil(int maxChains, Tracker*);
+    // Returns true if the rensa has |minChains| chains or more.
+    bool simulateAtLeast(int minChains) { return simulateUntil(minChains) >= minChains; }
+    // Simulates until the score reaches |minScore|, and returns the result of the simulated chains.
+    // e.g. simulateUntilScore(s).score >= s means the rensa makes |s| points or more.
+    RensaResult simulateUntilScore(int minScore);
+    template<typename Tracker> RensaResult simulateUntilScore(int minScore, SimulationContext*, Tracker*);
+
     // Vanishes the connected puyos, and drop the puyos in the air. Score will be returned.
     RensaStepResult vanishDrop();
     RensaStepResult vanishDrop(SimulationContext*);
@@ -245,8 +276,9 @@ RensaResult CoreField::simulate(Tracker* tracker)
 template<typename Tracker>
 RensaResult CoreField::simulate(SimulationContext* context, Tracker* tracker)
 {
-#if defined(__AVX2__) and defined(__BMI2__)
-    RensaResult result = field_.simulateAVX2(context, tracker);
+#ifdef HAVE_TARGET_AVX2_BMI2
+    RensaResult result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.simulateAVX2(context, tracker) : field_.simulate(context, tracker);
 #else
     RensaResult result = field_.simulate(context, tracker);
 #endif
@@ -265,8 +297,9 @@ int CoreField::simulateFast()
 template<typename Tracker>
 int CoreField::simulateFast(Tracker* tracker)
 {
-#if defined(__AVX2__) and defined(__BMI2__)
-    int result = field_.simulateFastAVX2(tracker);
+#ifdef HAVE_TARGET_AVX2_BMI2
+    int result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.simulateFastAVX2(tracker) : field_.simulateFast(tracker);
 #else
     int result = field_.simulateFast(tracker);
 #endif
@@ -275,6 +308,50 @@ int CoreField::simulateFast(Tracker* tracker)
     return result;
 }
 
+inline
+int CoreField::simulateUntil(int maxChains)
+{
+    RensaNonTracker tracker;
+    return simulateUntil(maxChains, &tracker);
+}
+
+template<typename Tracker>
+int CoreField::simulateUntil(int maxChains, Tracker* tracker)
+{
+#ifdef HAVE_TARGET_AVX2_BMI2
+    int result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.simulateFastUntilAVX2(maxChains, tracker) : field_.simulateFastUntil(maxChains, tracker);
+#else
+    int result = field_.simulateFastUntil(maxChains, tracker);
+#endif
+
+    field_.calculateHeight(heights_);
+    return result;
+}
+
+inline
+RensaResult CoreField::simulateUntilScore(int minScore)
+{
+    SimulationContext context;
+    RensaNonTracker tracker;
+    return simulateUntilScore(minScore, &context, &tracker);
+}
+
+template<typename Tracker>
+RensaResult CoreField::simulateUntilScore(int minScore, SimulationContext* context, Tracker* tracker)
+{
+#ifdef HAVE_TARGET_AVX2_BMI2
+    RensaResult result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.simulateUntilScoreAVX2(minScore, context, tracker) :
+        field_.simulateUntilScore(minScore, context, tracker);
+#else
+    RensaResult result = field_.simulateUntilScore(minScore, context, tracker);
+#endif
+
+    field_.calculateHeight(heights_);
+    return result;
+}
+
 inline
 RensaStepResult CoreField::vanishDrop()
 {
@@ -299,8 +376,9 @@ RensaStepResult CoreField::vanishDrop(Tracker* tracker)
 template<typename Tracker>
 RensaStepResult CoreField::vanishDrop(SimulationContext* context, Tracker* tracker)
 {
-#if defined(__AVX2__) and defined(__BMI2__)
-    RensaStepResult result = field_.vanishDropAVX2(context, tracker);
+#ifdef HAVE_TARGET_AVX2_BMI2
+    RensaStepResult result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.vanishDropAVX2(context, tracker) : field_.vanishDrop(context, tracker);
 #else
     RensaStepResult result = field_.vanishDrop(context, tracker);
 #endif
@@ -319,8 +397,9 @@ bool CoreField::vanishDropFast(Tracker* tracker)
 template<typename Tracker>
 bool CoreField::vanishDropFast(SimulationContext* context, Tracker* tracker)
 {
-#if defined(__AVX2__) and defined(__BMI2__)
-    bool result = field_.vanishDropFastAVX2(context, tracker);
+#ifdef HAVE_TARGET_AVX2_BMI2
+    bool result = (BitField::kernel() != BitField::Kernel::SSE) ?
+        field_.vanishDropFastAVX2(context, tracker) : field_.vanishDropFast(context, tracker);
 #else
     bool result = field_.vanishDropFast(context, tracker);
 #endif
@@ -336,6 +415,14 @@ void CoreField::removePuyoFrom(int x)
     unsafeSet(x, heights_[x]--, PuyoColor::EMPTY);
 }
 
+inline
+void CoreField::undoDropKumipuyo(const Decision& decision)
+{
+    // When both puyos are on the same column, the order doesn't matter.
+    removePuyoFrom(decision.axisX());
+    removePuyoFrom(decision.childX());
+}
+
 namespace std {
 
 template<>
@@ -8,7 +8,9 @@
 
 #include "core/decision.h"
 #include "core/frame.h"
+#include "core/kumipuyo.h"
 #include "core/position.h"
+#include "core/puyo_controller.h"
 #include "core/rensa_result.h"
 
 using namespace std;
@@ -296,6 +298,63 @@ TEST(CoreFieldTest, simulate2)
     EXPECT_EQ(frames, rensaResult.frames);
 }
 
+TEST(CoreFieldTest, simulateUntil)
+{
+    const CoreField original(
+        "..B..."
+        "..BBYB"
+        "RRRRBB");
+
+    {
+        CoreField cf(original);
+        EXPECT_EQ(1, cf.simulateUntil(1));
+        // The field is in the middle of the rensa.
+        EXPECT_EQ(CoreField("..B.YB"
+                            "..BBBB"), cf);
+        EXPECT_EQ(2, cf.height(3));
+    }
+    {
+        CoreField cf(original);
+        EXPECT_EQ(2, cf.simulateUntil(3));
+        CoreField expected(original);
+        expected.simulate();
+        EXPECT_EQ(expected, cf);
+    }
+
+    EXPECT_TRUE(CoreField(original).simulateAtLeast(2));
+    EXPECT_FALSE(CoreField(original).simulateAtLeast(3));
+    EXPECT_EQ(0, CoreField("RRR...").simulateUntil(3));
+}
+
+TEST(CoreFieldTest, simulateUntilScore)
+{
+    const CoreField original(
+        "..B..."
+        "..BBYB"
+        "RRRRBB");
+
+    {
+        CoreField cf(original);
+        RensaResult rensaResult = cf.simulateUntilScore(40);
+        EXPECT_EQ(1, rensaResult.chains);
+        EXPECT_EQ(40, rensaResult.score);
+        EXPECT_EQ(FRAMES_VANISH_ANIMATION + FRAMES_TO_DROP_FAST[1] + FRAMES_GROUNDING, rensaResult.frames);
+    }
+    {
+        CoreField cf(original);
+        RensaResult rensaResult = cf.simulateUntilScore(41);
+        CoreField expected(original);
+        EXPECT_EQ(expected.simulate(), rensaResult);
+        EXPECT_EQ(expected, cf);
+    }
+    {
+        CoreField cf(original);
+        RensaResult rensaResult = cf.simulateUntilScore(10000);
+        EXPECT_EQ(2, rensaResult.chains);
+        EXPECT_EQ(700, rensaResult.score);
+    }
+}
+
 void testUrl(string url, int expected_chains, int expected_score)
 {
     CoreField f(url);
@@ -579,6 +638,45 @@ TEST(CoreFieldTest, dropPuyoOnWithMaxHeightEdgeCase)
     EXPECT_FALSE(cf.dropPuyoOnWithMaxHeight(1, PuyoColor::RED, 14));
 }
 
+TEST(CoreFieldTest, dropPuyoList)
+{
+    CoreField cf("..R..."
+                 "..R...");
+
+    ColumnPuyoList cpl;
+    ASSERT_TRUE(cpl.add(1, PuyoColor::BLUE));
+    ASSERT_TRUE(cpl.add(1, PuyoColor::OJAMA));
+    ASSERT_TRUE(cpl.add(3, PuyoColor::GREEN, 3));
+    ASSERT_TRUE(cpl.add(6, PuyoColor::YELLOW));
+
+    CoreField expected("..G..."
+                       "..G..."
+                       "..G..."
+                       "O.R..."
+                       "B.R..Y");
+
+    EXPECT_TRUE(cf.dropPuyoList(cpl));
+    EXPECT_EQ(expected, cf);
+    for (int x = 1; x <= 6; ++x)
+        EXPECT_EQ(expected.height(x), cf.height(x)) << x;
+}
+
+TEST(CoreFieldTest, dropPuyoListWithMaxHeight)
+{
+    CoreField cf("..R..."
+                 "..R...");
+
+    ColumnPuyoList cpl;
+    ASSERT_TRUE(cpl.add(3, PuyoColor::GREEN, 3));
+
+    EXPECT_FALSE(cf.dropPuyoListWithMaxHeight(cpl, 4));
+    EXPECT_EQ(2, cf.height(3));
+
+    EXPECT_TRUE(cf.dropPuyoListWithMaxHeight(cpl, 5));
+    EXPECT_EQ(5, cf.height(3));
+    EXPECT_EQ(PuyoColor::GREEN, cf.color(3, 5));
+}
+
 TEST(CoreFieldTest, removePuyoFrom)
 {
     CoreField cf(
@@ -596,6 +694,79 @@ TEST(CoreFieldTest, removePuyoFrom)
     EXPECT_EQ(0, cf.height(3));
 }
 
+TEST(CoreFieldTest, undoDropKumipuyo)
+{
+    const CoreField original(
+        "..B..."
+        "..R..."
+        "RYGB..");
+    const Kumipuyo kumipuyo(PuyoColor::RED, PuyoColor::BLUE);
+
+    for (int x = 1; x <= 6; ++x) {
+        for (int r = 0; r < 4; ++r) {
+            Decision decision(x, r);
+            if (!decision.isValid())
+                continue;
+
+            CoreField cf(original);
+            ASSERT_TRUE(cf.dropKumipuyo(decision, kumipuyo)) << decision.toString();
+            cf.undoDropKumipuyo(decision);
+            EXPECT_EQ(original, cf) << decision.toString();
+            for (int i = 1; i <= 6; ++i)
+                EXPECT_EQ(original.height(i), cf.height(i)) << decision.toString();
+        }
+    }
+}
+
+TEST(CoreFieldTest, computeKumipuyoPlacements)
+{
+    const Decision decisions[] = {
+        Decision(2, 3), Decision(3, 3), Decision(3, 1), Decision(4, 1),
+        Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2),
+        Decision(4, 2), Decision(5, 2), Decision(6, 2),
+        Decision(1, 1), Decision(2, 1), Decision(4, 3), Decision(5, 3),
+        Decision(6, 3), Decision(1, 0), Decision(2, 0), Decision(3, 0),
+        Decision(4, 0), Decision(5, 0), Decision(6, 0),
+    };
+    const Kumipuyo kumipuyo(PuyoColor::RED, PuyoColor::BLUE);
+
+    // All the combinations of the heights around the 12th row.
+    const int heights[] = { 0, 11, 12, 13 };
+    for (int bits = 0; bits < (1 << 12); ++bits) {
+        CoreField cf;
+        for (int x = 1; x <= 6; ++x) {
+            int h = heights[(bits >> (2 * (x - 1))) & 3];
+            for (int y = 1; y <= h; ++y)
+                ASSERT_TRUE(cf.dropPuyoOn(x, PuyoColor::OJAMA));
+        }
+
+        CoreField::KumipuyoPlacement placements[22];
+        int numRepPlacements = -1;
+        int numPlacements = cf.computeKumipuyoPlacements(placements, &numRepPlacements);
+
+        int n = 0;
+        for (int i = 0; i < 22; ++i) {
+            if (i == 11) {
+                EXPECT_EQ(n, numRepPlacements);
+            }
+
+            const Decision& decision = decisions[i];
+            if (!PuyoController::isReachable(cf, decision))
+                continue;
+            CoreField dropped(cf);
+            if (!dropped.dropKumipuyo(decision, kumipuyo))
+                continue;
+
+            ASSERT_LT(n, numPlacements) << cf.toDebugString();
+            EXPECT_EQ(decision, placements[n].decision) << cf.toDebugString();
+            EXPECT_EQ(cf.framesToDropNext(decision), placements[n].dropFrames);
+            EXPECT_EQ(cf.isChigiriDecision(decision), placements[n].isChigiri);
+            ++n;
+        }
+        EXPECT_EQ(n, numPlacements) << cf.toDebugString();
+    }
+}
+
 TEST(CoreFieldTest, framesToDropNextWithoutChigiri)
 {
     // TODO(mayah): We have to confirm this.
@@ -1,12 +1,10 @@
-#ifdef __AVX2__
-
-// This file does compile if -mavx2 is specified or -mnative is specified and CPU has AVX2.
-
 #include "core/field_bits_256.h"
 
+#ifdef HAVE_TARGET_AVX2_BMI2
+
 using namespace std;
 
-string FieldBits256::toString() const
+TARGET_AVX2_BMI2 string FieldBits256::toString() const
 {
     stringstream ss;
     for (int y = 15; y >= 0; --y) {
@@ -23,4 +21,4 @@ string FieldBits256::toString() const
     return ss.str();
 }
 
-#endif // __AVX2__
+#endif // HAVE_TARGET_AVX2_BMI2
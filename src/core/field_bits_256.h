@@ -1,6 +1,9 @@
 #ifndef CORE_FIELD_BITS_256_H_
 #define CORE_FIELD_BITS_256_H_
-#ifdef __AVX2__
+
+#include "base/base.h"
+
+#ifdef HAVE_TARGET_AVX2_BMI2
 
 #include <string>
 #include <utility>
@@ -10,55 +13,58 @@
 #include "base/avx.h"
 #include "core/field_bits.h"
 
+// FieldBits256 is compiled with TARGET_AVX2_BMI2, so use it only when the CPU supports AVX2.
 class FieldBits256 {
 public:
     enum class HighLow { LOW, HIGH };
 
-    FieldBits256() : m_(_mm256_setzero_si256()) {}
+    TARGET_AVX2_BMI2 FieldBits256() : m_(_mm256_setzero_si256()) {}
     FieldBits256(__m256i m) : m_(m) {}
-    FieldBits256(FieldBits high, FieldBits low);
-    FieldBits256(HighLow highlow, int x, int y) : m_(onebit(highlow, x, y)) {}
+    TARGET_AVX2_BMI2 FieldBits256(FieldBits high, FieldBits low);
+    TARGET_AVX2_BMI2 FieldBits256(HighLow highlow, int x, int y) : m_(onebit(highlow, x, y)) {}
 
     operator __m256i&() { return m_; }
     __m256i& ymm() { return m_; }
     const __m256i& ymm() const { return m_; }
 
-    bool get(HighLow highlow, int x, int y) const { return !_mm256_testz_si256(onebit(highlow, x, y), m_); }
-    void set(HighLow highlow, int x, int y) { m_ = m_ | onebit(highlow, x, y); }
-    void setHigh(int x, int y) { m_ = m_ | onebit(HighLow::HIGH, x, y); }
-    void setLow(int x, int y) { m_ = m_ | onebit(HighLow::LOW, x, y); }
+    TARGET_AVX2_BMI2 bool get(HighLow highlow, int x, int y) const { return !_mm256_testz_si256(onebit(highlow, x, y), m_); }
+    TARGET_AVX2_BMI2 void set(HighLow highlow, int x, int y) { m_ = m_ | onebit(highlow, x, y); }
+    TARGET_AVX2_BMI2 void setHigh(int x, int y) { m_ = m_ | onebit(HighLow::HIGH, x, y); }
+    TARGET_AVX2_BMI2 void setLow(int x, int y) { m_ = m_ | onebit(HighLow::LOW, x, y); }
 
-    void setAll(FieldBits256 m) { m_ = m_ | m; }
+    TARGET_AVX2_BMI2 void setAll(FieldBits256 m) { m_ = m_ | m; }
 
-    std::pair<int, int> popcountHighLow() const;
+    TARGET_AVX2_BMI2 std::pair<int, int> popcountHighLow() const;
 
-    FieldBits low() const { return _mm256_castsi256_si128(m_); }
-    FieldBits high() const { return _mm256_extracti128_si256(m_, 1); }
+    TARGET_AVX2_BMI2 FieldBits low() const { return _mm256_castsi256_si128(m_); }
+    TARGET_AVX2_BMI2 FieldBits high() const { return _mm256_extracti128_si256(m_, 1); }
 
-    FieldBits256 expand(FieldBits256 mask) const;
-    FieldBits256 expand1(FieldBits256 mask) const;
+    TARGET_AVX2_BMI2 FieldBits256 expand(FieldBits256 mask) const;
+    TARGET_AVX2_BMI2 FieldBits256 expand1(FieldBits256 mask) const;
 
-    bool findVanishingBits(FieldBits256* bits) const;
+    TARGET_AVX2_BMI2 bool findVanishingBits(FieldBits256* bits) const;
 
-    bool isEmpty() const { return _mm256_testz_si256(m_, m_); }
-    std::string toString() const;
+    TARGET_AVX2_BMI2 bool isEmpty() const { return _mm256_testz_si256(m_, m_); }
+    TARGET_AVX2_BMI2 std::string toString() const;
 
-    friend bool operator==(FieldBits256 lhs, FieldBits256 rhs) { return (lhs ^ rhs).isEmpty(); }
-    friend bool operator!=(FieldBits256 lhs, FieldBits256 rhs) { return !(lhs == rhs); }
+    // These take references, since they can be called from a function without AVX (e.g. gtest),
+    // where __m256i is passed by value in a different way.
+    friend TARGET_AVX2_BMI2 bool operator==(const FieldBits256& lhs, const FieldBits256& rhs) { return (lhs ^ rhs).isEmpty(); }
+    friend TARGET_AVX2_BMI2 bool operator!=(const FieldBits256& lhs, const FieldBits256& rhs) { return !(lhs == rhs); }
 
-    friend FieldBits256 operator&(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_and_si256(lhs.ymm(), rhs.ymm()); }
-    friend FieldBits256 operator|(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_or_si256(lhs.ymm(), rhs.ymm()); }
-    friend FieldBits256 operator^(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_xor_si256(lhs.ymm(), rhs.ymm()); }
+    friend TARGET_AVX2_BMI2 FieldBits256 operator&(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_and_si256(lhs.ymm(), rhs.ymm()); }
+    friend TARGET_AVX2_BMI2 FieldBits256 operator|(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_or_si256(lhs.ymm(), rhs.ymm()); }
+    friend TARGET_AVX2_BMI2 FieldBits256 operator^(FieldBits256 lhs, FieldBits256 rhs) { return _mm256_xor_si256(lhs.ymm(), rhs.ymm()); }
 
-    friend std::ostream& operator<<(std::ostream& os, const FieldBits256& bits) { return os << bits.toString(); }
+    friend TARGET_AVX2_BMI2 std::ostream& operator<<(std::ostream& os, const FieldBits256& bits) { return os << bits.toString(); }
 
 private:
-    static __m256i onebit(HighLow highlow, int x, int y);
+    TARGET_AVX2_BMI2 static __m256i onebit(HighLow highlow, int x, int y);
 
     __m256i m_;
 };
 
-inline FieldBits256::FieldBits256(FieldBits high, FieldBits low)
+inline TARGET_AVX2_BMI2 FieldBits256::FieldBits256(FieldBits high, FieldBits low)
 {
     // See http://lists.cs.uiuc.edu/pipermail/cfe-commits/Week-of-Mon-20150518/129492.html
     // This works only in clang.
@@ -67,7 +73,7 @@ inline FieldBits256::FieldBits256(FieldBits high, FieldBits low)
     m_ = _mm256_inserti128_si256(_mm256_castsi128_si256(low.xmm()), high.xmm(), 1);
 }
 
-inline FieldBits256 FieldBits256::expand(FieldBits256 mask) const
+inline TARGET_AVX2_BMI2 FieldBits256 FieldBits256::expand(FieldBits256 mask) const
 {
     FieldBits256 seed = m_;
 
@@ -87,7 +93,7 @@ inline FieldBits256 FieldBits256::expand(FieldBits256 mask) const
     // NOT_REACHED.
 }
 
-inline FieldBits256 FieldBits256::expand1(FieldBits256 mask) const
+inline TARGET_AVX2_BMI2 FieldBits256 FieldBits256::expand1(FieldBits256 mask) const
 {
     FieldBits256 v1 = _mm256_slli_si256(m_, 2);
     FieldBits256 v2 = _mm256_srli_si256(m_, 2);
@@ -96,7 +102,7 @@ inline FieldBits256 FieldBits256::expand1(FieldBits256 mask) const
     return ((m_ | v1) | (v2 | v3) | v4) & mask;
 }
 
-inline
+inline TARGET_AVX2_BMI2
 std::pair<int, int> FieldBits256::popcountHighLow() const
 {
     avx::Decomposer256 d;
@@ -108,7 +114,7 @@ std::pair<int, int> FieldBits256::popcountHighLow() const
     return std::make_pair(high, low);
 }
 
-inline bool FieldBits256::findVanishingBits(FieldBits256* vanishing) const
+inline TARGET_AVX2_BMI2 bool FieldBits256::findVanishingBits(FieldBits256* vanishing) const
 {
     DCHECK(vanishing) << "vanishing should not be nullptr";
 
@@ -140,7 +146,7 @@ inline bool FieldBits256::findVanishingBits(FieldBits256* vanishing) const
 }
 
 // static
-inline __m256i FieldBits256::onebit(FieldBits256::HighLow highlow, int x, int y)
+inline TARGET_AVX2_BMI2 __m256i FieldBits256::onebit(FieldBits256::HighLow highlow, int x, int y)
 {
     DCHECK(0 <= x && x < 8 && 0 <= y && y < 16) << "x=" << x << " y=" << y;
 
@@ -159,5 +165,5 @@ inline __m256i FieldBits256::onebit(FieldBits256::HighLow highlow, int x, int y)
     return m;
 }
 
-#endif // __AVX2__
+#endif // HAVE_TARGET_AVX2_BMI2
 #endif // CORE_FIELD_BITS_256_H_
@@ -1,13 +1,28 @@
-#ifdef __AVX2__
+#include "core/field_bits_256.h"
 
 #include <gtest/gtest.h>
 
+#include "base/base.h"
+#include "base/cpu.h"
 #include "core/bit_field.h"
-#include "core/field_bits_256.h"
+
+#ifdef HAVE_TARGET_AVX2_BMI2
 
 using namespace std;
 
-TEST(FieldBits256Test, ctor1)
+// FieldBits256 uses AVX2 and BMI2, so each test body is compiled with TARGET_AVX2_BMI2,
+// and it runs only when the CPU supports them.
+#define FIELD_BITS_256_TEST(test_name)                          \
+    TARGET_AVX2_BMI2 static void test_name##Body();             \
+    TEST(FieldBits256Test, test_name)                           \
+    {                                                           \
+        if (!cpu::hasAVX2() || !cpu::hasBMI2())                 \
+            return;                                             \
+        test_name##Body();                                      \
+    }                                                           \
+    TARGET_AVX2_BMI2 static void test_name##Body()
+
+FIELD_BITS_256_TEST(ctor1)
 {
     FieldBits256 bits;
     for (int x = 0; x < 8; ++x) {
@@ -18,7 +33,7 @@ TEST(FieldBits256Test, ctor1)
     }
 }
 
-TEST(FieldBits256Test, ctor2)
+FIELD_BITS_256_TEST(ctor2)
 {
     FieldBits low;
     low.set(1, 3);
@@ -40,7 +55,7 @@ TEST(FieldBits256Test, ctor2)
     EXPECT_FALSE(fb256.get(FieldBits256::HighLow::LOW, 5, 9));
 }
 
-TEST(FieldBits256Test, expand)
+FIELD_BITS_256_TEST(expand)
 {
     FieldBits maskHigh(
         "..1..."
@@ -69,7 +84,7 @@ TEST(FieldBits256Test, expand)
     EXPECT_EQ(maskLow, expanded.low());
 }
 
-TEST(FieldBits256Test, findVanishingBits)
+FIELD_BITS_256_TEST(findVanishingBits)
 {
     BitField bf(
         ".....R"
@@ -102,4 +117,4 @@ TEST(FieldBits256Test, findVanishingBits)
     EXPECT_EQ(FieldBits256(yellowVanishing, greenVanishing), yellowGreenVanishing);
 }
 
-#endif // __AVX2__
+#endif // HAVE_TARGET_AVX2_BMI2
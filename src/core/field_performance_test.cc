@@ -111,11 +111,13 @@ static void runSimulation(const CoreField& original)
         EXPECT_EQ(expectedChain, bf.simulateFast(&tracker));
     }
 
-#if defined(__AVX2__) and defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
+    // The selected kernel is used, if it is AVX2 or AVX2_BMI2.
+    const bool avx2 = BitField::kernel() != BitField::Kernel::SSE;
     TimeStampCounterData tscBitFieldAVX2;
     TimeStampCounterData tscBitFieldFastAVX2;
 
-    for (int i = 0; i < N; ++i) {
+    for (int i = 0; avx2 && i < N; ++i) {
         BitField bf(original.bitField());
         BitField::SimulationContext context;
         RensaNonTracker tracker;
@@ -123,13 +125,13 @@ static void runSimulation(const CoreField& original)
         EXPECT_EQ(expectedChain, bf.simulateAVX2(&context, &tracker).chains);
     }
 
-    for (int i = 0; i < N; ++i) {
+    for (int i = 0; avx2 && i < N; ++i) {
         BitField bf(original.bitField());
         RensaNonTracker tracker;
         ScopedTimeStampCounter stsc(&tscBitFieldFastAVX2);
         EXPECT_EQ(expectedChain, bf.simulateFastAVX2(&tracker));
     }
-#endif // __AVX2__ and __BMI2__
+#endif // HAVE_TARGET_AVX2_BMI2
 
     cout << "overhead: " << endl;
     none.showStatistics();
@@ -140,11 +142,13 @@ static void runSimulation(const CoreField& original)
     cout << "BitField (fast): " << endl;
     tscBitFieldFast.showStatistics();
 
-#ifdef __AVX2__
-    cout << "BitField AVX2: " << endl;
-    tscBitFieldAVX2.showStatistics();
-    cout << "BitField (fast) AVX2: " << endl;
-    tscBitFieldFastAVX2.showStatistics();
+#ifdef HAVE_TARGET_AVX2_BMI2
+    if (avx2) {
+        cout << "BitField AVX2: " << endl;
+        tscBitFieldAVX2.showStatistics();
+        cout << "BitField (fast) AVX2: " << endl;
+        tscBitFieldFastAVX2.showStatistics();
+    }
 #endif
 }
 
@@ -195,11 +199,13 @@ static void runVanishDrop(const CoreField& original)
         EXPECT_EQ(expectedChain, context.currentChain - 1);
     }
 
-#if defined(__AVX2__) and defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
+    // The selected kernel is used, if it is AVX2 or AVX2_BMI2.
+    const bool avx2 = BitField::kernel() != BitField::Kernel::SSE;
     TimeStampCounterData tscBitFieldAVX2;
     TimeStampCounterData tscBitFieldFastAVX2;
 
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; avx2 && i < N; i++) {
         BitField bf(original.bitField());
         BitField::SimulationContext context;
         RensaNonTracker tracker;
@@ -210,7 +216,7 @@ static void runVanishDrop(const CoreField& original)
         EXPECT_EQ(expectedChain, context.currentChain - 1);
     }
 
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; avx2 && i < N; i++) {
         BitField bf(original.bitField());
         BitField::SimulationContext context;
         RensaNonTracker tracker;
@@ -220,7 +226,7 @@ static void runVanishDrop(const CoreField& original)
         }
         EXPECT_EQ(expectedChain, context.currentChain - 1);
     }
-#endif // __AVX2__ and __BMI2__
+#endif // HAVE_TARGET_AVX2_BMI2
 
     cout << "overhead: " << endl;
     none.showStatistics();
@@ -231,11 +237,13 @@ static void runVanishDrop(const CoreField& original)
     cout << "BitField (fast): " << endl;
     tscBitFieldFast.showStatistics();
 
-#ifdef __AVX2__
-    cout << "BitField AVX2: " << endl;
-    tscBitFieldAVX2.showStatistics();
-    cout << "BitField (fast) AVX2: " << endl;
-    tscBitFieldFastAVX2.showStatistics();
+#ifdef HAVE_TARGET_AVX2_BMI2
+    if (avx2) {
+        cout << "BitField AVX2: " << endl;
+        tscBitFieldAVX2.showStatistics();
+        cout << "BitField (fast) AVX2: " << endl;
+        tscBitFieldFastAVX2.showStatistics();
+    }
 #endif
 }
 
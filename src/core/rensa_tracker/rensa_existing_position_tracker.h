@@ -39,8 +39,8 @@ public:
         result_.setExistingBits(m);
     }
 
-#ifdef __BMI2__
-    void trackDropBMI2(std::uint64_t oldLowBits, std::uint64_t oldHighBits, std::uint64_t newLowBits, std::uint64_t newHighBits)
+#ifdef HAVE_TARGET_AVX2_BMI2
+    TARGET_AVX2_BMI2 void trackDropBMI2(std::uint64_t oldLowBits, std::uint64_t oldHighBits, std::uint64_t newLowBits, std::uint64_t newHighBits)
     {
         union {
             std::uint64_t v[2];
@@ -32,9 +32,15 @@ TEST(RensaExistingPositionTrackerTest, vanishDrop)
     EXPECT_EQ(expected2, tracker.result().existingBits());
 }
 
-#if defined(__AVX2__) && defined(__BMI2__)
+#ifdef HAVE_TARGET_AVX2_BMI2
 TEST(RensaExistingPositionTrackerTest, simulateFastAVX2)
 {
+    // The tracker is updated with PDEP/PEXT in this kernel.
+    if (!BitField::isKernelSupported(BitField::Kernel::AVX2_BMI2))
+        return;
+    BitField::Kernel original = BitField::kernel();
+    BitField::setKernel(BitField::Kernel::AVX2_BMI2);
+
     BitField bf(
         "..YY.."
         "..GGY."
@@ -52,5 +58,7 @@ TEST(RensaExistingPositionTrackerTest, simulateFastAVX2)
     RensaExistingPositionTracker tracker(bits);
     bf.simulateFastAVX2(&tracker);
     EXPECT_EQ(expected, tracker.result().existingBits());
+
+    BitField::setKernel(original);
 }
 #endif
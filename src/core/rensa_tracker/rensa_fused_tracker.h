@@ -0,0 +1,105 @@
+#ifndef CORE_RENSA_TRACKER_RENSA_FUSED_TRACKER_H_
+#define CORE_RENSA_TRACKER_RENSA_FUSED_TRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "base/base.h"
+#include "core/field_bits.h"
+#include "core/rensa_tracker.h"
+
+// RensaFusedTracker<Tracker1, Tracker2, ...> tracks a rensa with all the trackers in one simulation.
+// The trackers are held by value, and each track method calls the ones of all the trackers,
+// which are resolved at compile time. So, when you need several results (e.g. chain, coef,
+// and positions), simulating once with this is cheaper than simulating once per tracker.
+//
+//   RensaFusedTracker<RensaCoefTracker, RensaChainTracker> tracker;
+//   cf.simulate(&tracker);
+//   tracker.get<0>().result().numErased(1); tracker.get<1>().result().erasedAt(1, 1);
+template<typename... Trackers>
+class RensaFusedTracker;
+
+// RensaFusedTrackerElement<i, RensaFusedTracker<...>>::type is the type of the i-th tracker.
+template<std::size_t i, typename Fused>
+struct RensaFusedTrackerElement;
+
+template<>
+class RensaFusedTracker<> {
+public:
+    void trackCoef(int /*nthChain*/, int /*numErasedPuyo*/, int /*longBonusCoef*/, int /*colorBonusCoef*/) {}
+    void trackVanish(int /*nthChain*/, const FieldBits& /*vanishedPuyoBits*/, const FieldBits& /*vanishedOjamaPuyoBits*/) {}
+    void trackDrop(FieldBits /*blender*/, FieldBits /*leftOnes*/, FieldBits /*rightOnes*/) {}
+#ifdef HAVE_TARGET_AVX2_BMI2
+    TARGET_AVX2_BMI2 void trackDropBMI2(std::uint64_t /*oldLowBits*/, std::uint64_t /*oldHighBits*/, std::uint64_t /*newLowBits*/, std::uint64_t /*newHighBits*/) {}
+#endif
+};
+
+template<typename Tracker, typename... Rest>
+class RensaFusedTracker<Tracker, Rest...> {
+public:
+    RensaFusedTracker() {}
+    explicit RensaFusedTracker(Tracker tracker, Rest... rest) :
+        tracker_(std::move(tracker)), rest_(std::move(rest)...)
+    {
+    }
+
+    // Returns the i-th tracker.
+    template<std::size_t i> const typename RensaFusedTrackerElement<i, RensaFusedTracker>::type& get() const
+    {
+        return RensaFusedTrackerElement<i, RensaFusedTracker>::get(*this);
+    }
+    template<std::size_t i> typename RensaFusedTrackerElement<i, RensaFusedTracker>::type& get()
+    {
+        return RensaFusedTrackerElement<i, RensaFusedTracker>::get(*this);
+    }
+
+    void trackCoef(int nthChain, int numErasedPuyo, int longBonusCoef, int colorBonusCoef)
+    {
+        tracker_.trackCoef(nthChain, numErasedPuyo, longBonusCoef, colorBonusCoef);
+        rest_.trackCoef(nthChain, numErasedPuyo, longBonusCoef, colorBonusCoef);
+    }
+
+    void trackVanish(int nthChain, const FieldBits& vanishedPuyoBits, const FieldBits& vanishedOjamaPuyoBits)
+    {
+        tracker_.trackVanish(nthChain, vanishedPuyoBits, vanishedOjamaPuyoBits);
+        rest_.trackVanish(nthChain, vanishedPuyoBits, vanishedOjamaPuyoBits);
+    }
+
+    void trackDrop(FieldBits blender, FieldBits leftOnes, FieldBits rightOnes)
+    {
+        tracker_.trackDrop(blender, leftOnes, rightOnes);
+        rest_.trackDrop(blender, leftOnes, rightOnes);
+    }
+
+#ifdef HAVE_TARGET_AVX2_BMI2
+    TARGET_AVX2_BMI2 void trackDropBMI2(std::uint64_t oldLowBits, std::uint64_t oldHighBits, std::uint64_t newLowBits, std::uint64_t newHighBits)
+    {
+        tracker_.trackDropBMI2(oldLowBits, oldHighBits, newLowBits, newHighBits);
+        rest_.trackDropBMI2(oldLowBits, oldHighBits, newLowBits, newHighBits);
+    }
+#endif
+
+private:
+    template<std::size_t i, typename Fused> friend struct RensaFusedTrackerElement;
+
+    Tracker tracker_;
+    RensaFusedTracker<Rest...> rest_;
+};
+
+template<typename Tracker, typename... Rest>
+struct RensaFusedTrackerElement<0, RensaFusedTracker<Tracker, Rest...>> {
+    typedef Tracker type;
+    static const type& get(const RensaFusedTracker<Tracker, Rest...>& fused) { return fused.tracker_; }
+    static type& get(RensaFusedTracker<Tracker, Rest...>& fused) { return fused.tracker_; }
+};
+
+template<std::size_t i, typename Tracker, typename... Rest>
+struct RensaFusedTrackerElement<i, RensaFusedTracker<Tracker, Rest...>> {
+    typedef RensaFusedTrackerElement<i - 1, RensaFusedTracker<Rest...>> Next;
+    typedef typename Next::type type;
+    static const type& get(const RensaFusedTracker<Tracker, Rest...>& fused) { return Next::get(fused.rest_); }
+    static type& get(RensaFusedTracker<Tracker, Rest...>& fused) { return Next::get(fused.rest_); }
+};
+
+#endif // CORE_RENSA_TRACKER_RENSA_FUSED_TRACKER_H_
@@ -0,0 +1,83 @@
+#include "core/rensa_tracker/rensa_fused_tracker.h"
+
+#include <gtest/gtest.h>
+
+#include "core/core_field.h"
+#include "core/rensa_tracker/rensa_chain_tracker.h"
+#include "core/rensa_tracker/rensa_coef_tracker.h"
+#include "core/rensa_tracker/rensa_existing_position_tracker.h"
+#include "core/rensa_tracker/rensa_vanishing_position_tracker.h"
+
+TEST(RensaFusedTrackerTest, track)
+{
+    const CoreField original(
+        ".RBGY."
+        "RBGYR."
+        "RBGYR."
+        "RBGYRR");
+
+    RensaCoefTracker coefTracker;
+    RensaChainTracker chainTracker;
+    RensaExistingPositionTracker existingTracker(original.bitField().normalColorBits());
+    RensaVanishingPositionTracker vanishingTracker;
+    CoreField(original).simulate(&coefTracker);
+    CoreField(original).simulate(&chainTracker);
+    CoreField(original).simulate(&existingTracker);
+    CoreField(original).simulate(&vanishingTracker);
+
+    RensaFusedTracker<RensaCoefTracker, RensaChainTracker, RensaExistingPositionTracker, RensaVanishingPositionTracker> tracker(
+        RensaCoefTracker(),
+        RensaChainTracker(),
+        RensaExistingPositionTracker(original.bitField().normalColorBits()),
+        RensaVanishingPositionTracker());
+    CoreField cf(original);
+    EXPECT_EQ(5, cf.simulate(&tracker).chains);
+
+    EXPECT_EQ(4, tracker.get<0>().result().numErased(5));
+    EXPECT_EQ(5, tracker.get<1>().result().erasedAt(1, 1));
+    for (int i = 1; i <= 5; ++i) {
+        EXPECT_EQ(coefTracker.result().numErased(i), tracker.get<0>().result().numErased(i));
+        EXPECT_EQ(coefTracker.result().coef(i), tracker.get<0>().result().coef(i));
+        EXPECT_EQ(vanishingTracker.result().getReferenceBasePuyosAt(i), tracker.get<3>().result().getReferenceBasePuyosAt(i));
+        EXPECT_EQ(vanishingTracker.result().getReferenceFallingPuyosAt(i), tracker.get<3>().result().getReferenceFallingPuyosAt(i));
+    }
+    for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+        for (int y = 1; y <= FieldConstant::HEIGHT; ++y) {
+            EXPECT_EQ(chainTracker.result().erasedAt(x, y), tracker.get<1>().result().erasedAt(x, y));
+        }
+    }
+    EXPECT_EQ(existingTracker.result().existingBits(), tracker.get<2>().result().existingBits());
+}
+
+TEST(RensaFusedTrackerTest, single)
+{
+    const CoreField original(
+        "RRRR..");
+
+    RensaFusedTracker<RensaCoefTracker> tracker;
+    CoreField cf(original);
+    EXPECT_EQ(1, cf.simulate(&tracker).chains);
+    EXPECT_EQ(4, tracker.get<0>().result().numErased(1));
+}
+
+TEST(RensaFusedTrackerTest, trackersGiven)
+{
+    const CoreField original(
+        ".RBGY."
+        "RBGYR."
+        "RBGYR."
+        "RBGYRR");
+
+    // The trackers are copied into the fused tracker.
+    RensaCoefTracker coefTracker;
+    RensaChainTracker chainTracker;
+    RensaFusedTracker<RensaCoefTracker, RensaChainTracker> tracker(coefTracker, chainTracker);
+
+    CoreField cf(original);
+    cf.simulate(&tracker);
+
+    EXPECT_EQ(4, tracker.get<0>().result().numErased(5));
+    EXPECT_EQ(5, tracker.get<1>().result().erasedAt(1, 1));
+    EXPECT_EQ(0, coefTracker.result().numErased(5));
+    EXPECT_EQ(0, chainTracker.result().erasedAt(1, 1));
+}
@@ -6,6 +6,10 @@
 #include "base/time_stamp_counter.h"
 #include "core/core_field.h"
 #include "core/rensa_tracker/rensa_chain_tracker.h"
+#include "core/rensa_tracker/rensa_coef_tracker.h"
+#include "core/rensa_tracker/rensa_existing_position_tracker.h"
+#include "core/rensa_tracker/rensa_fused_tracker.h"
+#include "core/rensa_tracker/rensa_vanishing_position_tracker.h"
 
 using namespace std;
 
@@ -39,6 +43,44 @@ static void runSimulation(const CoreField& original)
     tscCoreFieldWithRensaChainTracker.showStatistics();
 }
 
+// Compares simulating once per tracker with simulating once with RensaFusedTracker.
+static void runFusedSimulation(const CoreField& original)
+{
+    const int expectedChain = CoreField(original).simulate().chains;
+    const FieldBits bits = original.bitField().normalColorBits();
+
+    const int N = 100000;
+
+    TimeStampCounterData tscSeparated;
+    TimeStampCounterData tscFused;
+
+    for (int i = 0; i < N; i++) {
+        CoreField cf1(original), cf2(original), cf3(original), cf4(original);
+        RensaCoefTracker coefTracker;
+        RensaChainTracker chainTracker;
+        RensaExistingPositionTracker existingTracker(bits);
+        RensaVanishingPositionTracker vanishingTracker;
+        ScopedTimeStampCounter stsc(&tscSeparated);
+        EXPECT_EQ(expectedChain, cf1.simulate(&coefTracker).chains);
+        EXPECT_EQ(expectedChain, cf2.simulate(&chainTracker).chains);
+        EXPECT_EQ(expectedChain, cf3.simulate(&existingTracker).chains);
+        EXPECT_EQ(expectedChain, cf4.simulate(&vanishingTracker).chains);
+    }
+
+    for (int i = 0; i < N; ++i) {
+        CoreField cf(original);
+        RensaFusedTracker<RensaCoefTracker, RensaChainTracker, RensaExistingPositionTracker, RensaVanishingPositionTracker> tracker {
+            RensaCoefTracker(), RensaChainTracker(), RensaExistingPositionTracker(bits), RensaVanishingPositionTracker() };
+        ScopedTimeStampCounter stsc(&tscFused);
+        EXPECT_EQ(expectedChain, cf.simulate(&tracker).chains);
+    }
+
+    cout << "CoreField (4 trackers, separated): " << endl;
+    tscSeparated.showStatistics();
+    cout << "CoreField (4 trackers, RensaFusedTracker): " << endl;
+    tscFused.showStatistics();
+}
+
 } // namespace anonymous
 
 TEST(RensaTrackerPerformanceTest, filled)
@@ -58,4 +100,5 @@ TEST(RensaTrackerPerformanceTest, filled)
                        "RBGBGG");
 
     runSimulation(original);
+    runFusedSimulation(original);
 }
@@ -0,0 +1,38 @@
+#include "core/rensa_tracker/rensa_yposition_tracker.h"
+
+namespace {
+
+// Returns the position of the |n|-th set bit of |mask| (8 bits). 0x80 if there isn't.
+constexpr std::uint8_t nthBitPosition(int mask, int n, int pos = 0)
+{
+    return pos >= 8 ? 0x80 :
+        !(mask & (1 << pos)) ? nthBitPosition(mask, n, pos + 1) :
+        n == 0 ? pos : nthBitPosition(mask, n - 1, pos + 1);
+}
+
+} // namespace anonymous
+
+#define COMPACTION_INDICES(m) { \
+    nthBitPosition(m, 0), nthBitPosition(m, 1), nthBitPosition(m, 2), nthBitPosition(m, 3), \
+    nthBitPosition(m, 4), nthBitPosition(m, 5), nthBitPosition(m, 6), nthBitPosition(m, 7), \
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 }
+#define COMPACTION_INDICES4(m) \
+    COMPACTION_INDICES(m), COMPACTION_INDICES(m + 1), COMPACTION_INDICES(m + 2), COMPACTION_INDICES(m + 3)
+#define COMPACTION_INDICES16(m) \
+    COMPACTION_INDICES4(m), COMPACTION_INDICES4(m + 4), COMPACTION_INDICES4(m + 8), COMPACTION_INDICES4(m + 12)
+#define COMPACTION_INDICES64(m) \
+    COMPACTION_INDICES16(m), COMPACTION_INDICES16(m + 16), COMPACTION_INDICES16(m + 32), COMPACTION_INDICES16(m + 48)
+
+alignas(16) const std::uint8_t RensaYPositionTracker::s_compactionIndices[256][16] = {
+    COMPACTION_INDICES64(0), COMPACTION_INDICES64(64), COMPACTION_INDICES64(128), COMPACTION_INDICES64(192)
+};
+
+#undef COMPACTION_INDICES64
+#undef COMPACTION_INDICES16
+#undef COMPACTION_INDICES4
+#undef COMPACTION_INDICES
+
+const std::uint8_t RensaYPositionTracker::s_shiftIndices[32] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
@@ -1,27 +1,27 @@
 #ifndef CORE_RENSA_RENSA_YPOSITION_TRACKER_H_
 #define CORE_RENSA_RENSA_YPOSITION_TRACKER_H_
 
-#include "base/bmi.h"
+#include <smmintrin.h>
+
+#include <cstdint>
+
 #include "core/field_constant.h"
 #include "core/rensa_tracker.h"
 
+// RensaYPositionTracker tracks the original y of each puyo in rensa.
+// The state has 1 byte per cell, so one column fits in one __m128i. When puyos are vanished,
+// each column is compacted with PSHUFB, which is the same as dropping the remaining puyos.
+// This doesn't depend on BMI2, which could be emulated slowly.
 class RensaYPositionTracker {
 public:
-    RensaYPositionTracker() :
-        originalY_ {
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-            0xFEDCBA9876543210,
-        }
+    RensaYPositionTracker()
     {
+        const __m128i ys = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for (int x = 0; x < FieldConstant::MAP_WIDTH; ++x)
+            originalY_[x] = ys;
     }
 
-    int originalY(int x, int y) const { return (originalY_[x] >> (4 * y)) & 0xF; }
+    int originalY(int x, int y) const { return reinterpret_cast<const std::uint8_t*>(&originalY_[x])[y]; }
 
     void trackCoef(int /*nthChain*/, int /*numErasedPuyo*/, int /*longBonusCoef*/, int /*colorBonusCoef*/) {}
 
@@ -29,6 +29,7 @@ public:
     {
         const __m128i zero = _mm_setzero_si128();
         const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+        const __m128i eight = _mm_set1_epi8(8);
         union {
             std::uint16_t cols[FieldConstant::MAP_WIDTH];
             __m128i m;
@@ -36,17 +37,33 @@ public:
         m = vanishedPuyoBits ^ ones;
 
         for (int x = 1; x <= 6; ++x) {
-            originalY_[x] = bmi::extractBits4(originalY_[x], cols[x]);
+            const int low = cols[x] & 0xFF;
+            const int high = cols[x] >> 8;
+            // Indices of the remaining puyos in the lower 8 cells, and in the upper 8 cells.
+            // The unused bytes are 0x80, which PSHUFB regards as zero.
+            const __m128i lowIndices = _mm_load_si128(reinterpret_cast<const __m128i*>(s_compactionIndices[low]));
+            const __m128i highIndices = _mm_add_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(s_compactionIndices[high])), eight);
+            // Put the upper ones just after the lower ones.
+            const __m128i shift = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_shiftIndices + 16 - __builtin_popcount(low)));
+            const __m128i shiftedHighIndices = _mm_shuffle_epi8(highIndices, shift);
+            const __m128i indices = _mm_blendv_epi8(lowIndices, shiftedHighIndices, lowIndices);
+            originalY_[x] = _mm_shuffle_epi8(originalY_[x], indices);
         }
     }
 
     void trackDrop(FieldBits /*blender*/, FieldBits /*leftOnes*/, FieldBits /*rightOnes*/) {}
-#ifdef __BMI2__
-    void trackDropBMI2(std::uint64_t /*oldLowBits*/, std::uint64_t /*oldHighBits*/, std::uint64_t /*newLowBits*/, std::uint64_t /*newHighBits*/) {}
+#ifdef HAVE_TARGET_AVX2_BMI2
+    TARGET_AVX2_BMI2 void trackDropBMI2(std::uint64_t /*oldLowBits*/, std::uint64_t /*oldHighBits*/, std::uint64_t /*newLowBits*/, std::uint64_t /*newHighBits*/) {}
 #endif
 
 private:
-    std::uint64_t originalY_[FieldConstant::MAP_WIDTH];
+    // s_compactionIndices[mask] has the positions of the set bits of |mask|, followed by 0x80.
+    alignas(16) static const std::uint8_t s_compactionIndices[256][16];
+    // 16 bytes of 0x80, followed by 0, 1, ..., 15. Loading 16 bytes from (16 - k) makes
+    // PSHUFB indices to shift bytes by k.
+    static const std::uint8_t s_shiftIndices[32];
+
+    __m128i originalY_[FieldConstant::MAP_WIDTH];
 };
 
 #endif // CORE_RENSA_RENSA_YPOSITION_TRACKER_H_
@@ -0,0 +1,86 @@
+#include "core/rensa_tracker/rensa_yposition_tracker.h"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "core/field_bits.h"
+
+TEST(RensaYPositionTrackerTest, initial)
+{
+    RensaYPositionTracker tracker;
+    for (int x = 0; x < FieldConstant::MAP_WIDTH; ++x) {
+        for (int y = 0; y < FieldConstant::MAP_HEIGHT; ++y) {
+            EXPECT_EQ(y, tracker.originalY(x, y));
+        }
+    }
+}
+
+TEST(RensaYPositionTrackerTest, trackVanish)
+{
+    RensaYPositionTracker tracker;
+    tracker.trackVanish(1, FieldBits(
+                            "..1..."
+                            "1.1..."
+                            "1.11.1"), FieldBits());
+
+    // column 1: 1, 2 are vanished.
+    EXPECT_EQ(3, tracker.originalY(1, 1));
+    EXPECT_EQ(4, tracker.originalY(1, 2));
+    // column 2: nothing is vanished.
+    EXPECT_EQ(1, tracker.originalY(2, 1));
+    // column 3: 1, 2, 3 are vanished.
+    EXPECT_EQ(4, tracker.originalY(3, 1));
+    EXPECT_EQ(15, tracker.originalY(3, 12));
+    EXPECT_EQ(0, tracker.originalY(3, 13));
+    // column 4, 6: 1 is vanished.
+    EXPECT_EQ(2, tracker.originalY(4, 1));
+    EXPECT_EQ(2, tracker.originalY(6, 1));
+
+    tracker.trackVanish(2, FieldBits(
+                            "1....."
+                            "......"
+                            "1....."), FieldBits());
+
+    // column 1: originally 3, 5 are vanished.
+    EXPECT_EQ(4, tracker.originalY(1, 1));
+    EXPECT_EQ(6, tracker.originalY(1, 2));
+    EXPECT_EQ(7, tracker.originalY(1, 3));
+}
+
+TEST(RensaYPositionTrackerTest, trackVanishRandomly)
+{
+    std::mt19937 mt(1);
+    for (int i = 0; i < 1000; ++i) {
+        RensaYPositionTracker tracker;
+        int expected[FieldConstant::MAP_WIDTH][FieldConstant::MAP_HEIGHT];
+        for (int x = 0; x < FieldConstant::MAP_WIDTH; ++x) {
+            for (int y = 0; y < FieldConstant::MAP_HEIGHT; ++y)
+                expected[x][y] = y;
+        }
+
+        for (int nthChain = 1; nthChain <= 3; ++nthChain) {
+            FieldBits vanished;
+            for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+                int remaining[FieldConstant::MAP_HEIGHT] {};
+                int n = 0;
+                for (int y = 0; y < FieldConstant::MAP_HEIGHT; ++y) {
+                    if (y >= 1 && y <= FieldConstant::HEIGHT && mt() % 3 == 0) {
+                        vanished.set(x, y);
+                        continue;
+                    }
+                    remaining[n++] = expected[x][y];
+                }
+                for (int y = 0; y < FieldConstant::MAP_HEIGHT; ++y)
+                    expected[x][y] = remaining[y];
+            }
+
+            tracker.trackVanish(nthChain, vanished, FieldBits());
+            for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+                for (int y = 0; y < FieldConstant::MAP_HEIGHT; ++y) {
+                    EXPECT_EQ(expected[x][y], tracker.originalY(x, y)) << "x=" << x << " y=" << y;
+                }
+            }
+        }
+    }
+}
@@ -6,7 +6,6 @@
 #include <math.h>
 #include <stdarg.h>
 #include <stdlib.h>
-#include <time.h>
 
 #include <algorithm>
 #include <map>
@@ -27,15 +26,15 @@ using namespace std;
 Commentator::Commentator() :
     shouldStop_(false)
 {
-    needsUpdate_[0] = needsUpdate_[1] = false;
+    for (int pi = 0; pi < 2; ++pi) {
+        needsUpdate_[pi] = false;
+        generation_[pi] = 0;
+    }
 }
 
 Commentator::~Commentator()
 {
-    // TODO(mayah): Why don't we have stop() instead of calling pthread_join() here?
-    shouldStop_ = true;
-    if (th_.joinable())
-        th_.join();
+    stop();
 }
 
 void Commentator::addCommentatorObserver(CommentatorObserver* observer)
@@ -53,21 +52,28 @@ void Commentator::newGameWillStart()
 
 void Commentator::onUpdate(const GameState& gameState)
 {
-    lock_guard<mutex> lock(mu_);
+    bool updated = false;
+    {
+        lock_guard<mutex> lock(mu_);
+        for (int i = 0; i < 2; ++i) {
+            const PlayerGameState& pgs = gameState.playerGameState(i);
+            if (pgs.event.grounded) {
+                frameId_[i] = gameState.frameId();
+                // When chigiri is used, some puyo exists in the air. So we need to drop.
+                field_[i] = CoreField::fromPlainFieldWithDrop(pgs.field);
+                kumipuyoSeq_[i] = pgs.kumipuyoSeq;
+                needsUpdate_[i] = true;
+                ++generation_[i];
+                updated = true;
+            }
 
-    for (int i = 0; i < 2; ++i) {
-        const PlayerGameState& pgs = gameState.playerGameState(i);
-        if (pgs.event.grounded) {
-            frameId_[i] = gameState.frameId();
-            // When chigiri is used, some puyo exists in the air. So we need to drop.
-            field_[i] = CoreField::fromPlainFieldWithDrop(pgs.field);
-            kumipuyoSeq_[i] = pgs.kumipuyoSeq;
-            needsUpdate_[i] = true;
+            if (!pgs.message.empty())
+                message_[i] = pgs.message;
         }
-
-        if (!pgs.message.empty())
-            message_[i] = pgs.message;
     }
+
+    if (updated)
+        condVar_.notify_all();
 }
 
 CommentatorResult Commentator::result() const
@@ -93,9 +99,11 @@ CommentatorResult Commentator::result() const
 
 bool Commentator::start()
 {
-    th_ = thread([this]() {
-        this->runLoop();
-    });
+    for (int pi = 0; pi < 2; ++pi) {
+        th_[pi] = thread([this, pi]() {
+            this->runWorkerLoop(pi);
+        });
+    }
 
     hasStarted_ = true;
     return true;
@@ -103,53 +111,55 @@ bool Commentator::start()
 
 void Commentator::stop()
 {
-    shouldStop_ = true;
-    if (th_.joinable()) {
-        th_.join();
+    {
+        lock_guard<mutex> lock(mu_);
+        shouldStop_ = true;
+    }
+    condVar_.notify_all();
+
+    for (int pi = 0; pi < 2; ++pi) {
+        if (th_[pi].joinable())
+            th_[pi].join();
     }
 
     hasStarted_ = false;
 }
 
-void Commentator::runLoop()
+void Commentator::runWorkerLoop(int pi)
 {
-    while (!shouldStop_) {
-        struct timespec req { 0, 16 * 1000 * 1000 };
-        struct timespec rem;
-        while (nanosleep(&req, &rem) < 0) {
-            PCHECK(errno == EINTR);
-            req = rem;
-        }
-
-        bool updated = false;
-        for (int pi = 0; pi < 2; ++pi) {
-            // Since we don't want to lock for long, copy field and kumipuyo.
-            CoreField field;
-            KumipuyoSeq kumipuyoSeq;
-            {
-                lock_guard<mutex> lock(mu_);
-                if (!needsUpdate_[pi])
-                    continue;
-
-                field = field_[pi];
-                kumipuyoSeq = kumipuyoSeq_[pi];
-                needsUpdate_[pi] = false;
-            }
+    while (true) {
+        // Since we don't want to lock for long, copy field and kumipuyo.
+        CoreField field;
+        KumipuyoSeq kumipuyoSeq;
+        int generation;
+        {
+            unique_lock<mutex> lock(mu_);
+            condVar_.wait(lock, [this, pi]() { return shouldStop_ || needsUpdate_[pi]; });
+            if (shouldStop_)
+                return;
 
-            update(pi, field, kumipuyoSeq);
-            updated = true;
+            field = field_[pi];
+            kumipuyoSeq = kumipuyoSeq_[pi];
+            generation = generation_[pi];
+            needsUpdate_[pi] = false;
         }
 
-        if (updated) {
-            CommentatorResult r = result();
-            for (auto observer : observers_) {
-                observer->onCommentatorResultUpdate(r);
-            }
-        }
+        // When cancelled, a newer field should be waiting, so just analyze it.
+        if (update(pi, field, kumipuyoSeq, generation))
+            notifyObservers();
+    }
+}
+
+void Commentator::notifyObservers()
+{
+    lock_guard<mutex> lock(observerMu_);
+    CommentatorResult r = result();
+    for (auto observer : observers_) {
+        observer->onCommentatorResultUpdate(r);
     }
 }
 
-void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumipuyoSeq)
+bool Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumipuyoSeq, int generation)
 {
     // 1. Check field is firing a rensa.
     {
@@ -157,20 +167,27 @@ void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumi
         unique_ptr<TrackedPossibleRensaInfo> track(new TrackedPossibleRensaInfo);
         RensaChainPointerTracker tracker(&track->trackResult);
         track->rensaResult = f.simulate(&tracker);
+
+        lock_guard<mutex> lock(mu_);
+        if (isCancelled(pi, generation))
+            return false;
+
         if (track->rensaResult.score > 0) {
-            lock_guard<mutex> lock(mu_);
             string msg = std::to_string(track->rensaResult.chains) + "連鎖発火: " + std::to_string(track->rensaResult.score) + "点";
             addEventMessage(pi, msg);
             firingChain_[pi] = move(track);
             fireableMainChain_[pi].reset();
             fireableTsubushiChain_[pi].reset();
-            return;
+            return true;
         }
 
-        lock_guard<mutex> lock(mu_);
         firingChain_[pi].reset();
     }
 
+    // The results of 2. and 3. are published together after both are computed.
+    unique_ptr<IgnitionRensaResult> tsubushiChain;
+    unique_ptr<TrackedPossibleRensaInfo> mainChain;
+
     // 2. Check Tsubushi chain
     {
         KumipuyoSeq kp;
@@ -179,7 +196,9 @@ void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumi
 
         pair<int, double> bestTsubushiScore = make_pair(100, 0.0); // # of hand & score. Smaller is better.
         IgnitionRensaResult ignitionRensaResult;
-        Plan::iterateAvailablePlans(field, kp, kp.size(), [&bestTsubushiScore, &ignitionRensaResult](const RefPlan& plan) {
+        Plan::iterateAvailablePlans(field, kp, kp.size(), [&](const RefPlan& plan) {
+            if (isCancelled(pi, generation))
+                return;
             if (plan.chains() != 2 && plan.chains() != 3)
                 return;
 
@@ -199,10 +218,11 @@ void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumi
             }
         });
 
-        if (bestTsubushiScore.first < 100) {
-            lock_guard<mutex> lock(mu_);
-            fireableTsubushiChain_[pi].reset(new IgnitionRensaResult(ignitionRensaResult));
-        }
+        if (isCancelled(pi, generation))
+            return false;
+
+        if (bestTsubushiScore.first < 100)
+            tsubushiChain.reset(new IgnitionRensaResult(ignitionRensaResult));
     }
 
     // 3. Check Main chain
@@ -210,6 +230,9 @@ void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumi
         int bestScore = 0;
         unique_ptr<TrackedPossibleRensaInfo> bestRensa;
         auto callback = [&](CoreField&& cf, const ColumnPuyoList& puyosToComplement) -> RensaResult {
+            if (isCancelled(pi, generation))
+                return RensaResult();
+
             RensaChainTracker tracker;
             RensaResult rensaResult = cf.simulate(&tracker);
             if (bestScore < rensaResult.score) {
@@ -222,11 +245,18 @@ void Commentator::update(int pi, const CoreField& field, const KumipuyoSeq& kumi
 
         RensaDetector::detectIteratively(field, RensaDetectorStrategy::defaultFloatStrategy(), 3, callback);
 
-        if (bestRensa != nullptr) {
-            lock_guard<mutex> lock(mu_);
-            fireableMainChain_[pi] = move(bestRensa);
-        }
+        mainChain = move(bestRensa);
     }
+
+    lock_guard<mutex> lock(mu_);
+    if (isCancelled(pi, generation))
+        return false;
+
+    if (tsubushiChain)
+        fireableTsubushiChain_[pi] = move(tsubushiChain);
+    if (mainChain)
+        fireableMainChain_[pi] = move(mainChain);
+    return true;
 }
 
 void Commentator::reset()
@@ -234,6 +264,8 @@ void Commentator::reset()
     lock_guard<mutex> lock(mu_);
     for (int i = 0; i < 2; i++) {
         needsUpdate_[i] = false;
+        // Cancels the analyses of the previous game.
+        ++generation_[i];
         fireableMainChain_[i].reset();
         fireableTsubushiChain_[i].reset();
         firingChain_[i].reset();
@@ -1,6 +1,8 @@
 #ifndef GUI_COMMENTATOR_H_
 #define GUI_COMMENTATOR_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -60,27 +62,41 @@ public:
 
     void addCommentatorObserver(CommentatorObserver*);
 
+    // Starts a worker thread for each player. A worker sleeps until its player's field
+    // is updated, so the commentator doesn't consume CPU while idle.
     bool start();
     void stop();
-    void runLoop();
 
 private:
     // reset() should be called when a new game has started.
     void reset();
 
-    void update(int pi, const CoreField&, const KumipuyoSeq&);
+    void runWorkerLoop(int pi);
+
+    // Analyzes the field of player |pi|. Returns false when the analysis is cancelled,
+    // i.e. a newer field has arrived (|generation| is stale) or the commentator is stopping.
+    bool update(int pi, const CoreField&, const KumipuyoSeq&, int generation);
+    bool isCancelled(int pi, int generation) const { return shouldStop_ || generation_[pi] != generation; }
+
+    void notifyObservers();
 
     void addEventMessage(int pi, const std::string&);
     CommentatorResult result() const;
 
-    std::thread th_;
-    volatile bool shouldStop_;
+    std::thread th_[2];
+    std::atomic<bool> shouldStop_;
     volatile bool hasStarted_ = false;
-    volatile bool needsUpdate_[2];
+
+    // Observers are called from the worker threads. This serializes the calls.
+    std::mutex observerMu_;
 
     std::vector<CommentatorObserver*> observers_;
 
     mutable std::mutex mu_;
+    std::condition_variable condVar_;
+    bool needsUpdate_[2];
+    // Incremented when a new field arrives. An analysis of an older generation is cancelled.
+    std::atomic<int> generation_[2];
     CoreField field_[2];
     KumipuyoSeq kumipuyoSeq_[2];
     std::string message_[2];
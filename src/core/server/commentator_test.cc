@@ -3,15 +3,121 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include "base/base.h"
+#include "core/server/game_state.h"
 
 using namespace std;
 
 class CommentatorTest : public testing::Test {
 };
+
+namespace {
+
+class RecordingObserver : public CommentatorObserver {
+public:
+    void onCommentatorResultUpdate(const CommentatorResult& result) override
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        results_.push_back(result);
+        condVar_.notify_all();
+    }
+
+    // Waits until |pred| holds for some result. Returns false on timeout.
+    template<typename Pred>
+    bool waitFor(Pred pred)
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        return condVar_.wait_for(lock, std::chrono::seconds(10), [&]() {
+            for (const auto& r : results_) {
+                if (pred(r))
+                    return true;
+            }
+            return false;
+        });
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return results_.size();
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable condVar_;
+    std::vector<CommentatorResult> results_;
+};
+
+GameState makeGroundedGameState(int frameId, int pi, const PlainField& field)
+{
+    GameState gameState(frameId);
+    PlayerGameState* pgs = gameState.mutablePlayerGameState(pi);
+    pgs->field = field;
+    pgs->kumipuyoSeq = KumipuyoSeq("RRBB");
+    pgs->event.grounded = true;
+    return gameState;
+}
+
+}
+
+TEST_F(CommentatorTest, analyzeOnUpdate)
+{
+    RecordingObserver observer;
+    Commentator commentator;
+    commentator.addCommentatorObserver(&observer);
+    commentator.newGameWillStart();
+    ASSERT_TRUE(commentator.start());
+
+    commentator.onUpdate(makeGroundedGameState(1, 0, PlainField("RRRR..")));
+    commentator.onUpdate(makeGroundedGameState(2, 1, PlainField("BBB...")));
+
+    EXPECT_TRUE(observer.waitFor([](const CommentatorResult& r) {
+        return r.firingChain[0].chains() == 1 && r.fireableMainChain[1].chains() == 1;
+    }));
+
+    commentator.stop();
+}
+
+TEST_F(CommentatorTest, latestFieldIsAnalyzed)
+{
+    RecordingObserver observer;
+    Commentator commentator;
+    commentator.addCommentatorObserver(&observer);
+    commentator.newGameWillStart();
+    ASSERT_TRUE(commentator.start());
+
+    // The analysis of an older field might be cancelled, but the latest one must be reported.
+    for (int i = 1; i < 10; ++i)
+        commentator.onUpdate(makeGroundedGameState(i, 0, PlainField("BBB...")));
+    commentator.onUpdate(makeGroundedGameState(10, 0, PlainField("RRRR..")));
+
+    EXPECT_TRUE(observer.waitFor([](const CommentatorResult& r) {
+        return r.frameId[0] == 10 && r.firingChain[0].chains() == 1;
+    }));
+
+    commentator.stop();
+}
+
+TEST_F(CommentatorTest, noUpdateWhileIdle)
+{
+    RecordingObserver observer;
+    Commentator commentator;
+    commentator.addCommentatorObserver(&observer);
+    ASSERT_TRUE(commentator.start());
+
+    // A non-grounded update doesn't wake the workers up.
+    commentator.onUpdate(GameState(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(0U, observer.size());
+
+    commentator.stop();
+}
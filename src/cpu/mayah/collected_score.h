@@ -7,6 +7,7 @@
 
 #include "evaluation_feature.h"
 #include "evaluation_parameter.h"
+#include "mode_vector.h"
 
 struct CollectedCoef {
     double coef(EvaluationMode mode) const { return coefMap[ordinal(mode)]; }
@@ -25,7 +26,7 @@ struct CollectedSimpleSubScore {
         return s;
     }
 
-    std::array<double, NUM_EVALUATION_MODES> scoreMap {{}};
+    ModeVector scoreMap;
 };
 
 typedef CollectedSimpleSubScore CollectedSimpleMoveScore;
@@ -5,7 +5,9 @@
 
 #include <vector>
 
+#include "base/cancellation_token.h"
 #include "base/executor.h"
+#include "base/profiler.h"
 #include "base/wait_group.h"
 #include "core/algorithm/plan.h"
 #include "core/core_field.h"
@@ -35,6 +37,8 @@ public:
 
     // When decision sequence is specified, we consider only this decision sequence.
     void setSpecifiedDecisions(const std::vector<Decision>& decisions) { decisions_ = decisions; }
+    // When |token| says to stop, iterate() stops calling the callbacks and returns soon.
+    void setCancellationToken(const CancellationToken& token) { cancellationToken_ = token; }
 
     void iterate(int frameId, const CoreField& originalField, const KumipuyoSeq& kumipuyoSeq,
                  const PlayerState& me, const PlayerState& enemy, int maxDepth);
@@ -58,12 +62,14 @@ private:
 
     void parallelEval(int currentDepth, const RefPlan& plan, const MidEvaluationResult& midEvaluationResult, WaitGroup* wg);
 
-     // callback: void (const CoreField&, const Decision&, bool isChigiri, int dropFrames);
+    // callback: void (const CoreField&, const Decision&, bool isChigiri, int dropFrames);
+    // The field passed to |callback| is valid only during the call. Copy it to modify or keep it.
     template<typename Callback>
     void iterateKumipuyoDrop(int currentDepth, const CoreField& currentField, const Kumipuyo& kumipuyo, Callback callback);
 
     Executor* executor_;
     std::vector<Decision> decisions_;
+    CancellationToken cancellationToken_;
     MidEvaluationCallback midEval_;
     EvaluationCallback eval_;
 };
@@ -121,42 +127,41 @@ void DecisionPlanner<MidEvaluationResult>::iterateKumipuyoDrop(int currentDepth,
                                                                const Kumipuyo& kumipuyo,
                                                                Callback callback)
 {
-    static const Decision DECISIONS[] = {
-        Decision(2, 3), Decision(3, 3), Decision(3, 1), Decision(4, 1),
-        Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2),
-        Decision(4, 2), Decision(5, 2), Decision(6, 2),
-        Decision(1, 1), Decision(2, 1), Decision(4, 3), Decision(5, 3),
-        Decision(6, 3), Decision(1, 0), Decision(2, 0), Decision(3, 0),
-        Decision(4, 0), Decision(5, 0), Decision(6, 0),
-    };
-
     DCHECK(isNormalColor(kumipuyo.axis)) << kumipuyo.axis;
     DCHECK(isNormalColor(kumipuyo.child)) << kumipuyo.child;
 
-    // Since copying CoreField is not so fast, we'd like to skip copying as many as possible.
-    int numDecisions = kumipuyo.axis == kumipuyo.child ? 11 : 22;
-    const Decision* decisionsHead = DECISIONS;
-
-    // When decisions are specified, we consider only such decision.
+    CoreField::KumipuyoPlacement placements[22];
+    int numPlacements = 0;
     if (static_cast<size_t>(currentDepth) < decisions_.size()) {
-        numDecisions = 1;
-        decisionsHead = &decisions_[currentDepth];
+        // When decisions are specified, we consider only such decision.
+        const Decision& decision = decisions_[currentDepth];
+        if (!PuyoController::isReachable(currentField, decision))
+            return;
+        placements[0].decision = decision;
+        placements[0].dropFrames = currentField.framesToDropNext(decision);
+        placements[0].isChigiri = currentField.isChigiriDecision(decision);
+        numPlacements = 1;
+    } else {
+        int numRepPlacements;
+        numPlacements = currentField.computeKumipuyoPlacements(placements, &numRepPlacements);
+        if (kumipuyo.isRep())
+            numPlacements = numRepPlacements;
     }
 
-    for (int i = 0; i < numDecisions; ++i) {
-        const Decision& decision = decisionsHead[i];
-
-        if (!PuyoController::isReachable(currentField, decision))
-            continue;
+    // Since copying CoreField is not so fast, we copy it only once. Each decision is dropped
+    // on |field|, and undone after the callback. The callback copies the field only when
+    // it needs to modify it, e.g. rensa occurs or ojama falls.
+    CoreField field(currentField);
+    for (int i = 0; i < numPlacements; ++i) {
+        if (cancellationToken_.shouldStop())
+            return;
 
-        CoreField nextField(currentField);
-        if (!nextField.dropKumipuyo(decision, kumipuyo))
+        const CoreField::KumipuyoPlacement& placement = placements[i];
+        if (!field.dropKumipuyo(placement.decision, kumipuyo))
             continue;
 
-        bool isChigiri = currentField.isChigiriDecision(decision);
-        int dropFrames = currentField.framesToDropNext(decision);
-
-        callback(std::move(nextField), decision, isChigiri, dropFrames);
+        callback(static_cast<const CoreField&>(field), placement.decision, placement.isChigiri, placement.dropFrames);
+        field.undoDropKumipuyo(placement.decision);
     }
 }
 
@@ -178,7 +183,7 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
                                                        const MidEvaluationResult& midEvaluationResult,
                                                        WaitGroup* wg)
 {
-    auto f = [&](CoreField&& fieldAfterDecision, const Decision& decision, bool isChigiri, int dropFrames) {
+    auto f = [&](const CoreField& fieldAfterDecision, const Decision& decision, bool isChigiri, int dropFrames) {
         std::vector<Decision> decisions(currentDecisions);
         decisions.push_back(decision);
 
@@ -193,12 +198,13 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
 
         // --- When rensa will occur.
         if (fieldAfterDecision.rensaWillOccur()) {
-            RensaResult rensaResult = fieldAfterDecision.simulate();
+            CoreField cf(fieldAfterDecision);
+            RensaResult rensaResult = cf.simulate();
             int generatedOjama = rensaResult.score / 70 + (newHasZenkeshi ? 30 : 0);
             newHasZenkeshi = false;
             int newFallenOjama = updateOjama(frameIdToIgnite, generatedOjama, &newFixedOjama, &newPendingOjama, &newOjamaCommittingFrameId);
-            int ojamaDroppingFrames = fallOjama(&fieldAfterDecision, newFallenOjama);
-            parallelEval(currentDepth, RefPlan(fieldAfterDecision, decisions, rensaResult, numChigiri, currentTotalFrames, dropFrames + ojamaDroppingFrames,
+            int ojamaDroppingFrames = fallOjama(&cf, newFallenOjama);
+            parallelEval(currentDepth, RefPlan(cf, decisions, rensaResult, numChigiri, currentTotalFrames, dropFrames + ojamaDroppingFrames,
                                                newFallenOjama + fallenOjama, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi),
                          midEvaluationResult, wg);
             return;
@@ -206,32 +212,43 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
 
         // --- When rensa won't occur.
         int ojamaCount = updateOjama(frameIdToIgnite, 0, &newFixedOjama, &newPendingOjama, &newOjamaCommittingFrameId);
-        int ojamaDroppingFrames = fallOjama(&fieldAfterDecision, ojamaCount);
 
-        if (fieldAfterDecision.color(3, 12) != PuyoColor::EMPTY)
-            return;
-
-        if (currentDepth + 1 == maxDepth) {
-            parallelEval(currentDepth,
-                         RefPlan(fieldAfterDecision, decisions, RensaResult(), numChigiri, currentTotalFrames, dropFrames + ojamaDroppingFrames,
-                                 ojamaCount + fallenOjama, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi),
-                         midEvaluationResult, wg);
-            return;
-        }
-
-        int totalFrames = currentTotalFrames + dropFrames + ojamaDroppingFrames;
-        if (executor_ && currentDepth <= 1) {
-            wg->add(1);
-            executor_->submit([=]() {
-                iterateRest(initialFrameId, fieldAfterDecision, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
-                            fallenOjama + ojamaCount,
-                            newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
-
-                wg->done();
-            });
+        auto next = [&](const CoreField& nextField, int ojamaDroppingFrames) {
+            if (nextField.color(3, 12) != PuyoColor::EMPTY)
+                return;
+
+            if (currentDepth + 1 == maxDepth) {
+                parallelEval(currentDepth,
+                             RefPlan(nextField, decisions, RensaResult(), numChigiri, currentTotalFrames, dropFrames + ojamaDroppingFrames,
+                                     ojamaCount + fallenOjama, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi),
+                             midEvaluationResult, wg);
+                return;
+            }
+
+            int totalFrames = currentTotalFrames + dropFrames + ojamaDroppingFrames;
+            if (executor_ && currentDepth <= 1) {
+                wg->add(1);
+                // |nextField| is copied here, since it will be undone soon.
+                executor_->submit([=]() {
+                    iterateRest(initialFrameId, nextField, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
+                                fallenOjama + ojamaCount,
+                                newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
+
+                    wg->done();
+                });
+            } else {
+                iterateRest(initialFrameId, nextField, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
+                            fallenOjama + ojamaCount, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
+            }
+        };
+
+        // Ojama modifies the field, so copy it only in that case.
+        if (ojamaCount > 0) {
+            CoreField cf(fieldAfterDecision);
+            int ojamaDroppingFrames = fallOjama(&cf, ojamaCount);
+            next(cf, ojamaDroppingFrames);
         } else {
-            iterateRest(initialFrameId, fieldAfterDecision, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
-                        fallenOjama + ojamaCount, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
+            next(fieldAfterDecision, 0);
         }
     };
 
@@ -246,6 +263,7 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
                                                    const PlayerState& enemy,
                                                    int maxDepth)
 {
+    PROFILE_SCOPE("DecisionPlanner::iterate");
     DCHECK(maxDepth >= 2);
     DCHECK(kumipuyoSeq.size() >= maxDepth);
 
@@ -294,22 +312,29 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
         }
 
         // When rensa doesn't occur.
-        CoreField cf(fieldAfterDecision);
         int currentFrameId = initialFrameId + dropFrames;
         int ojamaCount = updateOjama(currentFrameId, 0, &fixedOjama, &pendingOjama, &ojamaCommittingFrameId);
-        int ojamaDroppingFrames = fallOjama(&cf, ojamaCount);
 
-        if (cf.color(3, 12) != PuyoColor::EMPTY) {
-            decisions.pop_back();
-            return;
-        }
+        auto next = [&](const CoreField& cf, int ojamaDroppingFrames) {
+            if (cf.color(3, 12) != PuyoColor::EMPTY)
+                return;
+
+            MidEvaluationResult midEvaluationResult =
+                midEval_(RefPlan(cf, decisions, RensaResult(), numChigiri, 0, dropFrames + ojamaDroppingFrames,
+                                 ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, me.hasZenkeshi));
 
-        MidEvaluationResult midEvaluationResult =
-            midEval_(RefPlan(cf, decisions, RensaResult(), numChigiri, 0, dropFrames + ojamaDroppingFrames,
-                             ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, me.hasZenkeshi));
+            iterateRest(initialFrameId, cf, kumipuyoSeq, decisions, numChigiri, dropFrames + ojamaDroppingFrames, 1, maxDepth,
+                        ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &wg);
+        };
 
-        iterateRest(initialFrameId, cf, kumipuyoSeq, decisions, numChigiri, dropFrames + ojamaDroppingFrames, 1, maxDepth,
-                    ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &wg);
+        // Ojama modifies the field, so copy it only in that case.
+        if (ojamaCount > 0) {
+            CoreField cf(fieldAfterDecision);
+            int ojamaDroppingFrames = fallOjama(&cf, ojamaCount);
+            next(cf, ojamaDroppingFrames);
+        } else {
+            next(fieldAfterDecision, 0);
+        }
 
     };
 
@@ -327,10 +352,11 @@ void DecisionPlanner<MidEvaluationResult>::parallelEval(int currentDepth, const
         wg->add(1);
         Plan plan(refPlan.toPlan());
         executor_->submit([this, plan, midEvaluationResult, wg]() {
-                this->eval_(RefPlan(plan), midEvaluationResult);
+                if (!this->cancellationToken_.shouldStop())
+                    this->eval_(RefPlan(plan), midEvaluationResult);
                 wg->done();
         });
-    } else {
+    } else if (!cancellationToken_.shouldStop()) {
         eval_(refPlan, midEvaluationResult);
     }
 }
@@ -100,3 +100,24 @@ TEST(DecisionPlannerTest, numChigiri)
     runTest(field, seq, 2, f);
     EXPECT_TRUE(found);
 }
+
+TEST(DecisionPlannerTest, cancel)
+{
+    CoreField field("  YY  ");
+    KumipuyoSeq seq("RRBB");
+    PlayerState me;
+    PlayerState enemy;
+
+    CancellationToken token = CancellationToken::create();
+    int numEvaluated = 0;
+    auto f = [&](const RefPlan&, const Unit&) {
+        ++numEvaluated;
+        token.cancel();
+    };
+
+    DecisionPlanner<Unit> planner(unitMidEvaluator, f);
+    planner.setCancellationToken(token);
+    planner.iterate(100, field, seq, me, enemy, 2);
+
+    EXPECT_EQ(1, numEvaluated);
+}
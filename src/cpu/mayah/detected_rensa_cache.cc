@@ -0,0 +1,18 @@
+#include "detected_rensa_cache.h"
+
+using namespace std;
+
+shared_ptr<const DetectedRensaCache::DetectedRensas>
+DetectedRensaCache::get(const CoreField& canonicalField, const vector<int>& matchablePatternIds, int maxIteration)
+{
+    shared_ptr<const DetectedRensas> detectedRensas;
+    if (!cache_.get(Key(canonicalField, matchablePatternIds, maxIteration), &detectedRensas))
+        return nullptr;
+    return detectedRensas;
+}
+
+void DetectedRensaCache::put(const CoreField& canonicalField, const vector<int>& matchablePatternIds, int maxIteration,
+                             shared_ptr<const DetectedRensas> detectedRensas)
+{
+    cache_.put(Key(canonicalField, matchablePatternIds, maxIteration), std::move(detectedRensas));
+}
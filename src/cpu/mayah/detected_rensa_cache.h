@@ -0,0 +1,103 @@
+#ifndef CPU_MAYAH_DETECTED_RENSA_CACHE_H_
+#define CPU_MAYAH_DETECTED_RENSA_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/generation_cache.h"
+#include "base/noncopyable.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/puyo_color.h"
+#include "core/rensa_result.h"
+
+// DetectedRensaCache memoizes the rensas that Evaluator::eval detects from a field
+// (the pattern rensas and the side chains). The detection doesn't depend on the actual colors
+// of puyos, so the rensas are stored for the color-canonicalized field
+// (see ColorPermutation::canonicalize()), and the fields that differ only by colors share
+// the same entry. The caller should canonicalize the field before looking up, and should
+// relabel the returned rensas with the inverse permutation.
+//
+// The entries live across think() calls: the fields evaluated in a think() often appear
+// again in the next think(), one kumipuyo later.
+// This class is thread-safe.
+class DetectedRensaCache : noncopyable {
+public:
+    static const size_t DEFAULT_MAX_SIZE = 1 << 12;
+
+    struct DetectedRensa {
+        DetectedRensa(const CoreField& fieldAfterRensa,
+                      const RensaResult& rensaResult,
+                      const ColumnPuyoList& puyosToComplement,
+                      PuyoColor firePuyoColor,
+                      const std::string& patternName,
+                      double patternScore) :
+            fieldAfterRensa(fieldAfterRensa),
+            rensaResult(rensaResult),
+            puyosToComplement(puyosToComplement),
+            firePuyoColor(firePuyoColor),
+            patternName(patternName),
+            patternScore(patternScore)
+        {
+        }
+
+        CoreField fieldAfterRensa;
+        RensaResult rensaResult;
+        ColumnPuyoList puyosToComplement;
+        PuyoColor firePuyoColor;
+        std::string patternName;
+        double patternScore;
+    };
+    typedef std::vector<DetectedRensa> DetectedRensas;
+
+    explicit DetectedRensaCache(size_t maxSize = DEFAULT_MAX_SIZE) : cache_(maxSize) {}
+
+    // Returns the detected rensas if they are cached. Otherwise, nullptr is returned.
+    std::shared_ptr<const DetectedRensas> get(const CoreField& canonicalField,
+                                              const std::vector<int>& matchablePatternIds,
+                                              int maxIteration);
+    // When the cache is full, the old entries are evicted. See GenerationCache::put().
+    void put(const CoreField& canonicalField, const std::vector<int>& matchablePatternIds, int maxIteration,
+             std::shared_ptr<const DetectedRensas> detectedRensas);
+
+    // Starts a new generation. See GenerationCache::nextGeneration().
+    void nextGeneration() { cache_.nextGeneration(); }
+    void clear() { cache_.clear(); }
+
+    size_t size() const { return cache_.size(); }
+    int numHits() const { return cache_.numHits(); }
+    int numMisses() const { return cache_.numMisses(); }
+    double hitRate() const { return cache_.hitRate(); }
+
+private:
+    struct Key {
+        Key(const CoreField& field, const std::vector<int>& matchablePatternIds, int maxIteration) :
+            field(field), matchablePatternIds(matchablePatternIds), maxIteration(maxIteration) {}
+
+        friend bool operator==(const Key& lhs, const Key& rhs)
+        {
+            return lhs.maxIteration == rhs.maxIteration &&
+                lhs.field == rhs.field &&
+                lhs.matchablePatternIds == rhs.matchablePatternIds;
+        }
+
+        CoreField field;
+        std::vector<int> matchablePatternIds;
+        int maxIteration;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const
+        {
+            size_t v = key.field.hash() * 31 + key.maxIteration;
+            for (int id : key.matchablePatternIds)
+                v = v * 37 + id;
+            return v;
+        }
+    };
+
+    GenerationCache<Key, std::shared_ptr<const DetectedRensas>, KeyHash> cache_;
+};
+
+#endif // CPU_MAYAH_DETECTED_RENSA_CACHE_H_
@@ -0,0 +1,42 @@
+#include "detected_rensa_cache.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+shared_ptr<const DetectedRensaCache::DetectedRensas> makeDetectedRensas(const CoreField& field, int chains)
+{
+    auto detectedRensas = make_shared<DetectedRensaCache::DetectedRensas>();
+    detectedRensas->emplace_back(field, RensaResult(chains, 40 * chains, 0, false), ColumnPuyoList(),
+                                 PuyoColor::RED, "GTR", 1.0);
+    return detectedRensas;
+}
+
+} // namespace anonymous
+
+TEST(DetectedRensaCacheTest, getAndPut)
+{
+    const CoreField field("RRR...");
+    const vector<int> ids { 1, 3 };
+
+    DetectedRensaCache cache;
+    EXPECT_EQ(0.0, cache.hitRate());
+    EXPECT_FALSE(cache.get(field, ids, 3));
+
+    cache.put(field, ids, 3, makeDetectedRensas(field, 1));
+    auto detectedRensas = cache.get(field, ids, 3);
+    ASSERT_TRUE(detectedRensas.get());
+    ASSERT_EQ(1U, detectedRensas->size());
+    EXPECT_EQ(1, detectedRensas->front().rensaResult.chains);
+    EXPECT_EQ("GTR", detectedRensas->front().patternName);
+
+    EXPECT_FALSE(cache.get(field, ids, 2));
+    EXPECT_FALSE(cache.get(field, vector<int> { 1 }, 3));
+    EXPECT_FALSE(cache.get(CoreField("RRRB.."), ids, 3));
+
+    EXPECT_EQ(1, cache.numHits());
+    EXPECT_EQ(4, cache.numMisses());
+    EXPECT_DOUBLE_EQ(0.2, cache.hitRate());
+}
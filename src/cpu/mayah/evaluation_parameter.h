@@ -14,6 +14,7 @@
 #include "base/base.h"
 #include "evaluation_feature.h"
 #include "evaluation_mode.h"
+#include "mode_vector.h"
 
 template<typename FeatureSet>
 class EvaluationParameter {
@@ -77,7 +78,8 @@ public:
 
     toml::Value toTomlValue() const
     {
-        toml::Value v;
+        // Make this a table even when no parameter is set, so that it can be loaded again.
+        toml::Value v((toml::Table()));
 
         for (const auto& ef : FeatureSet::features()) {
             if (!hasParam(ef.key()))
@@ -198,6 +200,22 @@ public:
     typedef typename FeatureSet::FeatureKey FeatureKey;
     typedef typename FeatureSet::SparseFeatureKey SparseFeatureKey;
 
+    EvaluationParameterSet() :
+        sparseOffset_(FeatureSet::sparseFeatures().size())
+    {
+        size_t size = FeatureSet::features().size();
+        for (const auto& feature : FeatureSet::sparseFeatures()) {
+            sparseOffset_[feature.key()] = size;
+            size += feature.size();
+        }
+        matrix_.resize(size);
+    }
+
+    // Returns the parameters of all the modes for |key|. The default parameter is already
+    // taken into account. This is faster than calling param() for each mode.
+    const ModeVector& params(FeatureKey key) const { return matrix_[key]; }
+    const ModeVector& params(SparseFeatureKey key, int idx) const { return matrix_[sparseOffset_[key] + idx]; }
+
     double param(EvaluationMode mode, FeatureKey key) const
     {
         if (params_[ordinal(mode)].hasParam(key))
@@ -215,21 +233,25 @@ public:
     void setParam(EvaluationMode mode, FeatureKey key, double value)
     {
         params_[ordinal(mode)].setParam(key, value);
+        updateMatrix(key);
     }
 
     void setParam(EvaluationMode mode, SparseFeatureKey key, int index, double value)
     {
         params_[ordinal(mode)].setParam(key, index, value);
+        updateMatrix(key);
     }
 
     void setDefault(FeatureKey key, double value)
     {
         defaultParam_.setParam(key, value);
+        updateMatrix(key);
     }
 
     void setDefault(SparseFeatureKey key, int index, double value)
     {
         defaultParam_.setParam(key, index, value);
+        updateMatrix(key);
     }
 
     void removeNontokopuyoParameter()
@@ -238,6 +260,7 @@ public:
         for (auto& param : params_) {
             param.removeNontokopuyoParameter();
         }
+        updateMatrix();
     }
 
     void clear()
@@ -246,6 +269,7 @@ public:
         for (auto& param : params_) {
             param.clear();
         }
+        updateMatrix();
     }
 
     toml::Value toTomlValue(const std::string& anotherKey) const
@@ -288,24 +312,57 @@ public:
             const toml::Value* v = value.find(modeKey);
             if (!v)
                 continue;
-            if (!params_[ordinal(mode)].loadValue(*v))
+            if (!params_[ordinal(mode)].loadValue(*v)) {
+                updateMatrix();
                 return false;
+            }
         }
 
         {
             std::string defaultKey = std::string("mode.default.") + anotherKey;
             const toml::Value* v = value.find(defaultKey);
             CHECK(v != nullptr) << defaultKey << "was not found.";
-            if (!defaultParam_.loadValue(*v))
+            if (!defaultParam_.loadValue(*v)) {
+                updateMatrix();
                 return false;
+            }
         }
 
+        updateMatrix();
         return true;
     }
 
 private:
+    void updateMatrix(FeatureKey key)
+    {
+        for (const auto& mode : ALL_EVALUATION_MODES)
+            matrix_[key].set(mode, param(mode, key));
+    }
+
+    void updateMatrix(SparseFeatureKey key)
+    {
+        // Setting one index changes hasParam() of the whole key, so update all the indices.
+        for (size_t idx = 0; idx < toFeature(key).size(); ++idx) {
+            for (const auto& mode : ALL_EVALUATION_MODES)
+                matrix_[sparseOffset_[key] + idx].set(mode, param(mode, key, idx));
+        }
+    }
+
+    void updateMatrix()
+    {
+        for (const auto& feature : FeatureSet::features())
+            updateMatrix(feature.key());
+        for (const auto& feature : FeatureSet::sparseFeatures())
+            updateMatrix(feature.key());
+    }
+
     Param defaultParam_;
     std::array<Param, NUM_EVALUATION_MODES> params_;
+
+    // Feature x mode matrix of the resolved parameters. Sparse features are placed after
+    // the normal features; the sparse feature |key| starts from |sparseOffset_[key]|.
+    std::vector<ModeVector> matrix_;
+    std::vector<size_t> sparseOffset_;
 };
 
 typedef EvaluationParameterSet<EvaluationMoveParameter, EvaluationMoveFeatureSet> EvaluationMoveParameterSet;
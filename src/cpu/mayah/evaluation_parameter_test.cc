@@ -24,3 +24,36 @@ TEST(EvaluationParameterTest, setter)
     EXPECT_EQ(2.0, m.moveParamSet().param(EvaluationMode::EARLY, TOTAL_FRAMES));
     EXPECT_EQ(1.0, m.moveParamSet().param(EvaluationMode::MIDDLE, TOTAL_FRAMES));
 }
+
+TEST(EvaluationParameterTest, loadValueWithoutParameter)
+{
+    EvaluationParameterMap m;
+    m.mutableMainRensaParamSet()->setDefault(SCORE, 1.0);
+
+    EvaluationParameterMap loaded;
+    EXPECT_TRUE(loaded.loadValue(m.toTomlValue()));
+    EXPECT_EQ(1.0, loaded.mainRensaParamSet().param(EvaluationMode::EARLY, SCORE));
+    EXPECT_EQ(m.toString(), loaded.toString());
+}
+
+TEST(EvaluationParameterTest, params)
+{
+    EvaluationParameterMap m;
+    m.mutableMoveParamSet()->setDefault(TOTAL_FRAMES, 1.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::EARLY, TOTAL_FRAMES, 2.0);
+    m.mutableMoveParamSet()->setDefault(VALLEY_DEPTH, 3, 3.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::LATE, VALLEY_DEPTH, 2, 4.0);
+
+    for (const auto& mode : ALL_EVALUATION_MODES) {
+        EXPECT_EQ(m.moveParamSet().param(mode, TOTAL_FRAMES), m.moveParamSet().params(TOTAL_FRAMES).get(mode));
+        for (int i = 0; i < 15; ++i) {
+            EXPECT_EQ(m.moveParamSet().param(mode, VALLEY_DEPTH, i),
+                      m.moveParamSet().params(VALLEY_DEPTH, i).get(mode));
+        }
+    }
+
+    // Since LATE has VALLEY_DEPTH, the default parameter is not used for LATE.
+    EXPECT_EQ(3.0, m.moveParamSet().params(VALLEY_DEPTH, 3).get(EvaluationMode::MIDDLE));
+    EXPECT_EQ(0.0, m.moveParamSet().params(VALLEY_DEPTH, 3).get(EvaluationMode::LATE));
+    EXPECT_EQ(4.0, m.moveParamSet().params(VALLEY_DEPTH, 2).get(EvaluationMode::LATE));
+}
@@ -9,9 +9,11 @@
 
 #include <glog/logging.h>
 
+#include "base/profiler.h"
 #include "base/time.h"
 #include "core/algorithm/plan.h"
 #include "core/algorithm/rensa_detector.h"
+#include "core/color_permutation.h"
 #include "core/core_field.h"
 #include "core/decision.h"
 #include "core/field_checker.h"
@@ -21,6 +23,7 @@
 #include "core/rensa_result.h"
 #include "core/score.h"
 
+#include "detected_rensa_cache.h"
 #include "evaluation_parameter.h"
 #include "gazer.h"
 #include "move_evaluator.h"
@@ -30,6 +33,28 @@
 
 using namespace std;
 
+namespace {
+
+// Detects the pattern rensas and the side chains from |field|, and calls |callback| for each.
+void detectRensas(const PatternBook& patternBook,
+                  const CoreField& field,
+                  const vector<int>& matchablePatternIds,
+                  int maxIteration,
+                  const PatternRensaDetector::Callback& callback)
+{
+    PatternRensaDetector detector(patternBook, field, callback);
+    detector.iteratePossibleRensas(matchablePatternIds, maxIteration);
+
+    RensaDetector::detectSideChain(field, RensaDetectorStrategy::defaultDropStrategy(),
+                                   [&](CoreField&& cf, const ColumnPuyoList& cpl) {
+        // TODO(mayah): fireColor is not PuyoColor::EMPTY.
+        RensaResult rensaResult = cf.simulate();
+        callback(cf, rensaResult, cpl, PuyoColor::EMPTY, string(), 0.0);
+    });
+}
+
+} // namespace anonymous
+
 // ----------------------------------------------------------------------
 
 PreEvalResult PreEvaluator::preEval(const CoreField& currentField)
@@ -436,9 +461,9 @@ template<typename ScoreCollector>
 void Evaluator<ScoreCollector>::evalMidEval(const MidEvalResult& midEvalResult)
 {
     // Copy midEvalResult.
-    for (const auto& entry : midEvalResult.collectedFeatures()) {
-        sc_->addScore(entry.first, entry.second);
-    }
+    midEvalResult.iterateFeatures([this](EvaluationMoveFeatureKey key, double value) {
+        sc_->addScore(key, value);
+    });
 }
 
 template<typename ScoreCollector>
@@ -502,6 +527,8 @@ void Evaluator<ScoreCollector>::eval(const RefPlan& plan,
                                      bool usesRensaHandTree,
                                      const GazeResult& gazeResult)
 {
+    PROFILE_SCOPE("Evaluator::eval");
+
     typedef typename ScoreCollector::RensaScoreCollector RensaScoreCollector;
     typedef typename RensaScoreCollector::CollectedScore RensaCollectedScore;
 
@@ -538,6 +565,9 @@ void Evaluator<ScoreCollector>::eval(const RefPlan& plan,
         RensaCollectedScore collectedScore;
     } sideRensa;
 
+    // The tree is made serially without an executor: eval() itself runs in the tasks of
+    // DecisionPlanner's executor, and waiting for the subtasks in the same pool might deadlock.
+    // It's skipped in fast mode, since it takes the most of the time of eval().
     RensaHandNodeMaker handTreeMaker(2, restSeq);
     auto evalCallback = [&](const CoreField& fieldAfterRensa,
                             const RensaResult& rensaResult,
@@ -626,15 +656,34 @@ void Evaluator<ScoreCollector>::eval(const RefPlan& plan,
         }
     };
 
-    PatternRensaDetector detector(patternBook(), fieldBeforeRensa, evalCallback);
-    detector.iteratePossibleRensas(preEvalResult.matchablePatternIds(), maxIteration);
+    if (detectedRensaCache_) {
+        // The rensas are detected from (or looked up with) the color-canonicalized field,
+        // and relabeled with the original colors.
+        const ColorPermutation perm = ColorPermutation::canonicalize(fieldBeforeRensa.bitField());
+        const CoreField canonicalField = perm.apply(fieldBeforeRensa);
+        shared_ptr<const DetectedRensaCache::DetectedRensas> detectedRensas =
+            detectedRensaCache_->get(canonicalField, preEvalResult.matchablePatternIds(), maxIteration);
+        if (!detectedRensas) {
+            auto rensas = make_shared<DetectedRensaCache::DetectedRensas>();
+            detectRensas(patternBook(), canonicalField, preEvalResult.matchablePatternIds(), maxIteration,
+                         [&](const CoreField& fieldAfterRensa, const RensaResult& rensaResult,
+                             const ColumnPuyoList& puyosToComplement, PuyoColor firePuyoColor,
+                             const string& patternName, double patternScore) {
+                rensas->emplace_back(fieldAfterRensa, rensaResult, puyosToComplement,
+                                     firePuyoColor, patternName, patternScore);
+            });
+            detectedRensaCache_->put(canonicalField, preEvalResult.matchablePatternIds(), maxIteration, rensas);
+            detectedRensas = std::move(rensas);
+        }
 
-    RensaDetector::detectSideChain(fieldBeforeRensa, RensaDetectorStrategy::defaultDropStrategy(),
-                                   [&](CoreField&& cf, const ColumnPuyoList& cpl) {
-        // TODO(mayah): fireColor is not PuyoColor::EMPTY.
-        RensaResult rensaResult = cf.simulate();
-        evalCallback(cf, rensaResult, cpl, PuyoColor::EMPTY, string(), 0.0);
-    });
+        const ColorPermutation inv = perm.inverse();
+        for (const auto& rensa : *detectedRensas) {
+            evalCallback(inv.apply(rensa.fieldAfterRensa), rensa.rensaResult, inv.apply(rensa.puyosToComplement),
+                         inv.apply(rensa.firePuyoColor), rensa.patternName, rensa.patternScore);
+        }
+    } else {
+        detectRensas(patternBook(), fieldBeforeRensa, preEvalResult.matchablePatternIds(), maxIteration, evalCallback);
+    }
 
     int rensaHandValue = 0;
     if (!fast && usesRensaHandTree) {
@@ -1,7 +1,8 @@
 #ifndef CPU_MAYAH_EVALUATOR_H_
 #define CPU_MAYAH_EVALUATOR_H_
 
-#include <map>
+#include <array>
+#include <cstdint>
 #include <vector>
 
 #include "evaluation_feature.h"
@@ -10,6 +11,7 @@
 
 class ColumnPuyoList;
 class CoreField;
+class DetectedRensaCache;
 class GazeResult;
 class KumipuyoSeq;
 class RefPlan;
@@ -48,26 +50,33 @@ public:
     PreEvalResult preEval(const CoreField& currentField);
 };
 
+// MidEvalResult is copied for each plan in DecisionPlanner, so features are
+// stored in a fixed size array instead of std::map.
 class MidEvalResult {
 public:
+    static_assert(NUM_EVALUATION_MOVE_FEATURE_KEYS <= 64, "keys_ cannot hold all the keys");
+
     void add(EvaluationMoveFeatureKey key, double value)
     {
-        collectedFeatures_[key] = value;
+        features_[key] = value;
+        keys_ |= 1ULL << key;
     }
 
-    double feature(EvaluationMoveFeatureKey key) const
-    {
-        auto it = collectedFeatures_.find(key);
-        if (it == collectedFeatures_.end())
-            return 0;
+    double feature(EvaluationMoveFeatureKey key) const { return features_[key]; }
 
-        return it->second;
+    // Calls |callback(key, value)| for each added feature in ascending order of key.
+    template<typename Callback>
+    void iterateFeatures(Callback callback) const
+    {
+        for (std::uint64_t keys = keys_; keys != 0; keys &= keys - 1) {
+            EvaluationMoveFeatureKey key = static_cast<EvaluationMoveFeatureKey>(__builtin_ctzll(keys));
+            callback(key, features_[key]);
+        }
     }
 
-    const std::map<EvaluationMoveFeatureKey, double>& collectedFeatures() const { return collectedFeatures_; }
-
 private:
-    std::map<EvaluationMoveFeatureKey, double> collectedFeatures_;
+    std::uint64_t keys_ = 0;
+    std::array<double, NUM_EVALUATION_MOVE_FEATURE_KEYS> features_ {{}};
 };
 
 class MidEvaluator : public EvaluatorBase {
@@ -118,10 +127,13 @@ private:
 template<typename ScoreCollector>
 class Evaluator : public EvaluatorBase {
 public:
-    // Don't take ownership of |sc|.
-    Evaluator(const PatternBook& patternBook, ScoreCollector* sc) :
+    // Don't take ownership of |sc| and |detectedRensaCache|.
+    // When |detectedRensaCache| is specified, the rensas detected in eval() are memoized there.
+    Evaluator(const PatternBook& patternBook, ScoreCollector* sc,
+              DetectedRensaCache* detectedRensaCache = nullptr) :
         EvaluatorBase(patternBook),
-        sc_(sc) {}
+        sc_(sc),
+        detectedRensaCache_(detectedRensaCache) {}
 
     void eval(const RefPlan&, const KumipuyoSeq&, int currentFrameId, int maxIteration,
               const PlayerState& me, const PlayerState& enemy,
@@ -141,6 +153,7 @@ private:
     CollectedCoef calculateDefaultCoef(const PlayerState& me, const PlayerState& enemy) const;
 
     ScoreCollector* sc_;
+    DetectedRensaCache* detectedRensaCache_;
 };
 
 #endif // CPU_MAYAH_EVALUATOR_H_
@@ -4,9 +4,11 @@
 #include <gtest/gtest.h>
 
 #include "core/algorithm/plan.h"
+#include "core/color_permutation.h"
 #include "core/core_field.h"
 #include "core/decision.h"
 #include "core/probability/puyo_set_probability.h"
+#include "detected_rensa_cache.h"
 #include "gazer.h"
 
 using namespace std;
@@ -35,6 +37,24 @@ protected:
         return sc.collectedScore();
     }
 
+    double evalSimpleScore(const CoreField& f, DetectedRensaCache* cache)
+    {
+        EvaluationParameterMap evaluationParameterMap;
+        PatternBook patternBook;
+        Gazer gazer;
+
+        gazer.initialize(100);
+
+        vector<Decision> decisions { Decision(3, 0) };
+        RefPlan plan(f, decisions, RensaResult(), 0, 10, 10, 0, 0, 0, 0, false);
+
+        PreEvalResult preEvalResult = PreEvaluator(patternBook).preEval(f);
+        SimpleScoreCollector sc(evaluationParameterMap);
+        Evaluator<SimpleScoreCollector> evaluator(patternBook, &sc, cache);
+        evaluator.eval(plan, KumipuyoSeq(), 1, 2, PlayerState(), PlayerState(), preEvalResult, MidEvalResult(), false, false, gazer.gazeResult());
+        return sc.collectedScore().score(sc.collectedCoef());
+    }
+
     template<typename F>
     CollectedFeatureScore withEvaluator(F f) {
         EvaluationParameterMap evaluationParameterMap;
@@ -60,6 +80,26 @@ protected:
     }
 };
 
+TEST(MidEvalResultTest, features)
+{
+    MidEvalResult result;
+    result.add(MIDEVAL_RESULT, 3.0);
+    result.add(MIDEVAL_ERASE, 1.0);
+
+    EXPECT_EQ(3.0, result.feature(MIDEVAL_RESULT));
+    EXPECT_EQ(1.0, result.feature(MIDEVAL_ERASE));
+    EXPECT_EQ(0.0, result.feature(TOTAL_FRAMES));
+
+    MidEvalResult copied(result);
+    vector<EvaluationMoveFeatureKey> keys;
+    copied.iterateFeatures([&](EvaluationMoveFeatureKey key, double value) {
+        keys.push_back(key);
+        EXPECT_EQ(result.feature(key), value);
+    });
+    EXPECT_EQ(2U, keys.size());
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+}
+
 TEST_F(EvaluatorTest, evalRensaGarbage)
 {
     CoreField f("R    R"
@@ -199,3 +239,30 @@ TEST_F(EvaluatorTest, DontCrash2)
     CoreField f;
     (void)eval(f);
 }
+
+TEST_F(EvaluatorTest, evalWithDetectedRensaCache)
+{
+    CoreField f(
+        "B....."
+        "RY...."
+        "RRYG.."
+        "BBYGG.");
+    // The same field except colors.
+    CoreField relabeled(
+        "G....."
+        "YR...."
+        "YYRB.."
+        "GGRBB.");
+
+    DetectedRensaCache cache;
+    double score = evalSimpleScore(f, nullptr);
+
+    EXPECT_EQ(score, evalSimpleScore(f, &cache));
+    EXPECT_EQ(0, cache.numHits());
+    EXPECT_EQ(1U, cache.size());
+
+    EXPECT_EQ(score, evalSimpleScore(f, &cache));
+    EXPECT_EQ(score, evalSimpleScore(relabeled, &cache));
+    EXPECT_EQ(2, cache.numHits());
+    EXPECT_EQ(1U, cache.size());
+}
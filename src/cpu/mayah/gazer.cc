@@ -7,6 +7,13 @@
 
 #include <glog/logging.h>
 
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "base/profiler.h"
 #include "core/algorithm/plan.h"
 #include "core/algorithm/rensa_detector.h"
 #include "core/field_checker.h"
@@ -142,17 +149,73 @@ string GazeResult::toRensaInfoString() const
 
 // ----------------------------------------------------------------------
 
+Gazer::Gazer(Executor* executor) :
+    executor_(executor)
+{
+}
+
+Gazer::~Gazer()
+{
+    setGazesInBackground(false);
+}
+
+void Gazer::setGazesInBackground(bool flag)
+{
+    if (flag == backgroundThread_.joinable())
+        return;
+
+    if (flag) {
+        shouldStop_ = false;
+        backgroundThread_ = thread([this]() { runBackgroundLoop(); });
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mu_);
+        shouldStop_ = true;
+        backgroundCancellationToken_.cancel();
+    }
+    condVar_.notify_all();
+    backgroundThread_.join();
+
+    // The last request might not be processed.
+    lock_guard<mutex> lock(mu_);
+    lastDoneRequestId_ = request_.id;
+}
+
+void Gazer::waitUntilBackgroundGazeIsDone()
+{
+    unique_lock<mutex> lock(mu_);
+    while (lastDoneRequestId_ < request_.id)
+        condVar_.wait(lock);
+}
+
+GazeResult Gazer::gazeResult() const
+{
+    lock_guard<mutex> lock(mu_);
+    return gazeResult_;
+}
+
 void Gazer::initialize(int frameIdGameWillBegin)
 {
+    lock_guard<mutex> lock(mu_);
     gazeResult_.reset(frameIdGameWillBegin, 72);
+    gazeResult_.setFeasibleRensaHandTree(RensaHandTree());
+    gazeResult_.setPossibleRensaHandTree(RensaHandTree());
+    // Drop the pending request, since it's for the previous game.
+    lastDoneRequestId_ = ++request_.id;
+    backgroundCancellationToken_.cancel();
 }
 
 void Gazer::gaze(int frameId, const CoreField& originalField, const KumipuyoSeq& kumipuyoSeq)
 {
+    PROFILE_SCOPE("Gazer::gaze");
     LOG(INFO) << "Gaze: \n" << originalField.toDebugString() << "\nSeq: " << kumipuyoSeq.toString();
 
+    cache_.nextGeneration();
+
     int numReachableSpaces = originalField.countConnectedPuyos(3, 12);
-    gazeResult_.reset(frameId, numReachableSpaces);
+    RensaHandTree feasibleTree;
 
     // FeasibleRensaHandTree.
     {
@@ -185,15 +248,69 @@ void Gazer::gaze(int frameId, const CoreField& originalField, const KumipuyoSeq&
         int maxDepth = std::min<int>(3, kumipuyoSeq.size());
         Plan::iterateAvailablePlansWithoutFiring(originalField, kumipuyoSeq, maxDepth, callback);
 
-        RensaHandTree tree = RensaHandTree(std::vector<RensaHandNode> { maker.makeNode() });
-        LOG(INFO) << "Feasible: " << endl << tree.toString();
-        gazeResult_.setFeasibleRensaHandTree(std::move(tree));
+        feasibleTree = RensaHandTree(std::vector<RensaHandNode> { maker.makeNode() });
+        LOG(INFO) << "Feasible: " << endl << feasibleTree.toString();
     }
 
     // PossibleRensaHandTree.
     // We'd like make the depth 3, but eval() gets really slow (2~3 ms each hand.)
-    RensaHandTree tree = RensaHandTree::makeTree(2, originalField, PuyoSet(), 0, kumipuyoSeq);
-    LOG(INFO) << "Possible:" << endl << tree.toString();
+    RensaHandTree possibleTree;
+    bool hasPossibleTree = cache_.get(2, originalField, 0, &possibleTree);
+    if (!hasPossibleTree && !backgroundThread_.joinable()) {
+        possibleTree = RensaHandTree::makeTree(2, originalField, PuyoSet(), 0, kumipuyoSeq, &cache_, executor_);
+        hasPossibleTree = true;
+    }
+
+    {
+        lock_guard<mutex> lock(mu_);
+        gazeResult_.reset(frameId, numReachableSpaces);
+        gazeResult_.setFeasibleRensaHandTree(std::move(feasibleTree));
+
+        ++request_.id;
+        // The tree being made in background is already stale.
+        backgroundCancellationToken_.cancel();
+        if (hasPossibleTree) {
+            LOG(INFO) << "Possible:" << endl << possibleTree.toString();
+            gazeResult_.setPossibleRensaHandTree(std::move(possibleTree));
+            lastDoneRequestId_ = request_.id;
+        } else {
+            request_.field = originalField;
+            request_.kumipuyoSeq = kumipuyoSeq;
+        }
+    }
+    condVar_.notify_all();
+}
 
-    gazeResult_.setPossibleRensaHandTree(std::move(tree));
+void Gazer::runBackgroundLoop()
+{
+#ifdef __linux__
+    // On linux, this changes the priority of this thread only.
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+#endif
+
+    unique_lock<mutex> lock(mu_);
+    while (true) {
+        while (!shouldStop_ && lastDoneRequestId_ == request_.id)
+            condVar_.wait(lock);
+        if (shouldStop_)
+            return;
+
+        Request request = request_;
+        CancellationToken cancellationToken = CancellationToken::create();
+        backgroundCancellationToken_ = cancellationToken;
+        lock.unlock();
+        RensaHandTree tree = RensaHandTree::makeTree(2, request.field, PuyoSet(), 0, request.kumipuyoSeq, &cache_,
+                                                     nullptr, cancellationToken);
+        lock.lock();
+
+        // When a newer request has come, the tree is already stale.
+        // A cancelled tree is also discarded, since it might lack some edges.
+        if (request.id != request_.id || cancellationToken.isCancelled())
+            continue;
+
+        LOG(INFO) << "Possible:" << endl << tree.toString();
+        gazeResult_.setPossibleRensaHandTree(std::move(tree));
+        lastDoneRequestId_ = request.id;
+        condVar_.notify_all();
+    }
 }
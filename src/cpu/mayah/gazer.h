@@ -1,16 +1,21 @@
 #ifndef CPU_MAYAH_GAZER_H_
 #define CPU_MAYAH_GAZER_H_
 
+#include <condition_variable>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "base/cancellation_token.h"
 #include "base/noncopyable.h"
 #include "core/client/ai/ai.h"
 #include "core/probability/puyo_set.h"
 
 #include "rensa_hand_tree.h"
 
+class Executor;
 class KumipuyoSeq;
 
 class GazeResult {
@@ -43,14 +48,53 @@ private:
     RensaHandTree possibleRensaHandTree_;
 };
 
+// Gazer keeps the possible rensa hand trees of the previous gazes in a cache, so that
+// only the subtrees that the enemy's new puyos affect are made again.
+//
+// When background gazing is enabled, the possible rensa hand tree is made in a low priority
+// thread, so gaze() doesn't compete with think() in the same frame. Until the tree is made,
+// the previous possible rensa hand tree is used. When a new gaze comes while the tree is
+// being made, making the stale tree is cancelled.
+//
+// When |executor| is given, the possible rensa hand tree is made in parallel with it,
+// unless it's made in background.
 class Gazer : noncopyable {
 public:
+    explicit Gazer(Executor* executor = nullptr);
+    ~Gazer();
+
     void initialize(int frameIdGameWillBegin);
     void gaze(int frameId, const CoreField&, const KumipuyoSeq&);
 
-    const GazeResult& gazeResult() const { return gazeResult_; }
+    void setGazesInBackground(bool flag);
+    // Waits until the possible rensa hand tree of the last gaze is made in background.
+    void waitUntilBackgroundGazeIsDone();
+
+    // Returns the copy of the current result, since the background thread might update it.
+    GazeResult gazeResult() const;
+
+    const RensaHandTreeCache& rensaHandTreeCache() const { return cache_; }
+
 private:
+    struct Request {
+        int id = 0;
+        CoreField field;
+        KumipuyoSeq kumipuyoSeq;
+    };
+
+    void runBackgroundLoop();
+
+    Executor* executor_;
+    RensaHandTreeCache cache_;
+
+    mutable std::mutex mu_;
+    std::condition_variable condVar_;
     GazeResult gazeResult_;
+    Request request_;
+    CancellationToken backgroundCancellationToken_;
+    int lastDoneRequestId_ = 0;
+    bool shouldStop_ = false;
+    std::thread backgroundThread_;
 };
 
 #endif // CPU_MAYAH_GAZER_H_
@@ -79,3 +79,40 @@ TEST_F(GazerTest, estimateMaxScoreUsingRensaIsOngoing)
     EXPECT_EQ(36840, gazeResult.estimateMaxScore(300, enemy)) << gazeResult.toRensaInfoString();
     EXPECT_EQ(36840, gazeResult.estimateMaxScore(400, enemy)) << gazeResult.toRensaInfoString();
 }
+
+TEST_F(GazerTest, reuseRensaHandTree)
+{
+    CoreField f(
+        "BRBG  "
+        "BBRBBB"
+        "RRYGGG");
+    KumipuyoSeq seq("BYRRGG");
+
+    gazer_->gaze(100, f, seq);
+    string expected = gazer_->gazeResult().possibleRensaHandTree().toString();
+    int numHits = gazer_->rensaHandTreeCache().numHits();
+
+    gazer_->gaze(120, f, seq);
+    EXPECT_EQ(numHits + 1, gazer_->rensaHandTreeCache().numHits());
+    EXPECT_EQ(expected, gazer_->gazeResult().possibleRensaHandTree().toString());
+    EXPECT_EQ(120, gazer_->gazeResult().frameIdToStartNextMove());
+}
+
+TEST_F(GazerTest, gazeInBackground)
+{
+    CoreField f(
+        "BRBG  "
+        "BBRBBB"
+        "RRYGGG");
+    KumipuyoSeq seq("BYRRGG");
+
+    Gazer expectedGazer;
+    expectedGazer.initialize(100);
+    expectedGazer.gaze(100, f, seq);
+
+    gazer_->setGazesInBackground(true);
+    gazer_->gaze(100, f, seq);
+    gazer_->waitUntilBackgroundGazeIsDone();
+
+    EXPECT_EQ(expectedGazer.gazeResult().toRensaInfoString(), gazer_->gazeResult().toRensaInfoString());
+}
@@ -2,6 +2,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 #include <gflags/gflags.h>
@@ -20,20 +22,72 @@
 DEFINE_string(feature, "feature.toml", "the path to feature parameter");
 DEFINE_string(decision_book, SRC_DIR "/cpu/mayah/decision.toml", "the path to decision book");
 DEFINE_string(pattern_book, SRC_DIR "/cpu/mayah/pattern.toml", "the path to pattern book");
+DEFINE_bool(gaze_in_background, false, "make the possible rensa hand tree of enemy in background");
+DEFINE_bool(ponder, false, "think the next hand in background while the enemy is moving");
 
 using namespace std;
 
+namespace {
+
+template<typename T>
+shared_ptr<const T> loadFromFile(const string& filename)
+{
+    shared_ptr<T> t = make_shared<T>();
+    if (!t->load(filename))
+        return shared_ptr<const T>();
+    return t;
+}
+
+// Returns the object loaded from |filename|. The object is loaded only once in a process,
+// and shared among the callers.
+template<typename T>
+shared_ptr<const T> loadSharedFromFile(const string& filename)
+{
+    static mutex mu;
+    static map<string, shared_ptr<const T>> loaded;
+
+    lock_guard<mutex> lock(mu);
+    auto it = loaded.find(filename);
+    if (it != loaded.end())
+        return it->second;
+
+    shared_ptr<const T> t = loadFromFile<T>(filename);
+    if (t)
+        loaded.emplace(filename, t);
+    return t;
+}
+
+shared_ptr<const EvaluationParameterMap> loadEvaluationParameterMap(bool shared)
+{
+    auto load = shared ? loadSharedFromFile<EvaluationParameterMap> : loadFromFile<EvaluationParameterMap>;
+    if (auto paramMap = load(FLAGS_feature))
+        return paramMap;
+
+    // When not found, we try to load from the source directory.
+    return load(string(SRC_DIR) + "/cpu/mayah/" + FLAGS_feature);
+}
+
+} // anonymous namespace
+
 MayahAI::MayahAI(int argc, char* argv[], Executor* executor) :
     AI(argc, argv, "mayah"),
-    executor_(executor)
+    evaluationParameterMap_(loadEvaluationParameterMap(true)),
+    decisionBook_(loadSharedFromFile<DecisionBook>(FLAGS_decision_book)),
+    patternBook_(loadSharedFromFile<PatternBook>(FLAGS_pattern_book)),
+    executor_(executor),
+    gazer_(executor)
 {
     // setBehaviorRethinkAfterOpponentRensa(true);
+    setBehaviorPonder(FLAGS_ponder);
+
+    if (!evaluationParameterMap_)
+        setOwnedEvaluationParameterMap(make_shared<EvaluationParameterMap>());
+    CHECK(decisionBook_);
+    CHECK(patternBook_);
 
-    loadEvaluationParameter();
-    CHECK(decisionBook_.load(FLAGS_decision_book));
-    CHECK(patternBook_.load(FLAGS_pattern_book));
+    gazer_.setGazesInBackground(FLAGS_gaze_in_background);
 
-    VLOG(1) << evaluationParameterMap_.toString();
+    VLOG(1) << evaluationParameterMap_->toString();
 
     google::FlushLogFiles(google::INFO);
 }
@@ -42,26 +96,51 @@ MayahAI::~MayahAI()
 {
 }
 
+DetectedRensaCache* MayahAI::detectedRensaCacheIfUsed() const
+{
+    return usesDetectedRensaCache_ ? &detectedRensaCache_ : nullptr;
+}
+
 bool MayahAI::saveEvaluationParameter() const
 {
-    return evaluationParameterMap_.save(FLAGS_feature);
+    return evaluationParameterMap_->save(FLAGS_feature);
 }
 
 bool MayahAI::loadEvaluationParameter()
 {
-    if (evaluationParameterMap_.load(FLAGS_feature))
-        return true;
+    // Don't use the shared one, since the file might be modified after it's loaded.
+    shared_ptr<const EvaluationParameterMap> paramMap = loadEvaluationParameterMap(false);
+    if (!paramMap)
+        return false;
+
+    evaluationParameterMap_ = std::move(paramMap);
+    ownedEvaluationParameterMap_.reset();
+    return true;
+}
 
-    // When not found, we try to load from the source directory.
-    std::string filename = string(SRC_DIR) + "/cpu/mayah/" + FLAGS_feature;
-    if (evaluationParameterMap_.load(filename))
-        return true;
+EvaluationParameterMap* MayahAI::mutableEvaluationParameterMap()
+{
+    if (!ownedEvaluationParameterMap_)
+        setOwnedEvaluationParameterMap(make_shared<EvaluationParameterMap>(*evaluationParameterMap_));
+    return ownedEvaluationParameterMap_.get();
+}
 
-    return false;
+void MayahAI::setOwnedEvaluationParameterMap(shared_ptr<EvaluationParameterMap> map)
+{
+    CHECK(map);
+    evaluationParameterMap_ = map;
+    ownedEvaluationParameterMap_ = std::move(map);
 }
 
 DropDecision MayahAI::think(int frameId, const CoreField& f, const KumipuyoSeq& kumipuyoSeq,
                             const PlayerState& me, const PlayerState& enemy, bool fast) const
+{
+    return thinkCancellable(frameId, f, kumipuyoSeq, me, enemy, fast, CancellationToken());
+}
+
+DropDecision MayahAI::thinkCancellable(int frameId, const CoreField& f, const KumipuyoSeq& kumipuyoSeq,
+                                       const PlayerState& me, const PlayerState& enemy, bool fast,
+                                       const CancellationToken& cancellationToken) const
 {
     int depth;
     int iteration;
@@ -73,7 +152,8 @@ DropDecision MayahAI::think(int frameId, const CoreField& f, const KumipuyoSeq&
         iteration = MayahAI::DEFAULT_NUM_ITERATION;
     }
 
-    ThoughtResult thoughtResult = thinkPlan(frameId, f, kumipuyoSeq, me, enemy, depth, iteration, fast);
+    ThoughtResult thoughtResult = thinkPlan(frameId, f, kumipuyoSeq, me, enemy, depth, iteration, fast,
+                                            nullptr, cancellationToken);
 
     const Plan& plan = thoughtResult.plan;
     if (plan.decisions().empty())
@@ -84,7 +164,8 @@ DropDecision MayahAI::think(int frameId, const CoreField& f, const KumipuyoSeq&
 ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& field, const KumipuyoSeq& kumipuyoSeq,
                                  const PlayerState& me, const PlayerState& enemy,
                                  int depth, int maxIteration, bool fast,
-                                 vector<Decision>* specifiedDecisions) const
+                                 vector<Decision>* specifiedDecisions,
+                                 const CancellationToken& cancellationToken) const
 {
     // TODO(mayah): Do we need field and kumipuyoSeq?
     // CHECK(field, me.field);
@@ -119,7 +200,7 @@ ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& field, const Kumi
     }
 
     if (usesDecisionBook_ && !enemy.hasZenkeshi) {
-        Decision d = decisionBook_.nextDecision(field, kumipuyoSeq);
+        Decision d = decisionBook_->nextDecision(field, kumipuyoSeq);
         if (d.isValid()) {
             CoreField cf(field);
             cf.dropKumipuyo(d, kumipuyoSeq.front());
@@ -133,6 +214,9 @@ ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& field, const Kumi
 
     const GazeResult& gazeResult = gazer_.gazeResult();
 
+    // The fields evaluated in the previous think are kept for this think.
+    detectedRensaCache_.nextGeneration();
+
     // Before evaling, check Book.
     const PreEvalResult preEvalResult = preEval(field);
 
@@ -227,6 +311,7 @@ ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& field, const Kumi
     DecisionPlanner<MidEvalResult> planner(executor_, evalMidEval, evalRefPlan);
     if (specifiedDecisions)
         planner.setSpecifiedDecisions(*specifiedDecisions);
+    planner.setCancellationToken(cancellationToken);
     planner.iterate(frameId, field, kumipuyoSeq, me, enemy, depth);
 
 
@@ -250,7 +335,7 @@ ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& field, const Kumi
 
 PreEvalResult MayahAI::preEval(const CoreField& currentField) const
 {
-    PreEvaluator preEvaluator(patternBook_);
+    PreEvaluator preEvaluator(*patternBook_);
     return preEvaluator.preEval(currentField);
 }
 
@@ -264,13 +349,13 @@ MidEvalResult MayahAI::midEval(const RefPlan& plan,
                                const GazeResult& gazeResult) const
 
 {
-    SimpleScoreCollector sc(evaluationParameterMap_);
-    Evaluator<SimpleScoreCollector> evaluator(patternBook_, &sc);
+    SimpleScoreCollector sc(*evaluationParameterMap_);
+    Evaluator<SimpleScoreCollector> evaluator(*patternBook_, &sc, detectedRensaCacheIfUsed());
 
     // MidEval always sets 'fast'.
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, preEvalResult, MidEvalResult(), true, usesRensaHandTree_, gazeResult);
 
-    MidEvaluator midEvaluator(patternBook_);
+    MidEvaluator midEvaluator(*patternBook_);
     const CollectedSimpleScore& simpleScore = sc.collectedScore();
     return midEvaluator.eval(plan, currentField, simpleScore.score(sc.collectedCoef()));
 }
@@ -284,8 +369,8 @@ EvalResult MayahAI::eval(const RefPlan& plan,
                          bool fast,
                          const GazeResult& gazeResult) const
 {
-    SimpleScoreCollector sc(evaluationParameterMap_);
-    Evaluator<SimpleScoreCollector> evaluator(patternBook_, &sc);
+    SimpleScoreCollector sc(*evaluationParameterMap_);
+    Evaluator<SimpleScoreCollector> evaluator(*patternBook_, &sc, detectedRensaCacheIfUsed());
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, preEvalResult, midEvalResult, fast, usesRensaHandTree_, gazeResult);
 
     const CollectedSimpleScore& simpleScore = sc.collectedScore();
@@ -303,8 +388,8 @@ CollectedFeatureCoefScore MayahAI::evalWithCollectingFeature(const RefPlan& plan
                                                              bool fast,
                                                              const GazeResult& gazeResult) const
 {
-    FeatureScoreCollector sc(evaluationParameterMap_);
-    Evaluator<FeatureScoreCollector> evaluator(patternBook_, &sc);
+    FeatureScoreCollector sc(*evaluationParameterMap_);
+    Evaluator<FeatureScoreCollector> evaluator(*patternBook_, &sc, detectedRensaCacheIfUsed());
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, preEvalResult, midEvalResult, fast, usesRensaHandTree_, gazeResult);
 
     return CollectedFeatureCoefScore(sc.collectedCoef(), sc.collectedScore());
@@ -440,6 +525,7 @@ std::string MayahAI::makeMessageFrom(int frameId, const KumipuyoSeq& kumipuyoSeq
 void MayahAI::onGameWillBegin(const FrameRequest& frameRequest)
 {
     gazer_.initialize(frameRequest.frameId);
+    detectedRensaCache_.clear();
 }
 
 void MayahAI::gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq& kumipuyoSeq)
@@ -449,5 +535,12 @@ void MayahAI::gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq&
 
 void DebuggableMayahAI::setEvaluationParameterMap(const EvaluationParameterMap& map)
 {
-    evaluationParameterMap_.loadValue(map.toTomlValue());
+    setOwnedEvaluationParameterMap(make_shared<EvaluationParameterMap>(map));
+}
+
+void DebuggableMayahAI::setEvaluationParameterMap(shared_ptr<const EvaluationParameterMap> map)
+{
+    CHECK(map);
+    evaluationParameterMap_ = std::move(map);
+    ownedEvaluationParameterMap_.reset();
 }
@@ -10,6 +10,7 @@
 #include "core/client/ai/ai.h"
 #include "core/pattern/decision_book.h"
 
+#include "detected_rensa_cache.h"
 #include "evaluation_parameter.h"
 #include "evaluator.h"
 #include "gazer.h"
@@ -47,6 +48,9 @@ public:
 
     DropDecision think(int frameId, const CoreField&, const KumipuyoSeq&,
                        const PlayerState& me, const PlayerState& enemy, bool fast) const override;
+    DropDecision thinkCancellable(int frameId, const CoreField&, const KumipuyoSeq&,
+                                  const PlayerState& me, const PlayerState& enemy, bool fast,
+                                  const CancellationToken&) const override;
 
     void gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq&) override;
 
@@ -54,10 +58,12 @@ public:
 
     // Use this directly in test. Otherwise, use via think.
     // When |specifiedDecisionsOnly| is specified, only that decision will be considered.
+    // When |cancellationToken| says to stop, the best plan found so far is returned.
     ThoughtResult thinkPlan(int frameId, const CoreField&, const KumipuyoSeq&,
                             const PlayerState& me, const PlayerState& enemy,
                             int depth, int maxIteration, bool fast = false,
-                            std::vector<Decision>* specifiedDecisions = nullptr) const;
+                            std::vector<Decision>* specifiedDecisions = nullptr,
+                            const CancellationToken& cancellationToken = CancellationToken()) const;
 
 protected:
     PreEvalResult preEval(const CoreField& currentField) const;
@@ -81,19 +87,35 @@ protected:
                                 bool saturated, bool fast,
                                 double thoughtTimeInSeconds) const;
 
+    // Returns nullptr if the detected rensa cache is not used.
+    DetectedRensaCache* detectedRensaCacheIfUsed() const;
+
     bool saveEvaluationParameter() const;
     bool loadEvaluationParameter();
 
-    EvaluationParameterMap evaluationParameterMap_;
-    DecisionBook decisionBook_;
-    PatternBook patternBook_;
+    // Copies the parameter map before returning it unless this AI already owns a private copy.
+    EvaluationParameterMap* mutableEvaluationParameterMap();
+    // Uses |map| as the private parameter map of this AI.
+    void setOwnedEvaluationParameterMap(std::shared_ptr<EvaluationParameterMap> map);
+
+    // These are immutable once loaded, and shared among the MayahAI instances.
+    // Use mutableEvaluationParameterMap() to modify the parameter map.
+    std::shared_ptr<const EvaluationParameterMap> evaluationParameterMap_;
+    std::shared_ptr<const DecisionBook> decisionBook_;
+    std::shared_ptr<const PatternBook> patternBook_;
+    // The private copy of the parameter map, which evaluationParameterMap_ points to.
+    // nullptr if evaluationParameterMap_ might be shared.
+    std::shared_ptr<EvaluationParameterMap> ownedEvaluationParameterMap_;
 
     bool usesDecisionBook_ = true;
     bool usesRensaHandTree_ = true;
+    bool usesDetectedRensaCache_ = true;
 
     Executor* executor_;
 
     Gazer gazer_;
+    // Shared among the think() calls in a game. This is thread-safe, so think() can modify it.
+    mutable DetectedRensaCache detectedRensaCache_;
 };
 
 class DebuggableMayahAI : public MayahAI {
@@ -121,13 +143,17 @@ public:
     using MayahAI::mutableEnemyPlayerState;
 
     const Gazer& gazer() const { return gazer_; }
+    const DetectedRensaCache& detectedRensaCache() const { return detectedRensaCache_; }
 
     void setUsesRensaHandTree(bool flag) { usesRensaHandTree_ = flag; }
+    void setUsesDetectedRensaCache(bool flag) { usesDetectedRensaCache_ = flag; }
 
-    void removeNontokopuyoParameter() { evaluationParameterMap_.removeNontokopuyoParameter(); }
+    void removeNontokopuyoParameter() { mutableEvaluationParameterMap()->removeNontokopuyoParameter(); }
 
-    const EvaluationParameterMap& evaluationParameterMap() const { return evaluationParameterMap_; }
+    const EvaluationParameterMap& evaluationParameterMap() const { return *evaluationParameterMap_; }
     void setEvaluationParameterMap(const EvaluationParameterMap&);
+    // |map| is shared without copying it.
+    void setEvaluationParameterMap(std::shared_ptr<const EvaluationParameterMap> map);
 };
 
 #endif // CPU_MAYAH_MAYAH_AI_H_
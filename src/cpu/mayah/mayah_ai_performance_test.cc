@@ -8,6 +8,7 @@
 #include "core/core_field.h"
 #include "core/frame_request.h"
 #include "core/kumipuyo_seq.h"
+#include "core/kumipuyo_seq_generator.h"
 #include "core/probability/puyo_set_probability.h"
 
 #include "mayah_ai.h"
@@ -236,6 +237,46 @@ TEST(MayahAIPerformanceTest, slow_pattern_from_real_6)
     runTest(MayahAI::DEFAULT_DEPTH, MayahAI::DEFAULT_NUM_ITERATION, cf, seq);
 }
 
+TEST(MayahAIPerformanceTest, cacheHitRate)
+{
+    // Plays one game with gazing its own field as the enemy field, and shows how the caches
+    // kept across think() and gaze() work.
+    int argc = 1;
+    char arg[] = "mayah";
+    char* argv[] = {arg, nullptr};
+
+    unique_ptr<Executor> executor(Executor::makeDefaultExecutor());
+    DebuggableMayahAI ai(argc, argv, executor.get());
+    FrameRequest req;
+    req.frameId = 1;
+    ai.onGameWillBegin(req);
+
+    const KumipuyoSeq seq = KumipuyoSeqGenerator::generateACPuyo2SequenceWithSeed(1);
+    CoreField field;
+    int hands = 0;
+    for (int frameId = 2; hands < 50; ++frameId, ++hands) {
+        KumipuyoSeq restSeq = seq.subsequence(hands, 2);
+        ai.gaze(frameId, field, restSeq);
+        DropDecision dropDecision = ai.think(frameId, field, restSeq, PlayerState(), PlayerState(), false);
+        if (!field.dropKumipuyo(dropDecision.decision(), restSeq.front()))
+            break;
+        if (field.simulate().score > 10000 || field.color(3, 12) != PuyoColor::EMPTY)
+            break;
+    }
+
+    const DetectedRensaCache& detectedRensaCache = ai.detectedRensaCache();
+    const RensaHandTreeCache& handTreeCache = ai.gazer().rensaHandTreeCache();
+    const RensaDetectorCache& detectorCache = handTreeCache.detectorCache();
+    cout << "hands: " << hands << endl;
+    cout << "DetectedRensaCache: hit rate = " << detectedRensaCache.hitRate()
+         << " size = " << detectedRensaCache.size() << " / " << DetectedRensaCache::DEFAULT_MAX_SIZE << endl;
+    cout << "RensaHandTreeCache: hit rate = "
+         << (static_cast<double>(handTreeCache.numHits()) / (handTreeCache.numHits() + handTreeCache.numMisses()))
+         << " size = " << handTreeCache.size() << " / " << RensaHandTreeCache::DEFAULT_MAX_SIZE << endl;
+    cout << "RensaDetectorCache: hit rate = " << detectorCache.hitRate()
+         << " size = " << detectorCache.size() << " / " << RensaDetectorCache::DEFAULT_MAX_SIZE << endl;
+}
+
 int main(int argc, char* argv[])
 {
     google::InitGoogleLogging(argv[0]);
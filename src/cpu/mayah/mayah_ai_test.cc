@@ -266,6 +266,32 @@ TEST(MayahAITest, DontCrash3)
     (void)ai->think(100, f, seq, me, enemy, false);
 }
 
+TEST(MayahAITest, shareEvaluationParameterMap)
+{
+    auto ai1 = makeAI();
+    auto ai2 = makeAI();
+
+    // The loaded parameter map is shared.
+    EXPECT_EQ(&ai1->evaluationParameterMap(), &ai2->evaluationParameterMap());
+
+    // Modifying the parameter map should not affect the other AI.
+    ai1->removeNontokopuyoParameter();
+    EXPECT_NE(&ai1->evaluationParameterMap(), &ai2->evaluationParameterMap());
+
+    // Once copied, the private copy is modified in place.
+    const EvaluationParameterMap* copied = &ai1->evaluationParameterMap();
+    ai1->removeNontokopuyoParameter();
+    EXPECT_EQ(copied, &ai1->evaluationParameterMap());
+
+    auto map = make_shared<const EvaluationParameterMap>(ai1->evaluationParameterMap());
+    ai2->setEvaluationParameterMap(map);
+    EXPECT_EQ(map.get(), &ai2->evaluationParameterMap());
+
+    // The given map is not modified, even if nobody else refers to it.
+    ai2->removeNontokopuyoParameter();
+    EXPECT_NE(map.get(), &ai2->evaluationParameterMap());
+}
+
 #if 0
 TEST(MayahAITest, setEvaluationParameter)
 {
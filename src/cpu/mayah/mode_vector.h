@@ -0,0 +1,59 @@
+#ifndef CPU_MAYAH_MODE_VECTOR_H_
+#define CPU_MAYAH_MODE_VECTOR_H_
+
+#include <x86intrin.h>
+
+#include <algorithm>
+
+#include "evaluation_mode.h"
+
+// ModeVector is an array of double indexed by EvaluationMode.
+// Since every feature affects all the modes, the values are padded to 8 doubles,
+// so that all the modes can be calculated at once with SIMD instructions.
+class alignas(16) ModeVector {
+public:
+    static const int SIZE = 8;
+    static_assert(NUM_EVALUATION_MODES <= SIZE, "ModeVector is too small");
+
+    ModeVector() : v_{} {}
+
+    double operator[](int i) const { return v_[i]; }
+    double& operator[](int i) { return v_[i]; }
+
+    double get(EvaluationMode mode) const { return v_[ordinal(mode)]; }
+    void set(EvaluationMode mode, double x) { v_[ordinal(mode)] = x; }
+
+    void fill(double x) { std::fill(v_, v_ + NUM_EVALUATION_MODES, x); }
+
+    // Adds |v| * |x| to each mode.
+    void addScaled(const ModeVector& v, double x)
+    {
+#if defined(__AVX__)
+        const __m256d xs = _mm256_set1_pd(x);
+        for (int i = 0; i < SIZE; i += 4) {
+            // ModeVector might be in std::vector, so 32-byte alignment is not guaranteed.
+            __m256d a = _mm256_loadu_pd(v_ + i);
+            __m256d b = _mm256_mul_pd(_mm256_loadu_pd(v.v_ + i), xs);
+            _mm256_storeu_pd(v_ + i, _mm256_add_pd(a, b));
+        }
+#else
+        const __m128d xs = _mm_set1_pd(x);
+        for (int i = 0; i < SIZE; i += 2) {
+            __m128d a = _mm_load_pd(v_ + i);
+            __m128d b = _mm_mul_pd(_mm_load_pd(v.v_ + i), xs);
+            _mm_store_pd(v_ + i, _mm_add_pd(a, b));
+        }
+#endif
+    }
+
+    friend bool operator==(const ModeVector& lhs, const ModeVector& rhs)
+    {
+        return std::equal(lhs.v_, lhs.v_ + NUM_EVALUATION_MODES, rhs.v_);
+    }
+    friend bool operator!=(const ModeVector& lhs, const ModeVector& rhs) { return !(lhs == rhs); }
+
+private:
+    double v_[SIZE];
+};
+
+#endif // CPU_MAYAH_MODE_VECTOR_H_
@@ -0,0 +1,44 @@
+#include "parameter_comparison.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "solver/endless.h"
+
+using namespace std;
+
+SequentialProbabilityRatioTest::SequentialProbabilityRatioTest(double delta, double alpha, double beta) :
+    llrPerWin_(log((0.5 + delta) / (0.5 - delta))),
+    upperBound_(log((1 - beta) / alpha)),
+    lowerBound_(log(beta / (1 - alpha)))
+{
+    CHECK(0 < delta && delta < 0.5) << delta;
+}
+
+SequentialProbabilityRatioTest::Decision SequentialProbabilityRatioTest::add(int resultA, int resultB)
+{
+    if (resultA > resultB)
+        ++numWinsA_;
+    else if (resultA < resultB)
+        ++numWinsB_;
+    return decision();
+}
+
+SequentialProbabilityRatioTest::Decision SequentialProbabilityRatioTest::decision() const
+{
+    double llr = logLikelihoodRatio();
+    if (llr >= upperBound_)
+        return Decision::A_IS_BETTER;
+    if (llr <= lowerBound_)
+        return Decision::B_IS_BETTER;
+    return Decision::UNDECIDED;
+}
+
+int compareMetric(const EndlessResult& result, const string& metric)
+{
+    if (metric == "score")
+        return result.score;
+    CHECK_EQ("rensa", metric) << "Unknown metric";
+    return result.score >= 10000 ? 1 : 0;
+}
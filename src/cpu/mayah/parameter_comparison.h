@@ -0,0 +1,38 @@
+#ifndef CPU_MAYAH_PARAMETER_COMPARISON_H_
+#define CPU_MAYAH_PARAMETER_COMPARISON_H_
+
+#include <string>
+
+struct EndlessResult;
+
+// SequentialProbabilityRatioTest compares two players A and B by the results of the games
+// played with the same seeds. For each seed, the one with the better result wins, and the seeds
+// where both have the same result are ignored. It tests whether A wins with probability
+// 0.5 + delta or 0.5 - delta, with the false positive rate |alpha| and the false negative rate |beta|.
+class SequentialProbabilityRatioTest {
+public:
+    enum class Decision { UNDECIDED, A_IS_BETTER, B_IS_BETTER };
+
+    SequentialProbabilityRatioTest(double delta, double alpha, double beta);
+
+    // Adds the results of one seed, and returns the decision so far.
+    Decision add(int resultA, int resultB);
+    Decision decision() const;
+
+    double logLikelihoodRatio() const { return (numWinsA_ - numWinsB_) * llrPerWin_; }
+    int numWinsA() const { return numWinsA_; }
+    int numWinsB() const { return numWinsB_; }
+
+private:
+    const double llrPerWin_;
+    const double upperBound_;
+    const double lowerBound_;
+    int numWinsA_ = 0;
+    int numWinsB_ = 0;
+};
+
+// Returns the value of |result| to compare by |metric|:
+// "rensa" (1 if the main rensa is fired, otherwise 0) or "score".
+int compareMetric(const EndlessResult& result, const std::string& metric);
+
+#endif // CPU_MAYAH_PARAMETER_COMPARISON_H_
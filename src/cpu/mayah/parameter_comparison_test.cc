@@ -0,0 +1,125 @@
+#include "parameter_comparison.h"
+
+#include <gtest/gtest.h>
+
+#include "solver/endless.h"
+
+using namespace std;
+
+typedef SequentialProbabilityRatioTest::Decision SPRTDecision;
+
+namespace {
+
+// With delta = 0.1 and alpha = beta = 0.05, one win changes the log likelihood ratio by
+// log(0.6 / 0.4) ~ 0.405, and the bounds are +-log(0.95 / 0.05) ~ +-2.944.
+// So 8 more wins than the other are necessary to decide.
+SequentialProbabilityRatioTest makeTest()
+{
+    return SequentialProbabilityRatioTest(0.1, 0.05, 0.05);
+}
+
+EndlessResult makeResult(int score)
+{
+    EndlessResult result;
+    result.hand = 50;
+    result.score = score;
+    result.maxRensa = 0;
+    result.zenkeshi = false;
+    result.type = EndlessResult::Type::MAIN_CHAIN;
+    return result;
+}
+
+} // namespace anonymous
+
+TEST(SequentialProbabilityRatioTestTest, aIsBetter)
+{
+    SequentialProbabilityRatioTest sprt = makeTest();
+    EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.decision());
+
+    for (int i = 0; i < 7; ++i)
+        EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(1, 0)) << i;
+    EXPECT_EQ(SPRTDecision::A_IS_BETTER, sprt.add(1, 0));
+    EXPECT_EQ(8, sprt.numWinsA());
+    EXPECT_EQ(0, sprt.numWinsB());
+}
+
+TEST(SequentialProbabilityRatioTestTest, bIsBetter)
+{
+    SequentialProbabilityRatioTest sprt = makeTest();
+    for (int i = 0; i < 7; ++i)
+        EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(30000, 50000)) << i;
+    EXPECT_EQ(SPRTDecision::B_IS_BETTER, sprt.add(30000, 50000));
+    EXPECT_EQ(0, sprt.numWinsA());
+    EXPECT_EQ(8, sprt.numWinsB());
+}
+
+TEST(SequentialProbabilityRatioTestTest, noSignificantDifference)
+{
+    // A and B win by turns, and the other seeds are draws.
+    SequentialProbabilityRatioTest sprt = makeTest();
+    for (int i = 0; i < 1000; ++i) {
+        switch (i % 3) {
+        case 0: EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(1, 0)) << i; break;
+        case 1: EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(0, 1)) << i; break;
+        case 2: EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(1, 1)) << i; break;
+        }
+    }
+    EXPECT_EQ(334, sprt.numWinsA());
+    EXPECT_EQ(333, sprt.numWinsB());
+}
+
+TEST(SequentialProbabilityRatioTestTest, drawsAreIgnored)
+{
+    SequentialProbabilityRatioTest sprt = makeTest();
+    for (int i = 0; i < 7; ++i)
+        sprt.add(1, 0);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(0, 0)) << i;
+    EXPECT_EQ(SPRTDecision::A_IS_BETTER, sprt.add(1, 0));
+}
+
+TEST(SequentialProbabilityRatioTestTest, decidedByWinningRate)
+{
+    // A wins 7 of every 10 decided seeds, which is clearly more than 0.5 + delta.
+    SequentialProbabilityRatioTest sprtA = makeTest();
+    // B wins 7 of every 10 decided seeds.
+    SequentialProbabilityRatioTest sprtB = makeTest();
+
+    SPRTDecision decisionA = SPRTDecision::UNDECIDED;
+    SPRTDecision decisionB = SPRTDecision::UNDECIDED;
+    for (int i = 0; i < 100 && (decisionA == SPRTDecision::UNDECIDED || decisionB == SPRTDecision::UNDECIDED); ++i) {
+        bool aWins = i % 10 < 7;
+        decisionA = sprtA.add(aWins ? 1 : 0, aWins ? 0 : 1);
+        decisionB = sprtB.add(aWins ? 0 : 1, aWins ? 1 : 0);
+    }
+
+    EXPECT_EQ(SPRTDecision::A_IS_BETTER, decisionA);
+    EXPECT_EQ(SPRTDecision::B_IS_BETTER, decisionB);
+}
+
+TEST(ParameterComparisonTest, compareMetric)
+{
+    EXPECT_EQ(0, compareMetric(makeResult(9999), "rensa"));
+    EXPECT_EQ(1, compareMetric(makeResult(10000), "rensa"));
+    EXPECT_EQ(1, compareMetric(makeResult(80000), "rensa"));
+
+    EXPECT_EQ(9999, compareMetric(makeResult(9999), "score"));
+    EXPECT_EQ(80000, compareMetric(makeResult(80000), "score"));
+}
+
+TEST(ParameterComparisonTest, compareMetricDecidesWithRensa)
+{
+    // With the "rensa" metric, the scores above the main rensa threshold are draws.
+    SequentialProbabilityRatioTest sprt = makeTest();
+    for (int i = 0; i < 100; ++i) {
+        int a = compareMetric(makeResult(80000), "rensa");
+        int b = compareMetric(makeResult(50000), "rensa");
+        EXPECT_EQ(SPRTDecision::UNDECIDED, sprt.add(a, b)) << i;
+    }
+
+    SPRTDecision decision = SPRTDecision::UNDECIDED;
+    for (int i = 0; i < 100 && decision == SPRTDecision::UNDECIDED; ++i)
+        decision = sprt.add(compareMetric(makeResult(5000), "rensa"), compareMetric(makeResult(50000), "rensa"));
+    EXPECT_EQ(SPRTDecision::B_IS_BETTER, decision);
+    EXPECT_EQ(8, sprt.numWinsB());
+}
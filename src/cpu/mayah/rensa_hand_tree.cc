@@ -3,6 +3,8 @@
 #include <iostream>
 #include <sstream>
 
+#include "base/executor.h"
+#include "base/wait_group.h"
 #include "core/algorithm/rensa_detector.h"
 #include "core/core_field.h"
 #include "core/frame.h"
@@ -64,25 +66,99 @@ RensaHandTree RensaHandTree::makeTree(int restIteration,
                                       const CoreField& currentField,
                                       const PuyoSet& usedPuyoSet,
                                       int usedPuyoMoveFrames,
-                                      const KumipuyoSeq& wholeKumipuyoSeq)
+                                      const KumipuyoSeq& wholeKumipuyoSeq,
+                                      RensaHandTreeCache* cache,
+                                      Executor* executor,
+                                      const CancellationToken& cancellationToken)
 {
-    if (restIteration <= 0)
+    if (restIteration <= 0 || cancellationToken.shouldStop())
         return RensaHandTree();
 
-    vector<RensaHandNode> nodes(6);
-    for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
+    RensaHandTree cachedTree;
+    if (cache && cache->get(restIteration, currentField, usedPuyoMoveFrames, &cachedTree))
+        return cachedTree;
+
+    vector<RensaHandNodeMaker> makers;
+    makers.reserve(6);
+    for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines)
+        makers.emplace_back(restIteration, wholeKumipuyoSeq, cache, cancellationToken);
+
+    auto detect = [&](int ojamaLines) {
         CoreField field(currentField);
         const int dropFrames = field.fallOjama(ojamaLines);
 
-        RensaHandNodeMaker maker(restIteration, wholeKumipuyoSeq);
+        RensaHandNodeMaker& maker = makers[ojamaLines];
+        if (cache) {
+            auto callback = [&](CoreField&& fieldAfterRensa, const ColumnPuyoList& puyosToComplement,
+                                const RensaResult& rensaResult, const RensaCoefResult& coefResult) {
+                maker.add(std::move(fieldAfterRensa), puyosToComplement, usedPuyoMoveFrames + dropFrames, usedPuyoSet,
+                          rensaResult, coefResult);
+            };
+            RensaDetector::detectIterativelyWithCache(field, RensaDetectorStrategy::defaultDropStrategy(), 3,
+                                                      cache->mutableDetectorCache(), callback, cancellationToken);
+            return;
+        }
+
         auto callback = [&](CoreField&& cf, const ColumnPuyoList& puyosToComplement) -> RensaResult {
             return maker.add(std::move(cf), puyosToComplement, usedPuyoMoveFrames + dropFrames, usedPuyoSet);
         };
-        RensaDetector::detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 3, callback);
-        nodes[ojamaLines] = maker.makeNode();
+        RensaDetector::detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 3, callback, cancellationToken);
+    };
+
+    vector<RensaHandNode> nodes(6);
+    if (!executor) {
+        for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
+            detect(ojamaLines);
+            nodes[ojamaLines] = makers[ojamaLines].makeNode();
+        }
+    } else {
+        WaitGroup wg;
+        wg.add(6);
+        for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
+            executor->submit([&detect, &wg, ojamaLines]() {
+                detect(ojamaLines);
+                wg.done();
+            });
+        }
+        wg.waitUntilDone();
+
+        // Then, make all the subtrees in parallel. Each subtree is stored at the fixed position,
+        // so the order of edges doesn't depend on the order of task completion.
+        vector<vector<const RensaHandCandidate*>> candidates(6);
+        vector<vector<RensaHandTree>> subtrees(6);
+        for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
+            candidates[ojamaLines] = makers[ojamaLines].selectCandidates();
+            subtrees[ojamaLines].resize(candidates[ojamaLines].size());
+            for (size_t i = 0; i < candidates[ojamaLines].size(); ++i) {
+                const RensaHandCandidate* info = candidates[ojamaLines][i];
+                RensaHandTree* subtree = &subtrees[ojamaLines][i];
+                wg.add(1);
+                executor->submit([&, info, subtree]() {
+                    *subtree = makeTree(restIteration - 1, info->fieldAfterRensa, info->alreadyUsedPuyoSet,
+                                        info->alreadyConsumedFramesToMovePuyo, wholeKumipuyoSeq, cache,
+                                        nullptr, cancellationToken);
+                    wg.done();
+                });
+            }
+        }
+        wg.waitUntilDone();
+
+        for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
+            vector<RensaHandEdge> edges;
+            for (size_t i = 0; i < candidates[ojamaLines].size(); ++i) {
+                const RensaHandCandidate* info = candidates[ojamaLines][i];
+                edges.emplace_back(RensaHand(info->ignitionRensaResult, info->coefResult),
+                                   std::move(subtrees[ojamaLines][i]));
+            }
+            nodes[ojamaLines] = RensaHandNode(std::move(edges));
+        }
     }
 
-    return RensaHandTree(std::move(nodes));
+    RensaHandTree tree(std::move(nodes));
+    // A cancelled tree might lack some edges, so it must not be reused.
+    if (cache && !cancellationToken.shouldStop())
+        cache->put(restIteration, currentField, usedPuyoMoveFrames, tree);
+    return tree;
 }
 
 // static
@@ -320,9 +396,34 @@ int RensaHandTree::eval(const RensaHandTree& myTree,
     return 0;
 }
 
-RensaHandNodeMaker::RensaHandNodeMaker(int restIteration, const KumipuyoSeq& kumipuyoSeq) :
+bool RensaHandTreeCache::get(int restIteration, const CoreField& field, int usedPuyoMoveFrames, RensaHandTree* tree)
+{
+    return cache_.get(Key(restIteration, field, usedPuyoMoveFrames), tree);
+}
+
+void RensaHandTreeCache::put(int restIteration, const CoreField& field, int usedPuyoMoveFrames, const RensaHandTree& tree)
+{
+    cache_.put(Key(restIteration, field, usedPuyoMoveFrames), tree);
+}
+
+void RensaHandTreeCache::nextGeneration()
+{
+    cache_.nextGeneration();
+    detectorCache_.nextGeneration();
+}
+
+void RensaHandTreeCache::clear()
+{
+    cache_.clear();
+    detectorCache_.clear();
+}
+
+RensaHandNodeMaker::RensaHandNodeMaker(int restIteration, const KumipuyoSeq& kumipuyoSeq,
+                                       RensaHandTreeCache* cache, const CancellationToken& cancellationToken) :
     restIteration_(restIteration),
-    kumipuyoSeq_(kumipuyoSeq)
+    kumipuyoSeq_(kumipuyoSeq),
+    cache_(cache),
+    cancellationToken_(cancellationToken)
 {
 }
 
@@ -337,10 +438,20 @@ RensaResult RensaHandNodeMaker::add(CoreField&& cf,
 {
     RensaCoefTracker tracker;
     RensaResult rensaResult = cf.simulate(&tracker);
+    add(std::move(cf), puyosToComplement, usedFramesToMovePuyo, usedPuyoSet, rensaResult, tracker.result());
+    return rensaResult;
+}
 
+void RensaHandNodeMaker::add(CoreField&& fieldAfterRensa,
+                             const ColumnPuyoList& puyosToComplement,
+                             int usedFramesToMovePuyo,
+                             const PuyoSet& usedPuyoSet,
+                             const RensaResult& rensaResult,
+                             const RensaCoefResult& coefResult)
+{
     // skip.
     if (rensaResult.score < 70)
-        return rensaResult;
+        return;
 
     PuyoSet wholeUsedPuyoSet(usedPuyoSet);
     wholeUsedPuyoSet.add(puyosToComplement);
@@ -355,31 +466,41 @@ RensaResult RensaHandNodeMaker::add(CoreField&& cf,
     if (framesToIgnite < 0)
         framesToIgnite = 0;
     data_.emplace_back(IgnitionRensaResult(rensaResult, framesToIgnite, NUM_FRAMES_OF_ONE_HAND),
-                       tracker.result(), cf, wholeUsedPuyoSet, wholeFramesToIgnite);
-
-    return rensaResult;
+                       coefResult, fieldAfterRensa, wholeUsedPuyoSet, wholeFramesToIgnite);
 }
 
-RensaHandNode RensaHandNodeMaker::makeNode()
+vector<const RensaHandCandidate*> RensaHandNodeMaker::selectCandidates()
 {
-    if (data_.empty())
-        return RensaHandNode();
-
     sort(data_.begin(), data_.end(), SortByTotalFrames());
 
-    vector<RensaHandEdge> edges;
+    vector<const RensaHandCandidate*> selected;
     for (const RensaHandCandidate& info : data_) {
         // Don't consider if chain side is too close.
-        if (!edges.empty() && info.score() <= edges.back().rensaHand().score() + 140)
+        if (!selected.empty() && info.score() <= selected.back()->score() + 140)
             continue;
 
-        DCHECK(edges.empty() || edges.back().rensaHand().totalFrames() < info.totalFrames());
-        edges.emplace_back(RensaHand(info.ignitionRensaResult, info.coefResult),
+        DCHECK(selected.empty() || selected.back()->totalFrames() < info.totalFrames());
+        selected.push_back(&info);
+    }
+    return selected;
+}
+
+RensaHandNode RensaHandNodeMaker::makeNode()
+{
+    if (data_.empty())
+        return RensaHandNode();
+
+    vector<RensaHandEdge> edges;
+    for (const RensaHandCandidate* info : selectCandidates()) {
+        edges.emplace_back(RensaHand(info->ignitionRensaResult, info->coefResult),
                            RensaHandTree::makeTree(restIteration() - 1,
-                                                   info.fieldAfterRensa,
-                                                   info.alreadyUsedPuyoSet,
-                                                   info.alreadyConsumedFramesToMovePuyo,
-                                                   kumipuyoSeq_));
+                                                   info->fieldAfterRensa,
+                                                   info->alreadyUsedPuyoSet,
+                                                   info->alreadyConsumedFramesToMovePuyo,
+                                                   kumipuyoSeq_,
+                                                   cache_,
+                                                   nullptr,
+                                                   cancellationToken_));
     }
     return RensaHandNode(std::move(edges));
 }
@@ -5,6 +5,10 @@
 #include <string>
 #include <vector>
 
+#include "base/cancellation_token.h"
+#include "base/generation_cache.h"
+#include "base/noncopyable.h"
+#include "core/algorithm/rensa_detector_cache.h"
 #include "core/core_field.h"
 #include "core/frame.h"
 #include "core/kumipuyo_seq.h"
@@ -14,12 +18,14 @@
 
 class ColumnPuyoList;
 class CoreField;
+class Executor;
 class KumipuyoSeq;
 class PuyoSet;
 
 class RensaHandEdge;
 class RensaHandNode;
 class RensaHandTree;
+class RensaHandTreeCache;
 
 // These values are arbitrary chosen.
 const int NUM_FRAMES_OF_ONE_HAND = FRAMES_TO_DROP_FAST[8] + FRAMES_GROUNDING + FRAMES_PREPARING_NEXT;
@@ -53,11 +59,21 @@ public:
     explicit RensaHandTree(std::vector<RensaHandNode> nodes) :
         nodes_(std::move(nodes)) {}
 
+    // When |cache| is not null, the subtrees are looked up from |cache| first,
+    // and the newly made subtrees are stored into it.
+    // When |executor| is not null, the nodes for each ojama lines and their subtrees are
+    // made in parallel. The result is the same as the one made without |executor|.
+    // Don't call this with |executor| from a task running on the same |executor|.
+    // When |cancellationToken| says to stop, this returns a partial tree as soon as possible.
+    // The partial tree is not stored into |cache|, and should be discarded.
     static RensaHandTree makeTree(int restIteration,
                                   const CoreField& currentField,
                                   const PuyoSet& usedPuyoSet,
                                   int usedPuyoMoveFrames,
-                                  const KumipuyoSeq& wholeKumipuyoSeq);
+                                  const KumipuyoSeq& wholeKumipuyoSeq,
+                                  RensaHandTreeCache* cache = nullptr,
+                                  Executor* executor = nullptr,
+                                  const CancellationToken& cancellationToken = CancellationToken());
 
     static int eval(const RensaHandTree& myTree,
                     int myStartingFrameId,
@@ -111,6 +127,65 @@ private:
     std::vector<RensaHandEdge> edges_;
 };
 
+// RensaHandTreeCache caches the trees made by RensaHandTree::makeTree().
+// The tree depends only on the field, the rest iteration, and the used frames
+// (the used puyo set and the kumipuyo seq don't affect the result), so they are used as the key.
+// Since the enemy field changes only a little between gazes, the subtrees after firing
+// rensa often appear again, and only the branches affected by the new puyos need to be made.
+// This class is thread-safe.
+class RensaHandTreeCache : noncopyable {
+public:
+    static const size_t DEFAULT_MAX_SIZE = 1 << 14;
+
+    explicit RensaHandTreeCache(size_t maxSize = DEFAULT_MAX_SIZE) : cache_(maxSize) {}
+
+    // Returns true and copies the tree to |tree| if the tree is cached.
+    bool get(int restIteration, const CoreField&, int usedPuyoMoveFrames, RensaHandTree* tree);
+    // When the cache is full, the old entries are evicted. See GenerationCache::put().
+    void put(int restIteration, const CoreField&, int usedPuyoMoveFrames, const RensaHandTree& tree);
+
+    // Starts a new generation. See GenerationCache::nextGeneration().
+    // The detector cache is also moved to a new generation.
+    void nextGeneration();
+    void clear();
+
+    size_t size() const { return cache_.size(); }
+    int numHits() const { return cache_.numHits(); }
+    int numMisses() const { return cache_.numMisses(); }
+
+    // The rensas detected while making the trees are memoized here. The same field often appears
+    // in several trees (e.g. with different usedPuyoMoveFrames), so this hits even when the tree doesn't.
+    RensaDetectorCache* mutableDetectorCache() { return &detectorCache_; }
+    const RensaDetectorCache& detectorCache() const { return detectorCache_; }
+
+private:
+    struct Key {
+        Key(int restIteration, const CoreField& field, int usedPuyoMoveFrames) :
+            restIteration(restIteration), field(field), usedPuyoMoveFrames(usedPuyoMoveFrames) {}
+
+        friend bool operator==(const Key& lhs, const Key& rhs)
+        {
+            return lhs.restIteration == rhs.restIteration &&
+                lhs.usedPuyoMoveFrames == rhs.usedPuyoMoveFrames &&
+                lhs.field == rhs.field;
+        }
+
+        int restIteration;
+        CoreField field;
+        int usedPuyoMoveFrames;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const
+        {
+            return key.field.hash() * 31 + key.usedPuyoMoveFrames * 7 + key.restIteration;
+        }
+    };
+
+    GenerationCache<Key, RensaHandTree, KeyHash> cache_;
+    RensaDetectorCache detectorCache_;
+};
+
 // ----------------------------------------------------------------------
 
 struct RensaHandCandidate {
@@ -146,7 +221,8 @@ struct RensaHandCandidate {
 
 class RensaHandNodeMaker {
 public:
-    RensaHandNodeMaker(int restIteration, const KumipuyoSeq& kumipuyoSeq);
+    RensaHandNodeMaker(int restIteration, const KumipuyoSeq& kumipuyoSeq, RensaHandTreeCache* cache = nullptr,
+                       const CancellationToken& cancellationToken = CancellationToken());
     ~RensaHandNodeMaker();
 
     int restIteration() const { return restIteration_; }
@@ -155,13 +231,27 @@ public:
                     const ColumnPuyoList& puyosToComplement,
                     int usedPuyoMoveFrames,
                     const PuyoSet& usedPuyoSet);
+    // Same as above, but the complemented field has already been simulated.
+    // |fieldAfterRensa| is the field after the rensa, and |rensaResult| and |coefResult| are
+    // the results of the simulation.
+    void add(CoreField&& fieldAfterRensa,
+             const ColumnPuyoList& puyosToComplement,
+             int usedPuyoMoveFrames,
+             const PuyoSet& usedPuyoSet,
+             const RensaResult& rensaResult,
+             const RensaCoefResult& coefResult);
     void addCandidate(const RensaHandCandidate& candidate) { data_.push_back(candidate); }
 
     RensaHandNode makeNode();
 
+    // Sorts the added candidates, and returns the ones that makeNode() will make edges from.
+    std::vector<const RensaHandCandidate*> selectCandidates();
+
 private:
     const int restIteration_;
     const KumipuyoSeq kumipuyoSeq_;
+    RensaHandTreeCache* cache_;
+    const CancellationToken cancellationToken_;
     std::vector<RensaHandCandidate> data_;
 };
 
@@ -5,6 +5,7 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "base/executor.h"
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
 #include "core/probability/puyo_set_probability.h"
@@ -51,6 +52,29 @@ TEST(RensaHandTreePerformanceTest, pattern1_depth2)
     }
 }
 
+TEST(RensaHandTreePerformanceTest, pattern1_depth2_parallel)
+{
+    CoreField cf(
+        "    RB"
+        " B GGG"
+        "GG YBR"
+        "YG YGR"
+        "GBYBGR"
+        "BBYYBG"
+        "GYBGRG"
+        "GGYGGR"
+        "YYBBBR");
+    KumipuyoSeq seq("RBRGRYYG");
+
+    Executor executor(4);
+    executor.start();
+
+    for (int i = 0; i < 100; ++i) {
+        RensaHandTree tree = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, nullptr, &executor);
+        UNUSED_VARIABLE(tree);
+    }
+}
+
 TEST(RensaHandTreePerformanceTest, pattern1_depth3)
 {
     CoreField cf(
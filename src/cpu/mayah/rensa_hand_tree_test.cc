@@ -5,6 +5,7 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "base/executor.h"
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
 #include "core/probability/puyo_set_probability.h"
@@ -143,3 +144,76 @@ TEST(RensaHandTreeTest, eval_actual2)
 
     EXPECT_LT(0, s) << endl;
 }
+
+TEST(RensaHandTreeTest, makeTreeWithCache)
+{
+    CoreField cf(
+        "BRBG  "
+        "BBRBBB"
+        "RRYGGG");
+    KumipuyoSeq seq("BYRRGG");
+
+    RensaHandTreeCache cache;
+    RensaHandTree expected = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq);
+    RensaHandTree tree1 = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, &cache);
+    EXPECT_EQ(expected.toString(), tree1.toString());
+    EXPECT_LT(0U, cache.size());
+
+    // The whole tree should be found in the cache.
+    int numHits = cache.numHits();
+    int numMisses = cache.numMisses();
+    RensaHandTree tree2 = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, &cache);
+    EXPECT_EQ(expected.toString(), tree2.toString());
+    EXPECT_EQ(numHits + 1, cache.numHits());
+    EXPECT_EQ(numMisses, cache.numMisses());
+
+    // Entries not used in the previous generation are removed.
+    cache.nextGeneration();
+    EXPECT_LT(0U, cache.size());
+    cache.nextGeneration();
+    EXPECT_EQ(0U, cache.size());
+}
+
+TEST(RensaHandTreeTest, makeTreeWithExecutor)
+{
+    CoreField cf(
+        "    RB"
+        " B GGG"
+        "GG YBR"
+        "YG YGR"
+        "GBYBGR"
+        "BBYYBG"
+        "GYBGRG"
+        "GGYGGR"
+        "YYBBBR");
+    KumipuyoSeq seq("RBRGRYYG");
+
+    Executor executor(4);
+    executor.start();
+
+    RensaHandTree expected = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq);
+    RensaHandTree actual = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, nullptr, &executor);
+    EXPECT_EQ(expected.toString(), actual.toString());
+
+    RensaHandTreeCache cache;
+    RensaHandTree cached = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, &cache, &executor);
+    EXPECT_EQ(expected.toString(), cached.toString());
+}
+
+TEST(RensaHandTreeTest, makeTreeCancelled)
+{
+    CoreField cf(
+        "BRBG  "
+        "BBRBBB"
+        "RRYGGG");
+    KumipuyoSeq seq("BYRRGG");
+
+    CancellationToken token = CancellationToken::create();
+    token.cancel();
+
+    // A cancelled tree is not stored into the cache.
+    RensaHandTreeCache cache;
+    RensaHandTree tree = RensaHandTree::makeTree(2, cf, PuyoSet(), 0, seq, &cache, nullptr, token);
+    EXPECT_TRUE(tree.nodes().empty());
+    EXPECT_EQ(0U, cache.size());
+}
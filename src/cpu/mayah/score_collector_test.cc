@@ -16,3 +16,17 @@ TEST(ScoreCollectorTest, score)
     EXPECT_EQ(50.0, collector.collectedScore().score(EvaluationMode::EARLY));
     EXPECT_EQ(30.0, collector.collectedScore().score(EvaluationMode::MIDDLE));
 }
+
+TEST(ScoreCollectorTest, sparseScore)
+{
+    EvaluationParameterMap m;
+    m.mutableMoveParamSet()->setDefault(VALLEY_DEPTH, 2, 3.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::EARLY, VALLEY_DEPTH, 2, 5.0);
+
+    SimpleScoreCollector collector(m);
+    collector.addScore(VALLEY_DEPTH, 2, 2);
+    collector.addScore(VALLEY_DEPTH, 1);
+
+    EXPECT_EQ(10.0, collector.collectedScore().score(EvaluationMode::EARLY));
+    EXPECT_EQ(6.0, collector.collectedScore().score(EvaluationMode::MIDDLE));
+}
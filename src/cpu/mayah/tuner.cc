@@ -0,0 +1,254 @@
+#include "tuner.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+
+#include <glog/logging.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "base/file.h"
+#include "base/strings.h"
+
+#include "evaluation_parameter.h"
+
+using namespace std;
+
+string TuneJobQueue::candidatePath(int iteration, int candidate) const
+{
+    return file::joinPath(dir_, "candidate-" + to_string(iteration) + "-" + to_string(candidate) + ".toml");
+}
+
+string TuneJobQueue::seedsPath(int iteration) const
+{
+    return file::joinPath(dir_, "seeds-" + to_string(iteration));
+}
+
+void TuneJobQueue::publish(int iteration, const vector<shared_ptr<const EvaluationParameterMap>>& candidates,
+                           const vector<int>& seeds)
+{
+    lock_guard<mutex> lock(mu_);
+    iteration_ = iteration;
+    candidates_ = candidates;
+    seeds_ = seeds;
+    scores_.assign(candidates.size(), vector<int>(seeds.size()));
+    numResults_ = 0;
+
+    jobs_.clear();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        for (size_t j = 0; j < seeds.size(); ++j)
+            jobs_.push_back(TuneJob { iteration, static_cast<int>(i), static_cast<int>(j) });
+    }
+
+    if (dir_.empty())
+        return;
+
+    // The stop file of the previous run might be left.
+    remove(file::joinPath(dir_, "stop").c_str());
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+        CHECK(candidates[i]->save(candidatePath(iteration, i)));
+    {
+        ofstream ofs(seedsPath(iteration));
+        for (int seed : seeds)
+            ofs << seed << endl;
+    }
+    // Job files should be created after the candidates and the seeds are ready.
+    for (const TuneJob& job : jobs_)
+        ofstream(file::joinPath(dir_, "job-" + jobName(job)));
+    jobs_.clear();
+}
+
+bool TuneJobQueue::take(TuneJob* job, shared_ptr<const EvaluationParameterMap>* paramMap, int* seed)
+{
+    if (dir_.empty()) {
+        lock_guard<mutex> lock(mu_);
+        if (jobs_.empty())
+            return false;
+        *job = jobs_.front();
+        jobs_.pop_front();
+        *paramMap = candidates_[job->candidate];
+        *seed = seeds_[job->seedIndex];
+        return true;
+    }
+
+    vector<string> files;
+    if (!file::listFiles(dir_, &files))
+        return false;
+
+    for (const string& name : files) {
+        if (!strings::hasPrefix(name, "job-"))
+            continue;
+        vector<string> ids = strings::split(name.substr(4), '-');
+        if (ids.size() != 3)
+            continue;
+
+        string runningName = "running-" + name.substr(4) + "-" + to_string(getpid());
+        if (rename(file::joinPath(dir_, name).c_str(), file::joinPath(dir_, runningName).c_str()) < 0)
+            continue;  // Another worker took it.
+
+        *job = TuneJob { stoi(ids[0]), stoi(ids[1]), stoi(ids[2]) };
+
+        lock_guard<mutex> lock(mu_);
+        if (iteration_ != job->iteration) {
+            // This process is a worker. Load the candidates of the new iteration.
+            iteration_ = job->iteration;
+            candidates_.clear();
+            seeds_.clear();
+            ifstream ifs(seedsPath(job->iteration));
+            int s;
+            while (ifs >> s)
+                seeds_.push_back(s);
+        }
+        if (candidates_.size() <= static_cast<size_t>(job->candidate))
+            candidates_.resize(job->candidate + 1);
+        if (!candidates_[job->candidate]) {
+            shared_ptr<EvaluationParameterMap> candidate = make_shared<EvaluationParameterMap>();
+            CHECK(candidate->load(candidatePath(job->iteration, job->candidate)));
+            candidates_[job->candidate] = candidate;
+        }
+        *paramMap = candidates_[job->candidate];
+        *seed = seeds_[job->seedIndex];
+        return true;
+    }
+
+    return false;
+}
+
+void TuneJobQueue::putResult(const TuneJob& job, int score)
+{
+    if (dir_.empty()) {
+        lock_guard<mutex> lock(mu_);
+        scores_[job.candidate][job.seedIndex] = score;
+        ++numResults_;
+        return;
+    }
+
+    // Write to a temporary file first, so that the tuner won't read a partial result.
+    string tmpPath = file::joinPath(dir_, "tmp-" + jobName(job) + "-" + to_string(getpid()));
+    {
+        ofstream ofs(tmpPath);
+        ofs << score << endl;
+    }
+    CHECK_EQ(0, rename(tmpPath.c_str(), file::joinPath(dir_, "result-" + jobName(job)).c_str()));
+}
+
+bool TuneJobQueue::collectResults(vector<vector<int>>* scores)
+{
+    lock_guard<mutex> lock(mu_);
+    const int numJobs = candidates_.size() * seeds_.size();
+    if (!dir_.empty()) {
+        numResults_ = 0;
+        for (size_t i = 0; i < candidates_.size(); ++i) {
+            for (size_t j = 0; j < seeds_.size(); ++j) {
+                ifstream ifs(file::joinPath(dir_, "result-" + jobName(TuneJob { iteration_, static_cast<int>(i), static_cast<int>(j) })));
+                if (ifs && (ifs >> scores_[i][j]))
+                    ++numResults_;
+            }
+        }
+        if (numResults_ < numJobs)
+            return false;
+
+        // All the jobs are done, so nobody uses the files of this iteration.
+        vector<string> files;
+        CHECK(file::listFiles(dir_, &files));
+        for (const string& name : files) {
+            vector<string> ids = strings::split(name, '-');
+            if (ids.size() >= 2 && ids[1] == to_string(iteration_) && !strings::hasPrefix(name, "tmp-"))
+                remove(file::joinPath(dir_, name).c_str());
+        }
+    }
+
+    if (numResults_ < numJobs)
+        return false;
+    *scores = scores_;
+    return true;
+}
+
+int TuneJobQueue::numResults() const
+{
+    lock_guard<mutex> lock(mu_);
+    return numResults_;
+}
+
+int TuneJobQueue::reclaimStaleJobs(bool includesRunning)
+{
+    if (dir_.empty())
+        return 0;
+
+    vector<string> files;
+    if (!file::listFiles(dir_, &files))
+        return 0;
+
+    int numReclaimed = 0;
+    for (const string& name : files) {
+        if (!strings::hasPrefix(name, "running-"))
+            continue;
+        // running-<iteration>-<candidate>-<seedIndex>-<pid>
+        vector<string> ids = strings::split(name.substr(8), '-');
+        if (ids.size() != 4)
+            continue;
+
+        pid_t pid = stoi(ids[3]);
+        bool isRunning = kill(pid, 0) == 0 || errno == EPERM;
+        if (isRunning && !includesRunning)
+            continue;
+
+        string jobName = ids[0] + "-" + ids[1] + "-" + ids[2];
+        if (ifstream(file::joinPath(dir_, "result-" + jobName)).good())
+            continue;
+        if (rename(file::joinPath(dir_, name).c_str(), file::joinPath(dir_, "job-" + jobName).c_str()) < 0)
+            continue;
+        if (isRunning)
+            LOG(WARNING) << "The worker " << pid << " has not returned the result of " << jobName << ". Requeued.";
+        else
+            LOG(WARNING) << "The worker " << pid << " has exited without the result of " << jobName << ". Requeued.";
+        ++numReclaimed;
+    }
+
+    return numReclaimed;
+}
+
+void TuneJobQueue::stop()
+{
+    if (!dir_.empty())
+        ofstream(file::joinPath(dir_, "stop"));
+}
+
+bool TuneJobQueue::shouldStop() const
+{
+    return ifstream(file::joinPath(dir_, "stop")).good();
+}
+
+double updateBySPSA(double a, double c,
+                    const vector<vector<double>>& deltas,
+                    const vector<vector<int>>& scores,
+                    vector<double>* theta)
+{
+    const size_t P = deltas.size();
+    CHECK_EQ(2 * P, scores.size());
+
+    double sumScore = 0;
+    size_t numScores = 0;
+    vector<double> gradient(theta->size());
+    for (size_t k = 0; k < P; ++k) {
+        const size_t N = scores[2 * k].size();
+        CHECK_EQ(N, scores[2 * k + 1].size());
+        double diff = 0;
+        for (size_t i = 0; i < N; ++i) {
+            diff += scores[2 * k][i] - scores[2 * k + 1][i];
+            sumScore += scores[2 * k][i] + scores[2 * k + 1][i];
+        }
+        numScores += 2 * N;
+        if (N > 0)
+            diff /= N;
+        for (size_t j = 0; j < theta->size(); ++j)
+            gradient[j] += diff / (2 * c) * deltas[k][j] / P;
+    }
+
+    for (size_t j = 0; j < theta->size(); ++j)
+        (*theta)[j] += a * gradient[j];
+
+    return numScores > 0 ? sumScore / numScores : 0;
+}
@@ -0,0 +1,80 @@
+#ifndef CPU_MAYAH_TUNER_H_
+#define CPU_MAYAH_TUNER_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+
+class EvaluationParameterMap;
+
+struct TuneJob {
+    int iteration;
+    int candidate;
+    int seedIndex;
+};
+
+// TuneJobQueue holds the games of one tuner iteration.
+// When |dir| is not empty, the jobs are files in |dir|, so the worker processes running
+// with --tune_worker on the same host can take them. A job is taken by renaming its file,
+// which is atomic among processes. The renamed file has the pid of the worker, so the job
+// can be put back when the worker has died.
+class TuneJobQueue : noncopyable {
+public:
+    explicit TuneJobQueue(const std::string& dir) : dir_(dir) {}
+
+    void publish(int iteration, const std::vector<std::shared_ptr<const EvaluationParameterMap>>& candidates,
+                 const std::vector<int>& seeds);
+
+    // Takes one job. Returns false if no job is left.
+    bool take(TuneJob*, std::shared_ptr<const EvaluationParameterMap>*, int* seed);
+    void putResult(const TuneJob&, int score);
+
+    // Returns true if the results of all the jobs have been collected.
+    // |scores| is indexed by [candidate][seedIndex].
+    bool collectResults(std::vector<std::vector<int>>* scores);
+    // Returns the number of the results found by the last collectResults().
+    int numResults() const;
+
+    // Puts back the jobs taken by the processes which have exited without the results.
+    // When |includesRunning| is true, the jobs taken by the running processes are also put back;
+    // this is for the workers which seem to be stuck.
+    // Returns the number of the jobs put back.
+    int reclaimStaleJobs(bool includesRunning = false);
+
+    // Tells the worker processes to stop.
+    void stop();
+    bool shouldStop() const;
+
+private:
+    std::string jobName(const TuneJob& job) const
+    {
+        return std::to_string(job.iteration) + "-" + std::to_string(job.candidate) + "-" + std::to_string(job.seedIndex);
+    }
+    std::string candidatePath(int iteration, int candidate) const;
+    std::string seedsPath(int iteration) const;
+
+    const std::string dir_;
+
+    mutable std::mutex mu_;
+    int iteration_ = -1;
+    std::vector<std::shared_ptr<const EvaluationParameterMap>> candidates_;
+    std::vector<int> seeds_;
+    std::deque<TuneJob> jobs_;
+    std::vector<std::vector<int>> scores_;
+    int numResults_ = 0;
+};
+
+// Runs one step of SPSA. scores[2 * k] and scores[2 * k + 1] are the scores of the candidates
+// theta + c * deltas[k] and theta - c * deltas[k] for each seed. The gradient is estimated from
+// the score differences of the pairs, and |theta| is moved along it with the learning rate |a|.
+// Returns the average score of all the candidates.
+double updateBySPSA(double a, double c,
+                    const std::vector<std::vector<double>>& deltas,
+                    const std::vector<std::vector<int>>& scores,
+                    std::vector<double>* theta);
+
+#endif // CPU_MAYAH_TUNER_H_
@@ -0,0 +1,200 @@
+#include "tuner.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "base/file.h"
+
+#include "evaluation_parameter.h"
+
+using namespace std;
+
+namespace {
+
+bool exists(const string& path)
+{
+    return ifstream(path).good();
+}
+
+vector<shared_ptr<const EvaluationParameterMap>> makeCandidates(int n)
+{
+    vector<shared_ptr<const EvaluationParameterMap>> candidates;
+    for (int i = 0; i < n; ++i) {
+        shared_ptr<EvaluationParameterMap> candidate = make_shared<EvaluationParameterMap>();
+        candidate->mutableMoveParamSet()->setDefault(TOTAL_FRAMES, i + 1.0);
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+// Returns the pid of a process which has already exited.
+pid_t exitedPid()
+{
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(0);
+    waitpid(pid, nullptr, 0);
+    return pid;
+}
+
+} // namespace anonymous
+
+class TuneJobQueueTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/tuner_test-XXXXXX";
+        ASSERT_TRUE(mkdtemp(dir) != nullptr);
+        dir_ = dir;
+    }
+
+    void TearDown() override
+    {
+        vector<string> files;
+        if (file::listFiles(dir_, &files)) {
+            for (const string& name : files)
+                remove(file::joinPath(dir_, name).c_str());
+        }
+        rmdir(dir_.c_str());
+    }
+
+    vector<string> listFiles() const
+    {
+        vector<string> files;
+        vector<string> result;
+        EXPECT_TRUE(file::listFiles(dir_, &files));
+        for (const string& name : files) {
+            if (name != "." && name != "..")
+                result.push_back(name);
+        }
+        return result;
+    }
+
+    string dir_;
+};
+
+TEST_F(TuneJobQueueTest, inMemory)
+{
+    TuneJobQueue queue("");
+    queue.publish(0, makeCandidates(2), vector<int> { 10, 20 });
+
+    TuneJob job;
+    shared_ptr<const EvaluationParameterMap> paramMap;
+    int seed;
+    int numJobs = 0;
+    while (queue.take(&job, &paramMap, &seed)) {
+        EXPECT_EQ(job.candidate + 1.0, paramMap->moveParamSet().param(EvaluationMode::EARLY, TOTAL_FRAMES));
+        EXPECT_EQ((job.seedIndex + 1) * 10, seed);
+        queue.putResult(job, job.candidate * 100 + seed);
+        ++numJobs;
+    }
+    EXPECT_EQ(4, numJobs);
+
+    vector<vector<int>> scores;
+    ASSERT_TRUE(queue.collectResults(&scores));
+    EXPECT_EQ((vector<vector<int>> { { 10, 20 }, { 110, 120 } }), scores);
+}
+
+TEST_F(TuneJobQueueTest, claimAndComplete)
+{
+    TuneJobQueue tuner(dir_);
+    tuner.publish(0, makeCandidates(2), vector<int> { 10 });
+    EXPECT_TRUE(exists(file::joinPath(dir_, "job-0-0-0")));
+    EXPECT_TRUE(exists(file::joinPath(dir_, "job-0-1-0")));
+
+    // A worker loads the candidates and the seeds from the files.
+    TuneJobQueue worker(dir_);
+    vector<vector<int>> scores;
+    for (int i = 0; i < 2; ++i) {
+        TuneJob job;
+        shared_ptr<const EvaluationParameterMap> paramMap;
+        int seed;
+        ASSERT_TRUE(worker.take(&job, &paramMap, &seed));
+        EXPECT_EQ(0, job.iteration);
+        EXPECT_EQ(0, job.seedIndex);
+        EXPECT_EQ(10, seed);
+        EXPECT_EQ(job.candidate + 1.0, paramMap->moveParamSet().param(EvaluationMode::EARLY, TOTAL_FRAMES));
+
+        // The job file is renamed to the running file of this process.
+        string name = "0-" + to_string(job.candidate) + "-0";
+        EXPECT_FALSE(exists(file::joinPath(dir_, "job-" + name)));
+        EXPECT_TRUE(exists(file::joinPath(dir_, "running-" + name + "-" + to_string(getpid()))));
+
+        EXPECT_FALSE(tuner.collectResults(&scores));
+        EXPECT_EQ(i, tuner.numResults());
+        worker.putResult(job, 100 * job.candidate);
+    }
+
+    TuneJob job;
+    shared_ptr<const EvaluationParameterMap> paramMap;
+    int seed;
+    EXPECT_FALSE(worker.take(&job, &paramMap, &seed));
+
+    ASSERT_TRUE(tuner.collectResults(&scores));
+    EXPECT_EQ(2, tuner.numResults());
+    EXPECT_EQ((vector<vector<int>> { { 0 }, { 100 } }), scores);
+
+    // The files of the finished iteration are removed.
+    for (const string& name : listFiles())
+        EXPECT_EQ(string::npos, name.find("-0-")) << name;
+}
+
+TEST_F(TuneJobQueueTest, reclaimStaleJobs)
+{
+    TuneJobQueue tuner(dir_);
+    tuner.publish(0, makeCandidates(1), vector<int> { 10, 20 });
+
+    // The job 0-0-0 is taken by a process which has exited, and the job 0-0-1 is taken by
+    // a running process (this process).
+    string deadRunning = file::joinPath(dir_, "running-0-0-0-" + to_string(exitedPid()));
+    string aliveRunning = file::joinPath(dir_, "running-0-0-1-" + to_string(getpid()));
+    ASSERT_EQ(0, rename(file::joinPath(dir_, "job-0-0-0").c_str(), deadRunning.c_str()));
+    ASSERT_EQ(0, rename(file::joinPath(dir_, "job-0-0-1").c_str(), aliveRunning.c_str()));
+
+    EXPECT_EQ(1, tuner.reclaimStaleJobs());
+    EXPECT_FALSE(exists(deadRunning));
+    EXPECT_TRUE(exists(file::joinPath(dir_, "job-0-0-0")));
+    EXPECT_TRUE(exists(aliveRunning));
+
+    // The jobs of the running processes are put back only when requested.
+    EXPECT_EQ(1, tuner.reclaimStaleJobs(true));
+    EXPECT_FALSE(exists(aliveRunning));
+    EXPECT_TRUE(exists(file::joinPath(dir_, "job-0-0-1")));
+
+    EXPECT_EQ(0, tuner.reclaimStaleJobs(true));
+}
+
+TEST(TunerTest, updateBySPSA)
+{
+    // One pair: theta + c * (1, -1) and theta - c * (1, -1).
+    vector<vector<double>> deltas { { 1.0, -1.0 } };
+    vector<vector<int>> scores { { 110, 90 }, { 50, 50 } };
+    vector<double> theta { 1.0, 2.0 };
+
+    // The average difference is 50, so the gradient is 50 / (2 * 10) * (1, -1).
+    double aveScore = updateBySPSA(0.1, 10.0, deltas, scores, &theta);
+    EXPECT_DOUBLE_EQ(75.0, aveScore);
+    EXPECT_DOUBLE_EQ(1.25, theta[0]);
+    EXPECT_DOUBLE_EQ(1.75, theta[1]);
+}
+
+TEST(TunerTest, updateBySPSAWithTwoPairs)
+{
+    // The two pairs disagree on the second parameter, so it doesn't move.
+    vector<vector<double>> deltas { { 1.0, 1.0 }, { 1.0, -1.0 } };
+    vector<vector<int>> scores { { 120 }, { 100 }, { 120 }, { 100 } };
+    vector<double> theta { 0.0, 0.0 };
+
+    double aveScore = updateBySPSA(1.0, 1.0, deltas, scores, &theta);
+    EXPECT_DOUBLE_EQ(110.0, aveScore);
+    EXPECT_DOUBLE_EQ(10.0, theta[0]);
+    EXPECT_DOUBLE_EQ(0.0, theta[1]);
+}
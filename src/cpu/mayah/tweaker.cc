@@ -1,27 +1,37 @@
 #include "mayah_ai.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
-#include <future>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <random>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <unistd.h>
 
 #include "base/executor.h"
+#include "base/time.h"
+#include "base/wait_group.h"
 #include "core/kumipuyo_seq_generator.h"
 #include "core/probability/puyo_set_probability.h"
 #include "solver/endless.h"
 #include "solver/puyop.h"
 
 #include "evaluation_parameter.h"
+#include "parameter_comparison.h"
+#include "tuner.h"
 
 DECLARE_string(feature);
 DECLARE_string(seq);
 DECLARE_int32(seed);
+DECLARE_int32(num_threads);
 
 DEFINE_bool(once, false, "true if running only once.");
 #if 0
@@ -30,6 +40,23 @@ DEFINE_int32(auto_count, 0, "run auto tweaker for this count.");
 DEFINE_bool(show_field, false, "show field after each hand.");
 DEFINE_int32(size, 100, "the number of case size.");
 DEFINE_int32(offset, 0, "offset for random seed");
+DEFINE_int32(batch_size, 1, "the number of cases one AI plays together in the batched endless mode. "
+             "Since MayahAI plays the cases of a batch one by one, a larger batch only reduces the parallelism.");
+
+DEFINE_int32(tune_iterations, 0, "run the parameter tuner for this number of iterations.");
+DEFINE_int32(tune_population, 4, "the number of perturbation pairs evaluated in each tuner iteration.");
+DEFINE_double(tune_perturbation, 10.0, "the size of the perturbation of the tuner.");
+DEFINE_double(tune_learning_rate, 0.002, "the learning rate of the tuner.");
+DEFINE_string(tune_checkpoint, "tuner-checkpoint.toml", "the path where the tuner saves the current parameter.");
+DEFINE_string(tune_queue_dir, "", "if specified, the tuner shares jobs via this directory with --tune_worker processes.");
+DEFINE_bool(tune_worker, false, "run as a tuner worker that takes jobs from --tune_queue_dir.");
+DEFINE_int32(tune_timeout_sec, 3600, "the tuner requeues the running jobs when no result comes in this time.");
+
+DEFINE_string(compare_feature, "", "if specified, compare --feature with this parameter, and stop when the difference is significant.");
+DEFINE_string(compare_metric, "rensa", "the metric to compare: 'rensa' (main rensa is fired) or 'score'.");
+DEFINE_double(sprt_delta, 0.1, "SPRT tests whether one wins more than 50% + this in the games having different results.");
+DEFINE_double(sprt_alpha, 0.05, "the false positive rate of SPRT.");
+DEFINE_double(sprt_beta, 0.05, "the false negative rate of SPRT.");
 
 using namespace std;
 
@@ -147,28 +174,61 @@ void runOnce(const EvaluationParameterMap& paramMap)
     cout << endl;
 }
 
+EndlessResult runEndless(shared_ptr<const EvaluationParameterMap> paramMap, int seed)
+{
+    auto ai = new DebuggableMayahAI;
+    ai->setUsesRensaHandTree(false);
+    ai->setEvaluationParameterMap(std::move(paramMap));
+
+    Endless endless(std::move(std::unique_ptr<AI>(ai)));
+    KumipuyoSeq seq = KumipuyoSeqGenerator::generateACPuyo2SequenceWithSeed(seed);
+    return endless.run(seq);
+}
+
+vector<EndlessResult> runEndlessBatch(shared_ptr<const EvaluationParameterMap> paramMap, const vector<int>& seeds)
+{
+    auto ai = new DebuggableMayahAI;
+    ai->setUsesRensaHandTree(false);
+    ai->setEvaluationParameterMap(std::move(paramMap));
+
+    vector<KumipuyoSeq> seqs;
+    for (int seed : seeds)
+        seqs.push_back(KumipuyoSeqGenerator::generateACPuyo2SequenceWithSeed(seed));
+
+    Endless endless(std::move(std::unique_ptr<AI>(ai)));
+    return endless.runBatch(seqs);
+}
+
 RunResult run(Executor* executor, const EvaluationParameterMap& paramMap)
 {
     const int N = FLAGS_size;
+    const int batchSize = std::max(1, FLAGS_batch_size);
     vector<promise<Result>> ps(N);
 
-    for (int i = 0; i < N; ++i) {
-        auto f = [i, &paramMap, &ps]() {
-            auto ai = new DebuggableMayahAI;
-            ai->setUsesRensaHandTree(false);
-            ai->setEvaluationParameterMap(paramMap);
-
-            Endless endless(std::move(std::unique_ptr<AI>(ai)));
-            stringstream ss;
-            KumipuyoSeq seq = KumipuyoSeqGenerator::generateACPuyo2SequenceWithSeed(i + FLAGS_offset);
-            EndlessResult result = endless.run(seq);
-            ss << "case " << setw(2) << i << ": "
-               << "score=" << setw(6) << result.score << " rensa=" << setw(2) << result.maxRensa;
-            if (result.zenkeshi)
-                ss << " / ZENKESHI";
-            ss << endl;
-
-            ps[i].set_value(Result{result, ss.str()});
+    // All the AIs share the same parameter map.
+    shared_ptr<const EvaluationParameterMap> sharedParamMap = make_shared<const EvaluationParameterMap>(paramMap);
+
+    // Each AI plays |batchSize| cases together, so the AI and its caches are set up only once
+    // for them. The cases in a batch run sequentially in one task.
+    for (int begin = 0; begin < N; begin += batchSize) {
+        const int end = std::min(N, begin + batchSize);
+        auto f = [begin, end, sharedParamMap, &ps]() {
+            vector<int> seeds;
+            for (int i = begin; i < end; ++i)
+                seeds.push_back(i + FLAGS_offset);
+            vector<EndlessResult> results = runEndlessBatch(sharedParamMap, seeds);
+
+            for (int i = begin; i < end; ++i) {
+                const EndlessResult& result = results[i - begin];
+                stringstream ss;
+                ss << "case " << setw(2) << i << ": "
+                   << "score=" << setw(6) << result.score << " rensa=" << setw(2) << result.maxRensa;
+                if (result.zenkeshi)
+                    ss << " / ZENKESHI";
+                ss << endl;
+
+                ps[i].set_value(Result{result, ss.str()});
+            }
         };
         executor->submit(f);
     }
@@ -269,6 +329,253 @@ void runAutoTweaker(Executor* executor, const EvaluationParameterMap& original,
 }
 #endif
 
+// ----------------------------------------------------------------------
+// Parameter tuner.
+//
+// The tuner uses SPSA. In each iteration, it makes FLAGS_tune_population pairs of candidates
+// (theta + c * delta, theta - c * delta), where delta is a random vector of +1/-1, and
+// estimates the gradient from the score difference of each pair. All the candidates in one
+// iteration are evaluated with the same seeds, so the difference is less affected by luck.
+
+// TunableParameter is one tweakable feature in one evaluation mode.
+class TunableParameter {
+public:
+    TunableParameter(EvaluationMode mode, EvaluationMoveFeatureKey key) : mode_(mode), isMove_(true), key_(key) {}
+    TunableParameter(EvaluationMode mode, EvaluationRensaFeatureKey key) : mode_(mode), isMove_(false), key_(key) {}
+
+    double get(const EvaluationParameterMap& paramMap) const
+    {
+        if (isMove_)
+            return paramMap.moveParamSet().param(mode_, static_cast<EvaluationMoveFeatureKey>(key_));
+        return paramMap.mainRensaParamSet().param(mode_, static_cast<EvaluationRensaFeatureKey>(key_));
+    }
+
+    void set(EvaluationParameterMap* paramMap, double value) const
+    {
+        if (isMove_)
+            paramMap->mutableMoveParamSet()->setParam(mode_, static_cast<EvaluationMoveFeatureKey>(key_), value);
+        else
+            paramMap->mutableMainRensaParamSet()->setParam(mode_, static_cast<EvaluationRensaFeatureKey>(key_), value);
+    }
+
+private:
+    EvaluationMode mode_;
+    bool isMove_;
+    int key_;
+};
+
+vector<TunableParameter> tunableParameters()
+{
+    vector<TunableParameter> result;
+    for (const auto& mode : ALL_EVALUATION_MODES) {
+        for (const auto& ef : EvaluationMoveFeatureSet::features()) {
+            if (ef.isTweakable())
+                result.emplace_back(mode, ef.key());
+        }
+        for (const auto& ef : EvaluationRensaFeatureSet::features()) {
+            if (ef.isTweakable())
+                result.emplace_back(mode, ef.key());
+        }
+    }
+    return result;
+}
+
+// Runs the jobs in |queue| with all the threads of |executor| until no job is left.
+void runTuneJobs(Executor* executor, TuneJobQueue* queue)
+{
+    WaitGroup wg;
+    wg.add(FLAGS_num_threads);
+    for (int i = 0; i < FLAGS_num_threads; ++i) {
+        executor->submit([queue, &wg]() {
+            TuneJob job;
+            shared_ptr<const EvaluationParameterMap> paramMap;
+            int seed;
+            while (queue->take(&job, &paramMap, &seed)) {
+                EndlessResult result = runEndless(paramMap, seed);
+                queue->putResult(job, result.score);
+            }
+            wg.done();
+        });
+    }
+    wg.waitUntilDone();
+}
+
+void runTuner(Executor* executor, const EvaluationParameterMap& original)
+{
+    const vector<TunableParameter> params = tunableParameters();
+    const int P = FLAGS_tune_population;
+    const int N = FLAGS_size;
+
+    EvaluationParameterMap current(original);
+    int startIteration = 0;
+    if (current.load(FLAGS_tune_checkpoint)) {
+        ifstream ifs(FLAGS_tune_checkpoint + ".iteration");
+        ifs >> startIteration;
+        cout << "Resume from " << FLAGS_tune_checkpoint << " at iteration " << startIteration << endl;
+    }
+
+    vector<double> theta(params.size());
+    for (size_t j = 0; j < params.size(); ++j)
+        theta[j] = params[j].get(current);
+
+    TuneJobQueue queue(FLAGS_tune_queue_dir);
+    mt19937 mt(random_device{}());
+
+    for (int iteration = startIteration; iteration < FLAGS_tune_iterations; ++iteration) {
+        // The usual gain sequences of SPSA.
+        const double a = FLAGS_tune_learning_rate / pow(iteration + 1, 0.602);
+        const double c = FLAGS_tune_perturbation / pow(iteration + 1, 0.101);
+
+        vector<vector<double>> deltas(P, vector<double>(params.size()));
+        vector<shared_ptr<const EvaluationParameterMap>> candidates;
+        for (int k = 0; k < P; ++k) {
+            for (size_t j = 0; j < params.size(); ++j)
+                deltas[k][j] = uniform_int_distribution<>(0, 1)(mt) ? 1.0 : -1.0;
+
+            for (double sign : { 1.0, -1.0 }) {
+                shared_ptr<EvaluationParameterMap> candidate = make_shared<EvaluationParameterMap>(current);
+                for (size_t j = 0; j < params.size(); ++j)
+                    params[j].set(candidate.get(), theta[j] + sign * c * deltas[k][j]);
+                candidates.push_back(candidate);
+            }
+        }
+
+        // The seeds are shared by all the candidates, but differ among iterations.
+        vector<int> seeds(N);
+        for (int i = 0; i < N; ++i)
+            seeds[i] = FLAGS_offset + iteration * N + i;
+
+        double beginTime = currentTime();
+        queue.publish(iteration, candidates, seeds);
+        runTuneJobs(executor, &queue);
+
+        // Wait for the jobs taken by the worker processes. When a worker has died,
+        // its jobs are put back and run here unless another worker takes them.
+        // When no result has come for FLAGS_tune_timeout_sec, the workers seem to be stuck,
+        // so all the running jobs are put back.
+        vector<vector<int>> scores;
+        double lastResultTime = currentTime();
+        int lastNumResults = 0;
+        while (!queue.collectResults(&scores)) {
+            if (queue.numResults() > lastNumResults) {
+                lastNumResults = queue.numResults();
+                lastResultTime = currentTime();
+            }
+
+            bool timedOut = currentTime() - lastResultTime >= FLAGS_tune_timeout_sec;
+            if (timedOut) {
+                LOG(WARNING) << "No result of iteration " << iteration << " has come in "
+                             << FLAGS_tune_timeout_sec << " seconds. Requeue the running jobs.";
+                lastResultTime = currentTime();
+            }
+
+            if (queue.reclaimStaleJobs(timedOut) > 0)
+                runTuneJobs(executor, &queue);
+            else
+                sleep(1);
+        }
+        double elapsed = currentTime() - beginTime;
+
+        double aveScore = updateBySPSA(a, c, deltas, scores, &theta);
+        for (size_t j = 0; j < params.size(); ++j)
+            params[j].set(&current, theta[j]);
+
+        cout << "iteration " << iteration
+             << ": ave score = " << aveScore
+             << " / " << (2 * P * N / elapsed) << " games/sec" << endl;
+
+        CHECK(current.save(FLAGS_tune_checkpoint));
+        ofstream(FLAGS_tune_checkpoint + ".iteration") << (iteration + 1) << endl;
+    }
+
+    queue.stop();
+    cout << current.toString() << endl;
+}
+
+void runTuneWorker(Executor* executor)
+{
+    CHECK(!FLAGS_tune_queue_dir.empty()) << "--tune_queue_dir should be specified.";
+
+    TuneJobQueue queue(FLAGS_tune_queue_dir);
+    while (!queue.shouldStop()) {
+        runTuneJobs(executor, &queue);
+        sleep(1);
+    }
+}
+
+// ----------------------------------------------------------------------
+// Sequential comparison.
+//
+// Two parameter maps play the same seeds, and SequentialProbabilityRatioTest compares them.
+// The comparison stops as soon as one of them is accepted, or FLAGS_size seeds are played.
+
+void runComparison(Executor* executor, const EvaluationParameterMap& paramMapA, const EvaluationParameterMap& paramMapB)
+{
+    const int N = FLAGS_size;
+    const shared_ptr<const EvaluationParameterMap> paramMaps[2] = {
+        make_shared<const EvaluationParameterMap>(paramMapA),
+        make_shared<const EvaluationParameterMap>(paramMapB),
+    };
+
+    // The games are submitted in the order of seeds, so the early seeds are finished first.
+    // Once the result is decided, the games not started yet are skipped.
+    vector<promise<int>> ps(2 * N);
+    atomic<bool> decided(false);
+    WaitGroup wg;
+    wg.add(2 * N);
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            executor->submit([i, j, &paramMaps, &ps, &decided, &wg]() {
+                if (decided) {
+                    ps[2 * i + j].set_value(0);
+                } else {
+                    EndlessResult result = runEndless(paramMaps[j], i + FLAGS_offset);
+                    ps[2 * i + j].set_value(compareMetric(result, FLAGS_compare_metric));
+                }
+                wg.done();
+            });
+        }
+    }
+
+    double beginTime = currentTime();
+    SequentialProbabilityRatioTest sprt(FLAGS_sprt_delta, FLAGS_sprt_alpha, FLAGS_sprt_beta);
+    int sumA = 0;
+    int sumB = 0;
+    int numPlayed = 0;
+    for (int i = 0; i < N && sprt.decision() == SequentialProbabilityRatioTest::Decision::UNDECIDED; ++i) {
+        int resultA = ps[2 * i].get_future().get();
+        int resultB = ps[2 * i + 1].get_future().get();
+        sumA += resultA;
+        sumB += resultB;
+        ++numPlayed;
+        sprt.add(resultA, resultB);
+
+        cout << "seed " << setw(4) << (i + FLAGS_offset) << ": "
+             << setw(6) << resultA << " vs " << setw(6) << resultB
+             << " / wins " << sprt.numWinsA() << " - " << sprt.numWinsB()
+             << " / llr = " << sprt.logLikelihoodRatio() << endl;
+    }
+    decided = true;
+    wg.waitUntilDone();
+
+    switch (sprt.decision()) {
+    case SequentialProbabilityRatioTest::Decision::A_IS_BETTER:
+        cout << "A (" << FLAGS_feature << ") is better." << endl;
+        break;
+    case SequentialProbabilityRatioTest::Decision::B_IS_BETTER:
+        cout << "B (" << FLAGS_compare_feature << ") is better." << endl;
+        break;
+    case SequentialProbabilityRatioTest::Decision::UNDECIDED:
+        cout << "No significant difference in " << N << " seeds." << endl;
+        break;
+    }
+
+    cout << "played " << numPlayed << " / " << N << " seeds"
+         << " in " << (currentTime() - beginTime) << " [s]" << endl;
+    cout << "ave " << FLAGS_compare_metric << ": "
+         << (static_cast<double>(sumA) / numPlayed) << " vs " << (static_cast<double>(sumB) / numPlayed) << endl;
+}
+
 int main(int argc, char* argv[])
 {
     google::ParseCommandLineFlags(&argc, &argv, true);
@@ -285,7 +592,16 @@ int main(int argc, char* argv[])
     }
     paramMap.removeNontokopuyoParameter();
 
-    if (!FLAGS_seq.empty() || FLAGS_seed >= 0) {
+    if (FLAGS_tune_worker) {
+        runTuneWorker(executor.get());
+    } else if (FLAGS_tune_iterations > 0) {
+        runTuner(executor.get(), paramMap);
+    } else if (!FLAGS_compare_feature.empty()) {
+        EvaluationParameterMap anotherParamMap;
+        CHECK(anotherParamMap.load(FLAGS_compare_feature)) << "parameter cannot be loaded correctly.";
+        anotherParamMap.removeNontokopuyoParameter();
+        runComparison(executor.get(), paramMap, anotherParamMap);
+    } else if (!FLAGS_seq.empty() || FLAGS_seed >= 0) {
         runOnce(paramMap);
     } else if (FLAGS_once) {
         run(executor.get(), paramMap);
@@ -100,7 +100,7 @@ DropDecision munetoshi::AI::think_internal(
 void munetoshi::AI::onGroundedForEnemy(const FrameRequest& frame) {
     CoreField field(CoreField::fromPlainFieldWithDrop(frame.enemyPlayerFrameRequest().field));
 
-    if (field.simulate().chains > 1) {
+    if (field.simulateAtLeast(2)) {
         strategy = FIRE;
     }
 }
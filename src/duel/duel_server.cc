@@ -8,6 +8,7 @@
 
 #include <gflags/gflags.h>
 
+#include "base/trace.h"
 #include "core/decision.h"
 #include "core/frame_response.h"
 #include "core/kumipuyo_seq_generator.h"
@@ -148,6 +149,8 @@ void DuelServer::runDuelLoop()
     int p1_lose = 0;
     int num_match = 0;
 
+    Tracer::setThreadName("duel");
+
     while (!shouldStop_) {
         GameResult gameResult = runGame(manager_);
 
@@ -176,6 +179,7 @@ void DuelServer::runDuelLoop()
             break;
         case GameResult::GAME_HAS_STOPPED:
             // Game has stopped.
+            Tracer::dumpIfRequested();
             return;
         }
 
@@ -191,6 +195,8 @@ void DuelServer::runDuelLoop()
         num_match++;
     }
 
+    Tracer::dumpIfRequested();
+
     if (callbackDuelServerWillExit_) {
         callbackDuelServerWillExit_();
     }
@@ -212,17 +218,27 @@ GameResult DuelServer::runGame(ConnectorManager* manager)
         duelState.frameId += 1;
         int frameId = duelState.frameId;
 
+        ScopedTrace frameTrace("DuelServer::frame", frameId);
+
         GameState gameState = duelState.toGameState();
 
         // --- Sends the current frame information.
-        for (int pi = 0; pi < 2; ++pi) {
-            manager->connector(pi)->send(gameState.toFrameRequestFor(pi));
+        {
+            ScopedTrace trace("DuelServer::sendFrameRequest", frameId);
+            for (int pi = 0; pi < 2; ++pi) {
+                manager->connector(pi)->send(gameState.toFrameRequestFor(pi));
+            }
         }
 
         // --- Reads the response of the current frame information.
         // It takes up to 1/FPS [s] to finish this section.
         vector<FrameResponse> data[2];
-        if (!manager->receive(frameId, data)) {
+        bool received;
+        {
+            ScopedTrace trace("DuelServer::receiveFrameResponse", frameId);
+            received = manager->receive(frameId, data);
+        }
+        if (!received) {
             if (manager->connector(0)->isClosed()) {
                 gameResult = GameResult::P2_WIN_WITH_CONNECTION_ERROR;
                 break;
@@ -233,10 +249,16 @@ GameResult DuelServer::runGame(ConnectorManager* manager)
         }
 
         // --- Play with input.
-        play(&duelState, data);
+        {
+            ScopedTrace trace("DuelServer::play", frameId);
+            play(&duelState, data);
+        }
         gameState = duelState.toGameState();
-        for (GameStateObserver* observer : observers_)
-            observer->onUpdate(gameState);
+        {
+            ScopedTrace trace("DuelServer::notifyObservers", frameId);
+            for (GameStateObserver* observer : observers_)
+                observer->onUpdate(gameState);
+        }
 
         // --- Check the result
         gameResult = gameState.gameResult();
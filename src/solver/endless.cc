@@ -1,8 +1,11 @@
 #include "solver/endless.h"
 
 #include <algorithm>
+#include <functional>
 #include <iostream>
 
+#include <glog/logging.h>
+
 #include "base/time.h"
 #include "core/frame_request.h"
 #include "core/field_pretty_printer.h"
@@ -13,10 +16,111 @@ Endless::Endless(unique_ptr<AI> ai) : ai_(std::move(ai))
 {
 }
 
+namespace {
+
+const int NUM_HANDS = 50;
+
+// EndlessGame is the state of one endless game.
+struct EndlessGame {
+    // Drops the current kumipuyo with |decision|. Returns false if it couldn't be dropped.
+    bool drop(const Decision& decision);
+    // Checks the game is finished after drop(). When finished, |result| is set and
+    // true is returned. Otherwise, |req| is advanced to the next hand.
+    bool settle(int hand);
+    // Finishes the game without the main rensa.
+    void runOut();
+
+    FrameRequest req;
+    CoreField field;
+    PlayerState me;
+    PlayerState enemy;
+
+    std::vector<Decision> decisions;
+    int maxRensaScore = 0;
+    int maxRensa = 0;
+
+    bool finished = false;
+    EndlessResult result;
+};
+
+bool EndlessGame::drop(const Decision& decision)
+{
+    if (!field.dropKumipuyo(decision, req.myPlayerFrameRequest().kumipuyoSeq.front()))
+        return false;
+
+    decisions.push_back(decision);
+    return true;
+}
+
+bool EndlessGame::settle(int hand)
+{
+    RensaResult rensaResult = field.simulate();
+    maxRensaScore = std::max(maxRensaScore, rensaResult.score);
+    maxRensa = std::max(maxRensa, rensaResult.chains);
+    if (field.color(3, 12) != PuyoColor::EMPTY) {
+        finished = true;
+        result = EndlessResult {
+            .hand = hand,
+            .score = -1,
+            .maxRensa = -1,
+            .zenkeshi = false,
+            .decisions = decisions,
+            .type = EndlessResult::Type::DEAD,
+        };
+        return true;
+    }
+    if (rensaResult.score > 10000) {
+        // The main rensa must be fired.
+        finished = true;
+        result = EndlessResult {
+            .hand = hand,
+            .score = rensaResult.score,
+            .maxRensa = rensaResult.chains,
+            .zenkeshi = field.isZenkeshi(),
+            .decisions = decisions,
+            .type = EndlessResult::Type::MAIN_CHAIN,
+        };
+        return true;
+    }
+    if (field.isZenkeshi()) {
+        finished = true;
+        result = EndlessResult {
+            .hand = hand,
+            .score = rensaResult.score,
+            .maxRensa = rensaResult.chains,
+            .zenkeshi = true,
+            .decisions = decisions,
+            .type = EndlessResult::Type::ZENKESHI,
+        };
+        return true;
+    }
+
+    req.playerFrameRequest[0].field = field.toPlainField();
+    req.playerFrameRequest[0].kumipuyoSeq.dropFront();
+    req.playerFrameRequest[1].kumipuyoSeq.dropFront();
+    return false;
+}
+
+void EndlessGame::runOut()
+{
+    finished = true;
+    result = EndlessResult {
+        .hand = NUM_HANDS,
+        .score = maxRensaScore,
+        .maxRensa = maxRensa,
+        .zenkeshi = false,
+        .decisions = decisions,
+        .type = EndlessResult::Type::PUYOSEQ_RUNOUT,
+    };
+}
+
+} // anonymous namespace
+
 EndlessResult Endless::run(const KumipuyoSeq& seq)
 {
     // Initialize ai.
-    FrameRequest req;
+    EndlessGame game;
+    FrameRequest& req = game.req;
     req.frameId = 1;
     ai_->gameWillBegin(req);
 
@@ -28,15 +132,12 @@ EndlessResult Endless::run(const KumipuyoSeq& seq)
     ai_->enemy_.field = CoreField(req.playerFrameRequest[1].field);
     ai_->enemy_.seq = req.playerFrameRequest[1].kumipuyoSeq;
 
-    vector<Decision> decisions;
-
-    int maxRensaScore = 0;
-    int maxRensa = 0;
-    for (int i = 0; i < 50; ++i) {
+    for (int i = 0; i < NUM_HANDS; ++i) {
         req.frameId = i + 2;
 
         // For gazing.
-        ai_->gaze(req.frameId, CoreField(req.enemyPlayerFrameRequest().field), req.enemyPlayerFrameRequest().kumipuyoSeq);
+        ai_->enemy_.seq = req.enemyPlayerFrameRequest().kumipuyoSeq;
+        ai_->gaze(req.frameId, ai_->enemy_.field, ai_->enemy_.seq);
 
         // think
         ai_->next2AppearedForMe(req);
@@ -45,7 +146,7 @@ EndlessResult Endless::run(const KumipuyoSeq& seq)
         double beginTime = currentTime();
 
         DropDecision dropDecision = ai_->think(req.frameId,
-                                               CoreField(req.myPlayerFrameRequest().field),
+                                               game.field,
                                                req.myPlayerFrameRequest().kumipuyoSeq,
                                                ai_->myPlayerState(),
                                                ai_->enemyPlayerState(),
@@ -53,72 +154,124 @@ EndlessResult Endless::run(const KumipuyoSeq& seq)
 
         double endTime = currentTime();
 
-        CoreField f(req.myPlayerFrameRequest().field);
-        if (!f.dropKumipuyo(dropDecision.decision(), req.myPlayerFrameRequest().kumipuyoSeq.front())) {
+        if (!game.drop(dropDecision.decision())) {
             // couldn't drop. break.
             break;
         }
 
         if (verbose_) {
-            FieldPrettyPrinter::print(f.toPlainField(), req.playerFrameRequest[0].kumipuyoSeq.subsequence(1));
+            FieldPrettyPrinter::print(game.field.toPlainField(), req.playerFrameRequest[0].kumipuyoSeq.subsequence(1));
             cout << "time=" << (endTime - beginTime) << endl;
         }
 
-        decisions.push_back(dropDecision.decision());
-
-        RensaResult rensaResult = f.simulate();
-        maxRensaScore = std::max(maxRensaScore, rensaResult.score);
-        maxRensa = std::max(maxRensa, rensaResult.chains);
-        if (f.color(3, 12) != PuyoColor::EMPTY) {
-            return EndlessResult {
-                .hand = i,
-                .score = -1,
-                .maxRensa = -1,
-                .zenkeshi = false,
-                .decisions = decisions,
-                .type = EndlessResult::Type::DEAD,
-            };
-        }
-        if (rensaResult.score > 10000) {
-            // The main rensa must be fired.
-            return EndlessResult {
-                .hand = i,
-                .score = rensaResult.score,
-                .maxRensa = rensaResult.chains,
-                .zenkeshi = f.isZenkeshi(),
-                .decisions = decisions,
-                .type = EndlessResult::Type::MAIN_CHAIN,
-            };
-        }
-        if (f.isZenkeshi()) {
-            return EndlessResult {
-                .hand = i,
-                .score = rensaResult.score,
-                .maxRensa = rensaResult.chains,
-                .zenkeshi = true,
-                .decisions = decisions,
-                .type = EndlessResult::Type::ZENKESHI,
-            };
-        }
-
-        req.playerFrameRequest[0].field = f.toPlainField();
-        req.playerFrameRequest[0].kumipuyoSeq.dropFront();
-        req.playerFrameRequest[1].kumipuyoSeq.dropFront();
+        if (game.settle(i))
+            return game.result;
 
         // Update the current field.
-        ai_->me_.field = f;
+        ai_->me_.field = game.field;
 
         ai_->groundedForMe(req);
     }
 
-    return EndlessResult {
-        .hand = 50,
-        .score = maxRensaScore,
-        .maxRensa = maxRensa,
-        .zenkeshi = false,
-        .decisions = decisions,
-        .type = EndlessResult::Type::PUYOSEQ_RUNOUT,
+    game.runOut();
+    return game.result;
+}
+
+vector<EndlessResult> Endless::runBatch(const vector<KumipuyoSeq>& seqs)
+{
+    vector<EndlessGame> games(seqs.size());
+
+    // Initialize ai once, and make each game start from the initialized state.
+    FrameRequest initialReq;
+    initialReq.frameId = 1;
+    ai_->gameWillBegin(initialReq);
+
+    for (size_t k = 0; k < seqs.size(); ++k) {
+        EndlessGame& game = games[k];
+        game.req = initialReq;
+        game.req.playerFrameRequest[0].kumipuyoSeq = seqs[k];
+        game.req.playerFrameRequest[1].kumipuyoSeq = seqs[k];
+        setEnemyField(&game.req);
+
+        game.me = ai_->me_;
+        game.enemy = ai_->enemy_;
+        game.enemy.field = CoreField(game.req.playerFrameRequest[1].field);
+        game.enemy.seq = game.req.playerFrameRequest[1].kumipuyoSeq;
+    }
+
+    // The AI has only one pair of PlayerStates, so each game's states are swapped in
+    // while the AI updates them.
+    auto withGameState = [this](EndlessGame* game, const std::function<void ()>& f) {
+        std::swap(ai_->me_, game->me);
+        std::swap(ai_->enemy_, game->enemy);
+        f();
+        std::swap(ai_->me_, game->me);
+        std::swap(ai_->enemy_, game->enemy);
     };
+
+    vector<EndlessGame*> ongoing;
+    vector<ThinkRequest> requests;
+    for (int i = 0; i < NUM_HANDS; ++i) {
+        ongoing.clear();
+        requests.clear();
+        for (auto& game : games) {
+            if (game.finished)
+                continue;
+
+            FrameRequest& req = game.req;
+            req.frameId = i + 2;
+            withGameState(&game, [this, &req]() {
+                ai_->next2AppearedForMe(req);
+                ai_->decisionRequestedForMe(req);
+            });
+
+            // thinkBatch() gazes the enemy with this sequence.
+            game.enemy.seq = req.enemyPlayerFrameRequest().kumipuyoSeq;
+
+            ongoing.push_back(&game);
+            requests.push_back(ThinkRequest {
+                .frameId = req.frameId,
+                .field = game.field,
+                .kumipuyoSeq = req.myPlayerFrameRequest().kumipuyoSeq,
+                .me = game.me,
+                .enemy = game.enemy,
+                .fast = false,
+            });
+        }
+
+        if (ongoing.empty())
+            break;
+
+        vector<DropDecision> dropDecisions = ai_->thinkBatch(requests);
+        CHECK_EQ(ongoing.size(), dropDecisions.size());
+
+        for (size_t k = 0; k < ongoing.size(); ++k) {
+            EndlessGame* game = ongoing[k];
+            if (!game->drop(dropDecisions[k].decision())) {
+                // couldn't drop.
+                game->runOut();
+                continue;
+            }
+            if (game->settle(i))
+                continue;
+
+            withGameState(game, [this, game]() {
+                // Update the current field.
+                ai_->me_.field = game->field;
+                ai_->groundedForMe(game->req);
+            });
+        }
+    }
+
+    vector<EndlessResult> results;
+    results.reserve(games.size());
+    for (auto& game : games) {
+        if (!game.finished)
+            game.runOut();
+        results.push_back(game.result);
+    }
+
+    return results;
 }
 
 void Endless::setEnemyField(FrameRequest* req)
@@ -34,6 +34,12 @@ public:
 
     EndlessResult run(const KumipuyoSeq&);
 
+    // Runs the games of |seqs| in lock-step with the same AI. In each hand, the decisions
+    // of all the ongoing games are requested by one AI::thinkBatch() call. The i-th result
+    // is the result of the i-th sequence. With the default AI::thinkBatch(), the AI gets
+    // the same calls for each game as in run(), so the results are the same as run()'s.
+    std::vector<EndlessResult> runBatch(const std::vector<KumipuyoSeq>& seqs);
+
     // Sets verbose mode. This will show fields in each hand.
     void setVerbose(bool flag) { verbose_ = flag; }
 
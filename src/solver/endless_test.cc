@@ -0,0 +1,72 @@
+#include "solver/endless.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/core_field.h"
+#include "core/kumipuyo_seq.h"
+#include "core/kumipuyo_seq_generator.h"
+
+using namespace std;
+
+namespace {
+
+// LowestColumnAI drops a kumipuyo vertically on the lowest column. The column to start
+// searching from depends on the last gazed sequence, so the decisions also check gaze().
+class LowestColumnAI : public AI {
+public:
+    LowestColumnAI() : AI("lowest-column") {}
+
+protected:
+    DropDecision think(int, const CoreField& field, const KumipuyoSeq&,
+                       const PlayerState&, const PlayerState&, bool) const override
+    {
+        int bestX = 0;
+        for (int i = 0; i < 6; ++i) {
+            int x = (startIndex_ + i) % 6 + 1;
+            if (bestX == 0 || field.height(x) < field.height(bestX))
+                bestX = x;
+        }
+        return DropDecision(Decision(bestX, 0));
+    }
+
+    void gaze(int, const CoreField&, const KumipuyoSeq& seq) override
+    {
+        startIndex_ = seq.isEmpty() ? 0 : ordinal(seq.axis(0)) % 6;
+    }
+
+private:
+    int startIndex_ = 0;
+};
+
+} // namespace anonymous
+
+TEST(EndlessTest, runBatchIsSameAsRun)
+{
+    vector<KumipuyoSeq> seqs;
+    for (int seed = 1; seed <= 5; ++seed)
+        seqs.push_back(KumipuyoSeqGenerator::generateACPuyo2SequenceWithSeed(seed));
+
+    Endless endless(unique_ptr<AI>(new LowestColumnAI));
+    vector<EndlessResult> results = endless.runBatch(seqs);
+    ASSERT_EQ(seqs.size(), results.size());
+
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        EndlessResult expected = Endless(unique_ptr<AI>(new LowestColumnAI)).run(seqs[i]);
+
+        EXPECT_EQ(expected.hand, results[i].hand) << i;
+        EXPECT_EQ(expected.score, results[i].score) << i;
+        EXPECT_EQ(expected.maxRensa, results[i].maxRensa) << i;
+        EXPECT_EQ(expected.zenkeshi, results[i].zenkeshi) << i;
+        EXPECT_EQ(expected.type, results[i].type) << i;
+        EXPECT_EQ(expected.decisions, results[i].decisions) << i;
+    }
+}
+
+TEST(EndlessTest, runBatchWithoutSequence)
+{
+    Endless endless(unique_ptr<AI>(new LowestColumnAI));
+    EXPECT_TRUE(endless.runBatch(vector<KumipuyoSeq>()).empty());
+}
@@ -3,7 +3,10 @@
 #include <iostream>
 #include <vector>
 
+#include "base/executor.h"
 #include "base/time.h"
+#include "base/trace.h"
+#include "base/wait_group.h"
 #include "capture/analyzer.h"
 #include "capture/source.h"
 #include "core/core_field.h"
@@ -39,12 +42,17 @@ WiiConnectServer::WiiConnectServer(Source* source, Analyzer* analyzer,
         Connector::create(1, p2Program),
     });
     connector_->setWaitTimeout(false);
+
+    // 1P is processed on the server thread, so one more thread is enough.
+    executor_.reset(new Executor(1));
+    executor_->start();
 }
 
 WiiConnectServer::~WiiConnectServer()
 {
     if (th_.joinable())
         th_.join();
+    executor_->stop();
 }
 
 void WiiConnectServer::addObserver(GameStateObserver* observer)
@@ -75,6 +83,7 @@ void WiiConnectServer::reset()
         message_[i].clear();
     }
 
+    lock_guard<mutex> lock(colorMu_);
     colorMap_.clear();
     colorMap_.insert(make_pair(RealColor::RC_EMPTY, PuyoColor::EMPTY));
     colorMap_.insert(make_pair(RealColor::RC_OJAMA, PuyoColor::OJAMA));
@@ -92,8 +101,14 @@ void WiiConnectServer::runLoop()
     UniqueSDLSurface prev2Surface(emptyUniqueSDLSurface());
     UniqueSDLSurface prev3Surface(emptyUniqueSDLSurface());
 
+    Tracer::setThreadName("wii");
+
     while (!shouldStop_) {
-        UniqueSDLSurface surface(source_->nextFrame());
+        UniqueSDLSurface surface(emptyUniqueSDLSurface());
+        {
+            ScopedTrace trace("WiiConnectServer::nextFrame", frameId);
+            surface = source_->nextFrame();
+        }
         if (!surface.get()) {
             ++noSurfaceCount;
             LOG(INFO) << "No surface?: count=" << noSurfaceCount << endl;
@@ -106,8 +121,15 @@ void WiiConnectServer::runLoop()
             continue;
         }
 
-        unique_ptr<AnalyzerResult> r =
-            analyzer_->analyze(surface.get(), prevSurface.get(), prev2Surface.get(), prev3Surface.get(), analyzerResults_);
+        // Covers from the analysis of the captured frame to sending keys.
+        ScopedTrace frameTrace("WiiConnectServer::frame", frameId);
+
+        unique_ptr<AnalyzerResult> r;
+        {
+            ScopedTrace trace("WiiConnectServer::analyze", frameId);
+            r = analyzer_->analyze(surface.get(), prevSurface.get(), prev2Surface.get(), prev3Surface.get(), analyzerResults_,
+                                   executor_.get());
+        }
         LOG(INFO) << r->toString();
 
         switch (r->state()) {
@@ -179,19 +201,28 @@ void WiiConnectServer::runLoop()
         // We set frameId to surface's userdata. This will be useful for saving screen shot.
         surface->userdata = reinterpret_cast<void*>(static_cast<uintptr_t>(frameId));
 
+        // Only the members for drawing need the lock. Keep the critical section short,
+        // and release the old surface and result outside of it.
+        UniqueSDLSurface lastSurface(emptyUniqueSDLSurface());
+        unique_ptr<AnalyzerResult> oldestResult;
         {
             lock_guard<mutex> lock(mu_);
-            prev3Surface = move(prev2Surface);
-            prev2Surface = move(prevSurface);
-            prevSurface = move(surface_);
+            lastSurface = move(surface_);
             surface_ = move(surface);
             analyzerResults_.push_front(move(r));
-            while (analyzerResults_.size() > 10)
+            if (analyzerResults_.size() > 10) {
+                oldestResult = move(analyzerResults_.back());
                 analyzerResults_.pop_back();
+            }
         }
+        prev3Surface = move(prev2Surface);
+        prev2Surface = move(prevSurface);
+        prevSurface = move(lastSurface);
 
         frameId++;
     }
+
+    Tracer::dumpIfRequested();
 }
 
 bool WiiConnectServer::playForUnknown(int frameId)
@@ -237,37 +268,48 @@ bool WiiConnectServer::playForPlaying(int frameId, const AnalyzerResult& analyze
 {
     double beginTime = currentTime();
 
-    // Send KeySet() after detecting ojama-drop or grounded.
-    // It's important that it is sent before requesting the decision to client,
-    // because client may take time to return the rensponse.
-    // Otherwise, puyo might be dropped for a few frames.
-    for (int pi = 0; pi < 2; ++pi) {
+    // Each player has its own key sender and connector, so the players are processed
+    // concurrently. Only receiving the responses is done for both players at once.
+    bool disconnected[2] = { false, false };
+    runForEachPlayer([&](int pi) {
+        if (connector_->connector(pi)->isClosed()) {
+            disconnected[pi] = true;
+            return;
+        }
+
         if (!isAi_[pi])
-            continue;
+            return;
 
+        // Send KeySet() after detecting ojama-drop or grounded.
+        // It's important that it is sent before requesting the decision to client,
+        // because client may take time to return the rensponse.
+        // Otherwise, puyo might be dropped for a few frames.
         if (analyzerResult.playerResult(pi)->userEvent.ojamaDropped ||
             analyzerResult.playerResult(pi)->userEvent.grounded) {
             keySenders_[pi]->sendKeySet(KeySet());
         }
-    }
+
+        ScopedTrace trace("WiiConnectServer::sendFrameRequest", frameId);
+        connector_->connector(pi)->send(makeFrameRequestFor(pi, frameId, analyzerResult));
+    });
 
     for (int pi = 0; pi < 2; pi++) {
-        if (connector_->connector(pi)->isClosed()) {
+        if (disconnected[pi]) {
             LOG(INFO) << playerText(pi) << " disconnected";
             fprintf(stderr, "player #%d was disconnected\n", pi);
             return false;
         }
-
-        if (isAi_[pi])
-            connector_->connector(pi)->send(makeFrameRequestFor(pi, frameId, analyzerResult));
     }
 
     vector<FrameResponse> responses[2];
-    connector_->receive(frameId, responses);
+    {
+        ScopedTrace trace("WiiConnectServer::receiveFrameResponse", frameId);
+        connector_->receive(frameId, responses);
+    }
 
-    for (int pi = 0; pi < 2; pi++) {
+    runForEachPlayer([&](int pi) {
         if (!isAi_[pi])
-            continue;
+            return;
 
         if (analyzerResult.playerResult(pi)->userEvent.grounded) {
             lastDecision_[pi] = Decision();
@@ -281,8 +323,9 @@ bool WiiConnectServer::playForPlaying(int frameId, const AnalyzerResult& analyze
             }
         }
 
+        ScopedTrace trace("WiiConnectServer::outputKeys", frameId);
         outputKeys(pi, analyzerResult, responses[pi], beginTime);
-    }
+    });
 
     return true;
 }
@@ -378,6 +421,8 @@ FrameRequest WiiConnectServer::makeFrameRequestFor(int playerId, int frameId, co
 
 PuyoColor WiiConnectServer::toPuyoColor(RealColor rc, bool allowAllocation)
 {
+    lock_guard<mutex> lock(colorMu_);
+
     auto it = colorMap_.find(rc);
     if (it != colorMap_.end())
         return it->second;
@@ -459,6 +504,18 @@ GameState WiiConnectServer::toGameState(int frameId, const AnalyzerResult& analy
     return gameState;
 }
 
+void WiiConnectServer::runForEachPlayer(const function<void (int)>& f)
+{
+    WaitGroup wg;
+    wg.add(1);
+    executor_->submit([&f, &wg]() {
+        f(1);
+        wg.done();
+    });
+    f(0);
+    wg.waitUntilDone();
+}
+
 void WiiConnectServer::outputKeys(int pi, const AnalyzerResult& analyzerResult,
                                   const vector<FrameResponse>& responses, double beginTime)
 {
@@ -506,6 +563,7 @@ void WiiConnectServer::outputKeys(int pi, const AnalyzerResult& analyzerResult,
             keySenders_[pi]->sendWait(20);
         }
 
+        ScopedTrace trace("KeySender::sendKeySetSeq");
         keySenders_[pi]->sendKeySetSeq(keySetSeq);
         return;
     }
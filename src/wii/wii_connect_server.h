@@ -3,6 +3,7 @@
 
 #include <array>
 #include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -22,6 +23,7 @@
 
 class Analyzer;
 class AnalyzerResult;
+class Executor;
 class GameState;
 class GameStateObserver;
 class KeySender;
@@ -48,6 +50,10 @@ private:
     void reset();
     void runLoop();
 
+    // Runs |f| for 2P on |executor_| and for 1P on the calling thread, and waits for both.
+    // This is the frame-level barrier of the per-player work.
+    void runForEachPlayer(const std::function<void (int pi)>& f);
+
     bool playForUnknown(int frameId);
     bool playForLevelSelect(int frameId, const AnalyzerResult&);
     bool playForPlaying(int frameId, const AnalyzerResult&);
@@ -63,6 +69,8 @@ private:
     std::thread th_;
     volatile bool shouldStop_;
     std::unique_ptr<ConnectorManager> connector_;
+    // Used to process the two players concurrently.
+    std::unique_ptr<Executor> executor_;
 
     std::vector<GameStateObserver*> observers_;
 
@@ -75,6 +83,8 @@ private:
     Analyzer* analyzer_;
     KeySender* keySenders_[2];
 
+    // toPuyoColor() might be called for each player concurrently.
+    std::mutex colorMu_;
     std::map<RealColor, PuyoColor> colorMap_;
     std::array<bool, 4> colorsUsed_;
 